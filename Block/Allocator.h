@@ -0,0 +1,277 @@
+#include <map>
+#include <vector>
+#include "Block.h"
+#pragma once
+
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+const addr_t maxBlkAddr = SEGMENT_NUM_BLK * MAX_NUM_SEGMENT - 1;   // 可分配的最大块地址，与段文件能容纳的地址范围一致
+
+/**
+ * @brief 磁盘块地址的区段分配器
+ * 结果表、中间结果和索引文件不再使用固定的地址区域，而是在需要时申请一段地址连续的区段(extent)
+ * 空闲空间表按首地址记录所有空闲区段，分配时首次适应，归还时与相邻的空闲区段合并
+ * 写块写满已申请的区段后，先尝试向后扩展该区段，后一块已被占用时再另行申请新的区段
+ * 同一文件的各个区段由块末尾的下一块地址串起来，因此大小未知的文件也能与其他文件共存
+ * 每个文件的区段还按文件的首地址记在文件表中，删除文件时不必沿块链读出每一块
+ */
+class ExtentAllocator {
+public:
+    ExtentAllocator() { reset(); }
+    void reset();
+    addr_t allocate(int numOfBlk, addr_t file = END_OF_FILE);
+    addr_t nextBlockOf(addr_t addr);
+    void claim(addr_t addr, addr_t file = END_OF_FILE);
+    void trimAfter(addr_t addr);
+    std::vector<std::pair<addr_t, addr_t>> extentsOf(addr_t file);
+    addr_t fileOf(addr_t addr);
+    bool dropFile(addr_t file);
+    int numOfFreeBlk();
+
+private:
+    typedef struct Extent {
+        addr_t last;    // 区段的末地址
+        addr_t file;    // 区段所属文件的首地址
+    } extent_t;
+    typedef std::map<addr_t, addr_t> free_map_t;
+    typedef std::map<addr_t, extent_t> used_map_t;
+    free_map_t freeExtents;     // 空闲区段：首地址 -> 末地址
+    used_map_t usedExtents;     // 已分配的区段：首地址 -> 区段信息，相邻的区段分属不同的文件，不做合并
+    std::map<addr_t, std::vector<addr_t>> fileExtents;  // 文件表：文件首地址 -> 按写入顺序排列的各区段首地址
+    addr_t _allocate(int numOfBlk, addr_t file);
+    free_map_t::iterator _findFree(addr_t addr);
+    used_map_t::iterator _findUsed(addr_t addr);
+    void _takeFree(addr_t first, addr_t last);
+    void _putFree(addr_t first, addr_t last);
+};
+
+ExtentAllocator blkAllocator;   // 全局只定义一个地址分配器
+
+/**
+ * @brief 清空分配记录，除END_OF_FILE以外的所有地址都成为空闲地址
+ */
+void ExtentAllocator::reset() {
+    freeExtents.clear();
+    usedExtents.clear();
+    fileExtents.clear();
+    freeExtents[1] = maxBlkAddr;
+}
+
+/**
+ * @brief 申请一段地址连续的区段
+ * 
+ * @param numOfBlk 区段的块数
+ * @param file 区段所属文件的首地址，为END_OF_FILE时为新文件申请，否则该区段并入已有的文件
+ * @return addr_t 区段的首地址，为新文件申请时也是新文件的首地址
+ */
+addr_t ExtentAllocator::allocate(int numOfBlk, addr_t file) { return _allocate(numOfBlk, file); }
+
+/**
+ * @brief 获取文件在addr之后继续写入的块地址，该块会被标记为已占用
+ * addr不是所在区段的最后一块时直接取下一块，否则向后扩展该区段
+ * 扩展不了时另行申请numOfBufBlock块的新区段，使文件之后的块仍尽量连续，没有用到的块在文件写完时归还
+ * 
+ * @param addr 文件当前写满的块地址
+ * @return addr_t 下一块的地址
+ */
+addr_t ExtentAllocator::nextBlockOf(addr_t addr) {
+    auto used = _findUsed(addr);
+    if (used == usedExtents.end()) {
+        claim(addr);
+        used = _findUsed(addr);
+    }
+    extent_t &extent = used->second;
+    if (addr < extent.last)
+        return addr + 1;
+    if (addr < maxBlkAddr && _findFree(addr + 1) != freeExtents.end()) {
+        _takeFree(addr + 1, addr + 1);
+        extent.last = addr + 1;
+        return addr + 1;
+    }
+    return _allocate(numOfBufBlock, extent.file);
+}
+
+/**
+ * @brief 将一个块标记为已占用，已占用的块保持不变
+ * 用于登记磁盘上已有的文件，以及写入调用者自行指定的地址
+ * 
+ * @param addr 块地址
+ * @param file 该块所属文件的首地址，为END_OF_FILE时该块作为新文件的首块
+ */
+void ExtentAllocator::claim(addr_t addr, addr_t file) {
+    if (addr == END_OF_FILE || _findFree(addr) == freeExtents.end())
+        return;
+    if (file == END_OF_FILE)
+        file = addr;
+    _takeFree(addr, addr);
+    // 紧接在同一文件的区段之后时并入该区段
+    auto prev = _findUsed(addr - 1);
+    if (prev != usedExtents.end() && prev->second.last == addr - 1 && prev->second.file == file) {
+        prev->second.last = addr;
+        return;
+    }
+    usedExtents[addr] = {addr, file};
+    fileExtents[file].push_back(addr);
+}
+
+/**
+ * @brief 归还addr所在区段中addr之后的所有块
+ * 文件写完时用于归还预先申请却没有用到的块
+ * 
+ * @param addr 文件的最后一块地址
+ */
+void ExtentAllocator::trimAfter(addr_t addr) {
+    auto used = _findUsed(addr);
+    if (used == usedExtents.end() || used->second.last == addr)
+        return;
+    addr_t last = used->second.last;
+    used->second.last = addr;
+    _putFree(addr + 1, last);
+}
+
+/**
+ * @brief 获取一个文件的所有区段
+ * 
+ * @param file 文件的首地址
+ * @return std::vector<std::pair<addr_t, addr_t>> 按写入顺序排列的(首地址, 末地址)，文件不在文件表中时为空
+ */
+std::vector<std::pair<addr_t, addr_t>> ExtentAllocator::extentsOf(addr_t file) {
+    std::vector<std::pair<addr_t, addr_t>> extents;
+    auto found = fileExtents.find(file);
+    if (found == fileExtents.end())
+        return extents;
+    for (addr_t first : found->second)
+        extents.push_back(std::make_pair(first, usedExtents.at(first).last));
+    return extents;
+}
+
+/**
+ * @brief 获取一个块所属文件的首地址
+ * 
+ * @param addr 块地址
+ * @return addr_t 所属文件的首地址，该块未被占用时为END_OF_FILE
+ */
+addr_t ExtentAllocator::fileOf(addr_t addr) {
+    auto used = _findUsed(addr);
+    return (used == usedExtents.end()) ? END_OF_FILE : used->second.file;
+}
+
+/**
+ * @brief 归还一个文件的所有区段，并将其从文件表中删除
+ * 
+ * @param file 文件的首地址
+ * @return bool 文件是否在文件表中
+ */
+bool ExtentAllocator::dropFile(addr_t file) {
+    auto found = fileExtents.find(file);
+    if (found == fileExtents.end())
+        return false;
+    for (addr_t first : found->second) {
+        auto used = usedExtents.find(first);
+        _putFree(first, used->second.last);
+        usedExtents.erase(used);
+    }
+    fileExtents.erase(found);
+    return true;
+}
+
+/**
+ * @brief 统计空闲的块数
+ * 
+ * @return int 空闲的块数
+ */
+int ExtentAllocator::numOfFreeBlk() {
+    int count = 0;
+    for (auto iter = freeExtents.begin(); iter != freeExtents.end(); ++iter)
+        count += iter->second - iter->first + 1;
+    return count;
+}
+
+/**
+ * @brief 按首次适应申请一段地址连续的区段
+ * 
+ * @param numOfBlk 区段的块数
+ * @param file 区段所属文件的首地址，为END_OF_FILE时该区段作为新文件
+ * @return addr_t 区段的首地址
+ */
+addr_t ExtentAllocator::_allocate(int numOfBlk, addr_t file) {
+    if (numOfBlk < 1)
+        numOfBlk = 1;
+    for (auto iter = freeExtents.begin(); iter != freeExtents.end(); ++iter) {
+        if (iter->second - iter->first + 1 >= (addr_t)numOfBlk) {
+            addr_t first = iter->first, last = first + numOfBlk - 1;
+            if (file == END_OF_FILE)
+                file = first;
+            _takeFree(first, last);
+            usedExtents[first] = {last, file};
+            fileExtents[file].push_back(first);
+            return first;
+        }
+    }
+    printf("错误：磁盘上没有连续%d块的空闲区段！\n", numOfBlk);
+    system("pause");
+    exit(FAIL);
+}
+
+/**
+ * @brief 查找包含addr的空闲区段
+ * 
+ * @param addr 块地址
+ * @return free_map_t::iterator 包含addr的空闲区段，不存在时为freeExtents.end()
+ */
+ExtentAllocator::free_map_t::iterator ExtentAllocator::_findFree(addr_t addr) {
+    auto iter = freeExtents.upper_bound(addr);
+    if (iter == freeExtents.begin())
+        return freeExtents.end();
+    --iter;
+    return (addr <= iter->second) ? iter : freeExtents.end();
+}
+
+/**
+ * @brief 查找包含addr的已分配区段
+ * 
+ * @param addr 块地址
+ * @return used_map_t::iterator 包含addr的已分配区段，不存在时为usedExtents.end()
+ */
+ExtentAllocator::used_map_t::iterator ExtentAllocator::_findUsed(addr_t addr) {
+    auto iter = usedExtents.upper_bound(addr);
+    if (iter == usedExtents.begin())
+        return usedExtents.end();
+    --iter;
+    return (addr <= iter->second.last) ? iter : usedExtents.end();
+}
+
+/**
+ * @brief 从空闲区段表中取出[first, last]，这段地址必须位于同一个空闲区段中
+ */
+void ExtentAllocator::_takeFree(addr_t first, addr_t last) {
+    auto iter = _findFree(first);
+    addr_t freeFirst = iter->first, freeLast = iter->second;
+    freeExtents.erase(iter);
+    if (freeFirst < first)
+        freeExtents[freeFirst] = first - 1;
+    if (last < freeLast)
+        freeExtents[last + 1] = freeLast;
+}
+
+/**
+ * @brief 将[first, last]放回空闲区段表，并与前后相邻的空闲区段合并
+ */
+void ExtentAllocator::_putFree(addr_t first, addr_t last) {
+    auto next = freeExtents.upper_bound(first);
+    if (next != freeExtents.end() && next->first == last + 1) {
+        last = next->second;
+        next = freeExtents.erase(next);
+    }
+    if (next != freeExtents.begin()) {
+        auto prev = std::prev(next);
+        if (prev->second + 1 == first) {
+            prev->second = last;
+            return;
+        }
+    }
+    freeExtents[first] = last;
+}
+
+#endif // !ALLOCATOR_H
@@ -1,5 +1,11 @@
 #include <iostream>
+#include <algorithm>
+#include <cstdint>
 #include "Block.h"
+#include "Prefetcher.h"
+#include "WriteBehind.h"
+#include "Allocator.h"
+#include "Config.h"
 extern "C" {
     #include "extmem.c"
 }
@@ -8,52 +14,267 @@ extern "C" {
 #define CHAR_ZERO_ASCII '0'
 #define CHAR_NINE_ASCII '9'
 #define CHAR_EMPTY_ASCII 0
+#define EMPTY_ATTR_BINARY INT32_MIN     // v2、v3格式中空属性的取值
+#define EMPTY_CODE_PACKED 0             // v4格式中空属性的编码
+
+blkData_t *releasedBlkData = NULL;  // 块被释放后指向的全零块
+
+/**
+ * @brief 以小端序读写v2格式中的整数，与主机的字节序无关
+ */
+inline int32_t loadInt32(const blkData_t *p) {
+    return (int32_t)((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+inline int loadUInt16(const blkData_t *p) { return p[0] | (p[1] << 8); }
+
+inline void storeInt32(blkData_t *p, int32_t val) {
+    uint32_t u = (uint32_t)val;
+    p[0] = u & 0xFF;
+    p[1] = (u >> 8) & 0xFF;
+    p[2] = (u >> 16) & 0xFF;
+    p[3] = (u >> 24) & 0xFF;
+}
+
+/**
+ * @brief 根据块首字节识别块的格式
+ * 
+ * @param blkData 块的数据
+ * @return blkFormat_t 块的格式
+ */
+inline blkFormat_t parseBlkFormat(const blkData_t *blkData) {
+    if (blkData[0] == BLK_MAGIC_BINARY)
+        return BLK_FORMAT_BINARY;
+    if (blkData[0] == BLK_MAGIC_PAX)
+        return BLK_FORMAT_PAX;
+    if (blkData[0] == BLK_MAGIC_PACKED)
+        return BLK_FORMAT_PACKED;
+    return BLK_FORMAT_ASCII;
+}
+
+inline blkData_t blkMagicOf(blkFormat_t format) {
+    if (format == BLK_FORMAT_PAX)
+        return BLK_MAGIC_PAX;
+    if (format == BLK_FORMAT_PACKED)
+        return BLK_MAGIC_PACKED;
+    return BLK_MAGIC_BINARY;
+}
+
+/**
+ * @brief 读写v4格式中从第bitPos位开始、宽度为width位的编码
+ * 编码按小端序的位顺序连续存放，宽度为0时不占用任何位
+ */
+inline uint32_t loadBits(const blkData_t *p, int bitPos, int width) {
+    if (width == 0)
+        return 0;
+    const blkData_t *q = p + (bitPos >> 3);
+    int shift = bitPos & 7, numOfBytes = (shift + width + 7) >> 3;
+    uint64_t v = 0;
+    for (int i = 0; i < numOfBytes; ++i)
+        v |= (uint64_t)q[i] << (8 * i);
+    return (uint32_t)((v >> shift) & ((1ULL << width) - 1));
+}
+
+inline void storeBits(blkData_t *p, int bitPos, int width, uint32_t code) {
+    if (width == 0)
+        return;
+    blkData_t *q = p + (bitPos >> 3);
+    int shift = bitPos & 7, numOfBytes = (shift + width + 7) >> 3;
+    uint64_t v = (uint64_t)code << shift;
+    for (int i = 0; i < numOfBytes; ++i)
+        q[i] |= (v >> (8 * i)) & 0xFF;
+}
+
+/**
+ * @brief v4块头中解码记录所需的参数
+ */
+typedef struct PackedHeader {
+    int numOfRows;          // 块中的记录数
+    int capacity;           // 块的容量
+    int widthA, widthB;     // A、B编码的位宽
+    int32_t baseA, baseB;   // A、B的基准值
+    PackedHeader(const blkData_t *blkData) {
+        numOfRows = loadUInt16(blkData + 2);
+        capacity = loadUInt16(blkData + 8);
+        widthA = blkData[10];
+        widthB = blkData[11];
+        baseA = loadInt32(blkData + 12);
+        baseB = loadInt32(blkData + 16);
+    }
+    // 编码为0时是空属性，否则还原为基准值 + 编码 - 1
+    int decode(int32_t base, uint32_t code) const { return (int)((int64_t)base + code - 1); }
+} packed_header_t;
+
+/**
+ * @brief 计算把n条记录压缩成v4格式所需的位数
+ * 每个属性取块内非空值的最小值作为基准值，编码的位宽由最大值与基准值的差决定
+ * 
+ * @param R 待压缩的记录
+ * @param n 记录的数量
+ * @param baseA A的基准值
+ * @param baseB B的基准值
+ * @param widthA A编码的位宽
+ * @param widthB B编码的位宽
+ * @return int 所需的位数，属性值的跨度超出32位编码时返回FAIL
+ */
+int packedSizeInBits(const row_t *R, int n, int32_t &baseA, int32_t &baseB, int &widthA, int &widthB) {
+    int64_t minA = INT64_MAX, maxA = INT64_MIN, minB = INT64_MAX, maxB = INT64_MIN;
+    for (int i = 0; i < n; ++i) {
+        if (R[i].isFilled || R[i].A != MAX_ATTR_VAL) {
+            minA = std::min(minA, (int64_t)R[i].A);
+            maxA = std::max(maxA, (int64_t)R[i].A);
+        }
+        if (R[i].B != MAX_ATTR_VAL) {
+            minB = std::min(minB, (int64_t)R[i].B);
+            maxB = std::max(maxB, (int64_t)R[i].B);
+        }
+    }
+    baseA = (minA <= maxA) ? (int32_t)minA : 0;
+    baseB = (minB <= maxB) ? (int32_t)minB : 0;
+    uint64_t maxCodeA = (minA <= maxA) ? maxA - minA + 1 : 0;
+    uint64_t maxCodeB = (minB <= maxB) ? maxB - minB + 1 : 0;
+    if (maxCodeA > UINT32_MAX || maxCodeB > UINT32_MAX)
+        return FAIL;
+    for (widthA = 0; maxCodeA >> widthA; ++widthA)
+        ;
+    for (widthB = 0; maxCodeB >> widthB; ++widthB)
+        ;
+    return n * (widthA + widthB);
+}
+
+/**
+ * @brief 判断n条记录能否压缩进一个v4格式的块中
+ * 
+ * @param R 待压缩的记录
+ * @param n 记录的数量
+ * @return bool 能否放下
+ */
+bool fitsInPackedBlock(const row_t *R, int n) {
+    int32_t baseA, baseB;
+    int widthA, widthB;
+    int numOfBits = packedSizeInBits(R, n, baseA, baseB, widthA, widthB);
+    return numOfBits != FAIL && numOfBits <= (sizeOfBlock - sizeOfPackedHeader) * 8;
+}
+
+/**
+ * @brief 解析ASCII格式中一个4字节的属性值
+ * 合法的属性值是左对齐的十进制数字，后面补0字节，用SWAR的方法一次处理4个字节：
+ * 先找出第一个非数字字节的位置得到数字的位数，再把数字右对齐，最后两两合并成整数
+ * 不符合这一格式的属性值交给sscanf解析，结果与sscanf一致
+ * 
+ * @param p 属性值的起始地址
+ * @param val 解析出的属性值，解析失败时保持不变
+ * @return bool 是否解析成功
+ */
+inline bool parseAttrASCII(const blkData_t *p, int &val) {
+    uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    // 数字字节的高半字节为3且低半字节加6不进位，非数字字节在掩码中对应的字节非零
+    uint32_t nonDigit = ((v & 0xF0F0F0F0) ^ 0x30303030) | (((v & 0x0F0F0F0F) + 0x06060606) & 0xF0F0F0F0);
+#if defined(__GNUC__)
+    int numOfDigits = nonDigit ? __builtin_ctz(nonDigit) / 8 : 4;
+#else
+    int numOfDigits = 0;
+    while (numOfDigits < 4 && ((nonDigit >> (8 * numOfDigits)) & 0xFF) == 0)
+        numOfDigits += 1;
+#endif
+    if (numOfDigits == 0 && v == 0)
+        return false;   // 空属性
+    if (numOfDigits == 0 || (numOfDigits < 4 && (v >> (8 * numOfDigits)) != 0)) {
+        char str[5] = "\0";
+        for (int i = 0; i < 4; ++i)
+            str[i] = p[i] ? p[i] : 32;
+        return sscanf(str, "%4d", &val) > 0;
+    }
+    // 右对齐后高位补的0字节恰好是数字0
+    uint32_t digits = (v << (8 * (4 - numOfDigits))) & 0x0F0F0F0F;
+    digits = (digits * 10 + (digits >> 8)) & 0x00FF00FF;
+    val = (int)((digits & 0xFF) * 100 + (digits >> 16));
+    return true;
+}
+
+void syncFile(const addr_t fileStartAddr);
 
 Block::Block() {
     // memset(blkData, 0, endOfBlock);
+    blkData = releasedBlkData;
+    format = BLK_FORMAT_ASCII;
     endAddrOfData = addrOfLastRow;
+    decodedFrom = BLK_START_ADDR;
+}
+
+Block::~Block() {
+    // 读到未写满的表末块时不会自动释放，离开作用域时统一归还缓冲区
+    if (releasedBlkData != NULL)
+        freeBlock();
 }
 
 /**
- * @brief ͷ
- * ӻbuffͷŸÿ飬һЩӦĻչ
+ * @brief 块的释放
+ * 从缓冲区buff中释放该块，并完成一些相应的回收工作
+ * 已释放的块再次释放时不会重复归还缓冲区
  */
 void Block::freeBlock() {
     readBlkAddr = 0;
     writeBlkAddr = 0;
-    cursor = BLK_START_ADDR;        // дָ븴λ
-    freeBlockInBuffer(blkData, &buff);
-    memset(blkData, 0, endOfBlock); //ոÿ
+    cursor = BLK_START_ADDR;        // 读写指针复位
+    if (isLoaded()) {
+        std::lock_guard<std::mutex> lock(buffMutex);
+        freeBlockInBuffer(blkData, &buff);
+    }
+    // 释放后的帧仍缓存着该块的内容(映射块更是只读的)，因此不能清空原来的块
+    // 而是改为指向全零块，与原来清空该块的效果一致
+    blkData = releasedBlkData;
+    memset(blkData, 0, endOfBlock); //　清空该块的数据
 }
 
 /**
- * @brief ӴмصַΪaddrĴ̿鵽
+ * @brief 从磁盘中加载地址为addr的磁盘块到缓冲区中
  * 
- * @param addr ҪصĴַ̿
- * @param endPos ô̿ĩβλãһ̶Ͼ˸ô̶ȡļ¼
+ * @param addr 将要加载的磁盘块地址
+ * @param endPos 该磁盘块的末尾位置，它一定程度上决定了该磁盘读取的记录数量
+ * @param isSequential 是否为沿块链的顺序读取，只有顺序读取才请求预读后续的块
  */
-void Block::loadFromDisk(addr_t addr, cursor_t endPos) {
-    if ((blkData = readBlockFromDisk(addr, &buff)) == NULL) {
+void Block::loadFromDisk(addr_t addr, cursor_t endPos, bool isSequential) {
+    if (isLoaded())
+        freeBlock();    // 表末未写满的块读完后不会被自动释放，重新装载前先归还
+    {
+        std::lock_guard<std::mutex> lock(buffMutex);
+        blkData = readBlockFromDisk(addr, &buff);
+    }
+    if (blkData == NULL) {
         printf("Fail to read from disk %d!\n", addr);
         system("pause");
         exit(FAIL);
     }
-    // printf("װص%d\n", addr);
+    // printf("装载第%d块\n", addr);
+    format = parseBlkFormat(blkData);
     readBlkAddr = addr;
-    cursor = BLK_START_ADDR;    // ָ븴λ
-    endAddrOfData = endPos;
+    cursor = BLK_START_ADDR;    // 指针复位
+    // v4格式的块头中有准确的记录数，不需要按调用者给出的末尾位置读取
+    endAddrOfData = (format == BLK_FORMAT_PACKED) ? loadUInt16(blkData + 2) * sizeOfRow : endPos;
+    if (isSequential)
+        prefetcher.request(readNextAddr()); // 沿块链预读后续的块
 }
 
 /**
- * @brief дʼ
+ * @brief 块的写初始化
  * 
- * @param filename дļڴ˴ַ
- * @param maxNumOfRows ÿд¼
+ * @param filename 写入文件名，在此代表块地址
+ * @param maxNumOfRows 该块写入的最大记录数量
+ * @param newFormat 写入的块使用的格式
  */
-void Block::writeInit(const file_t filename, int maxNumOfRows) {
+void Block::writeInit(const file_t filename, int maxNumOfRows, blkFormat_t newFormat) {
+    if (isLoaded())
+        freeBlock();
     writeBlkAddr = filename;
+    blkAllocator.claim(writeBlkAddr);  // 调用者自行指定的地址也要登记为已占用
+    format = newFormat;
     cursor = BLK_START_ADDR;
-    if ((blkData = getNewBlockInBuffer(&buff)) == NULL){
+    {
+        std::lock_guard<std::mutex> lock(buffMutex);
+        blkData = getNewBlockInBuffer(&buff);
+    }
+    if (blkData == NULL){
         printf("Buffer Allocation Error!\n");
         system("pause");
         exit(FAIL);
@@ -63,90 +284,216 @@ void Block::writeInit(const file_t filename, int maxNumOfRows) {
 }
 
 /**
- * @brief дһ鲢ͷд
+ * @brief 写入最后一块并释放写块
+ * 预先申请却没有用到的块归还给地址分配器
+ * isDurable为true时，返回时该文件的所有块都已写回磁盘并落盘
+ * 排序的子表、散列的桶等临时文件不必落盘，其脏块留在缓冲池中，由写回线程或换出时写回
  * 
- * @return addr_t ǰдһдַ
+ * @param isDurable 该文件是否需要落盘
+ * @return addr_t 当前写入最后一块的写入地址，文件为空时为0
  */
-addr_t Block::writeLastBlock() {
+addr_t Block::writeLastBlock(bool isDurable) {
+    addr_t lastAddr = END_OF_FILE;
     if (cursor > BLK_START_ADDR) {
-        // ʾд滹ʣ
+        // 表示写块里面还有剩余的内容
         _writeAddr(END_OF_FILE);
         _writeToDisk(writeBlkAddr);
-        writeBlkAddr += 1;
-        return writeBlkAddr - 1;
-    } else {
-        freeBlock();
-        return 0;
+        lastAddr = writeBlkAddr;
+        blkAllocator.trimAfter(lastAddr);
+    } else if (writeBlkAddr != END_OF_FILE) {
+        // 一条记录都没有写入，申请到的区段全部归还
+        blkAllocator.dropFile(writeBlkAddr);
     }
+    freeBlock();
+    if (isDurable && lastAddr != END_OF_FILE)
+        syncFile(blkAllocator.fileOf(lastAddr));
+    return lastAddr;
 }
 
 /**
- * @brief ӵǰBlockлȡһ¼¼
- * ԶܣǰʱԶȡһַ
- * ǰļʱ۽ȡٴΣؿռ¼
+ * @brief 从当前的Block中获取一条新记录
+ * 含自动迭代功能：当前块读完时，自动读取下一个地址到缓冲区
+ * 当前文件读完时，无论接下来继续读取多少次，都返回空记录
  * 
- * @return row_t ȡļ¼
+ * @return row_t 读取的记录结果
  */
 row_t Block::getNewRow() {
-    row_t R, emptyRow;
+    row_t R;
+    decodeAll(&R, 1);
+    return R;
+}
+
+/**
+ * @brief 从当前的Block中一次解析出多条记录
+ * 从cursor开始连续解析当前块中的记录，直到读满maxRows条、读到块尾或读到第一条空记录为止
+ * 空记录同样会被写入R并计入返回值，这与逐条调用getNewRow的行为一致
+ * 当前块开始时已读完，则先自动读取下一块；文件已读完时，只返回一条空记录
+ * 
+ * @param R 存放记录的数组，至少能容纳maxRows条记录
+ * @param maxRows 最多解析的记录数量
+ * @return int 解析的记录数量(含末尾的空记录)
+ */
+int Block::decodeAll(row_t *R, int maxRows) {
+    if (maxRows <= 0)
+        return 0;
     if (cursor == endAddrOfData) {
-        // blockѶȡɣҪȡһµblock
+        // 该block的所有内容已读取完成，需要读取一块新的block进来
         addr_t nextAddr = readNextAddr();
-        freeBlock();    // Ҫͷ
+        freeBlock();    // 想要继续申请必须先释放
         if (nextAddr == END_OF_FILE) {
-            // ǰѶļĩβһɶʱؿռ¼
-            return emptyRow;
+            // 当前已读到文件末尾，即无下一块可读时，返回空记录
+            R[0] = row_t();
+            return 1;
         } else {
-            loadFromDisk(nextAddr, endAddrOfData);
+            loadFromDisk(nextAddr, endAddrOfData, true);
         }
     }
-    // ȡRowеֵA, B
-    char str1[5] = "\0", str2[5] = "\0";
-    for (int i = 0; i < 4; ++i) {
-        str1[i] = *(blkData + cursor + i);
-        if (str1[i] == '\0')
-            str1[i] = 32;
-        str2[i] = *(blkData + cursor + 4 + i);
-        if (str2[i] == '\0')
-            str2[i] = 32;
-    }
-    int scan1 = sscanf(str1, "%4d", &R.A);
-    int scan2 = sscanf(str2, "%4d", &R.B);
-    R.isFilled = true;
-    if (scan1 <= 0)
-        R.isFilled = false;
-    if (scan2 <= 0)
-        R.B = MAX_ATTR_VAL;
-    cursor += sizeOfRow;    // cursorƶһ¼
-    return R;
+    int numOfDecoded = 0;
+    if (format == BLK_FORMAT_PACKED) {
+        packed_header_t header(blkData);
+        const blkData_t *codes = blkData + sizeOfPackedHeader;
+        int offsetOfB = header.numOfRows * header.widthA;
+        while (numOfDecoded < maxRows && cursor != endAddrOfData) {
+            row_t &cur = R[numOfDecoded++];
+            int slot = cursor / sizeOfRow;
+            uint32_t codeA = loadBits(codes, slot * header.widthA, header.widthA);
+            uint32_t codeB = loadBits(codes, offsetOfB + slot * header.widthB, header.widthB);
+            cur.isFilled = (codeA != EMPTY_CODE_PACKED);
+            cur.A = cur.isFilled ? header.decode(header.baseA, codeA) : MAX_ATTR_VAL;
+            cur.B = (codeB != EMPTY_CODE_PACKED) ? header.decode(header.baseB, codeB) : MAX_ATTR_VAL;
+            cursor += sizeOfRow;
+            if (!cur.isFilled)
+                break;
+        }
+    } else if (format != BLK_FORMAT_ASCII) {
+        int numOfRows = loadUInt16(blkData + 2);
+        while (numOfDecoded < maxRows && cursor != endAddrOfData) {
+            row_t &cur = R[numOfDecoded++];
+            int slot = cursor / sizeOfRow;
+            if (slot < numOfRows) {
+                int32_t A = loadInt32(blkData + _attrPos(slot, 0)), B = loadInt32(blkData + _attrPos(slot, 1));
+                cur.isFilled = (A != EMPTY_ATTR_BINARY);
+                cur.A = cur.isFilled ? A : MAX_ATTR_VAL;
+                cur.B = (B != EMPTY_ATTR_BINARY) ? B : MAX_ATTR_VAL;
+            } else {
+                cur = row_t();  // 超出块头记录数的槽位都是空记录
+            }
+            cursor += sizeOfRow;
+            if (!cur.isFilled)
+                break;
+        }
+    } else {
+        while (numOfDecoded < maxRows && cursor != endAddrOfData) {
+            row_t &cur = R[numOfDecoded++];
+            cur = row_t();
+            cur.isFilled = parseAttrASCII(blkData + cursor, cur.A);
+            if (!parseAttrASCII(blkData + cursor + sizeOfAttr, cur.B))
+                cur.B = MAX_ATTR_VAL;
+            cursor += sizeOfRow;
+            if (!cur.isFilled)
+                break;
+        }
+    }
+    return numOfDecoded;
 }
 
 /**
- * @brief ǰBlockдһ¼¼
- * дʱԶд
+ * @brief 从当前的Block中只解析记录的A属性
+ * 从cursor开始把当前块中连续的非空记录的A属性解析到数组A中，直到读满maxRows条、读到块尾或读到第一条空记录为止
+ * B属性不做解析，需要整条记录时再通过decodedRow取出，这样筛选、连接时只有符合条件的记录才会解析B属性
+ * v3格式的块中A属性是连续存放的，这时解析只需顺序读取一段连续的整数
+ * 当前块开始时已读完，则先自动读取下一块
  * 
- * @param R дļ¼
- * @return addr_t ǰдĿĵַ
+ * @param A 存放A属性的数组，至少能容纳maxRows个值
+ * @param maxRows 最多解析的记录数量
+ * @return int 解析的记录数量(不含空记录)，为0时表示文件已读完
+ */
+int Block::decodeColumnA(int *A, int maxRows) {
+    if (maxRows <= 0)
+        return 0;
+    if (cursor == endAddrOfData) {
+        addr_t nextAddr = readNextAddr();
+        freeBlock();
+        if (nextAddr == END_OF_FILE)
+            return 0;
+        loadFromDisk(nextAddr, endAddrOfData, true);
+    }
+    decodedFrom = cursor;
+    int firstSlot = cursor / sizeOfRow;
+    int numOfSlots = std::min(maxRows, (int)(endAddrOfData - cursor) / sizeOfRow);
+    int numOfDecoded = 0;
+    if (format == BLK_FORMAT_PACKED) {
+        packed_header_t header(blkData);
+        const blkData_t *codes = blkData + sizeOfPackedHeader;
+        numOfSlots = std::min(numOfSlots, header.numOfRows - firstSlot);
+        for (; numOfDecoded < numOfSlots; ++numOfDecoded) {
+            uint32_t code = loadBits(codes, (firstSlot + numOfDecoded) * header.widthA, header.widthA);
+            if (code == EMPTY_CODE_PACKED)
+                break;
+            A[numOfDecoded] = header.decode(header.baseA, code);
+        }
+    } else if (format != BLK_FORMAT_ASCII) {
+        // 超出块头记录数的槽位都是空记录
+        numOfSlots = std::min(numOfSlots, loadUInt16(blkData + 2) - firstSlot);
+        const blkData_t *colA = blkData + _attrPos(firstSlot, 0);
+        int stride = _attrPos(firstSlot + 1, 0) - _attrPos(firstSlot, 0);
+        for (; numOfDecoded < numOfSlots; ++numOfDecoded) {
+            int32_t val = loadInt32(colA + numOfDecoded * stride);
+            if (val == EMPTY_ATTR_BINARY)
+                break;
+            A[numOfDecoded] = val;
+        }
+    } else {
+        for (; numOfDecoded < numOfSlots; ++numOfDecoded) {
+            if (!parseAttrASCII(blkData + (firstSlot + numOfDecoded) * sizeOfRow, A[numOfDecoded]))
+                break;
+        }
+    }
+    // 读到空记录时cursor停在空记录上，下一次解析时直接返回0
+    cursor += numOfDecoded * sizeOfRow;
+    return numOfDecoded;
+}
+
+/**
+ * @brief 取出上一次decodeColumnA解析的第i条记录
+ * 前提：此后没有再读取该块
+ * 
+ * @param i 记录在上一次解析结果中的序号
+ * @return row_t 完整的记录
+ */
+row_t Block::decodedRow(int i) { return _readRow(decodedFrom + i * sizeOfRow); }
+
+/**
+ * @brief 向当前的Block中写入一条新记录
+ * 缓冲区写满时，自动写入磁盘
+ * 
+ * @param R 写入的记录
+ * @return addr_t 当前写入的块的地址
  */
 addr_t Block::writeRow(const row_t R) {
-    // жblockǷ
+    // 先判断block是否满
     if (cursor == endAddrOfData) {
-        // printf("һĽ");
+        // printf("满一个块的结果，");
         try {
-            addr_t next = writeBlkAddr + 1;
+            addr_t next = blkAllocator.nextBlockOf(writeBlkAddr);
+            if (next == END_OF_FILE) {
+                // 没有下一块可写，继续写入只会越过写块的末尾
+                printf("错误：磁盘地址已用完，无法继续写入！\n");
+                system("pause");
+                exit(FAIL);
+            }
             _writeAddr(next);
             _writeToDisk(writeBlkAddr);
-            if (next == END_OF_FILE) {
-                writeBlkAddr = END_OF_FILE;
-                cursor = endOfBlock;
-            } else {
-                // дд뻺
-                if ((blkData = getNewBlockInBuffer(&buff)) == NULL)
-                    throw std::bad_alloc();
-                writeBlkAddr += 1;
-                memset(blkData, 0, sizeOfRow * (numOfRowInBlk + 1));
-                cursor = BLK_START_ADDR;
+            // 写完后继续写，重新申请缓冲区
+            {
+                std::lock_guard<std::mutex> lock(buffMutex);
+                blkData = getNewBlockInBuffer(&buff);
             }
+            if (blkData == NULL)
+                throw std::bad_alloc();
+            writeBlkAddr = next;
+            memset(blkData, 0, endOfBlock);
+            cursor = BLK_START_ADDR;
         } catch(const std::bad_alloc &e) {
             std::cerr << e.what() << std::endl;
             printf("Buffer Allocation Error!\n");
@@ -154,38 +501,58 @@ addr_t Block::writeRow(const row_t R) {
             exit(FAIL);
         }
     }
-    // дݵblock
-    char a_buf[5] = "\0", b_buf[5] = "\0";
-    if (R.A < MAX_ATTR_VAL)
-        snprintf(a_buf, 5, "%-4d", R.A);
-    if (R.B < MAX_ATTR_VAL)
-        snprintf(b_buf, 5, "%-4d", R.B);
-    for (int i = 0; i < 4; ++i) {
-        if (a_buf[i] < CHAR_ZERO_ASCII || a_buf[i] > CHAR_NINE_ASCII)
-            a_buf[i] = CHAR_EMPTY_ASCII;
-        *(blkData + cursor + i) = a_buf[i];
-        if (b_buf[i] < CHAR_ZERO_ASCII || b_buf[i] > CHAR_NINE_ASCII)
-            b_buf[i] = CHAR_EMPTY_ASCII;
-        *(blkData + cursor + 4 + i) = b_buf[i];
-    }
+    // 再写数据到block上
+    _putRow(cursor, R);
     cursor += sizeOfRow;
     return writeBlkAddr;
 }
 
 /**
- * @brief ȡǰָһַ
+ * @brief 读取当前块指向的下一个地址
  * 
- * @return addr_t ȡĵַ
+ * @return addr_t 读取的地址
  */
-addr_t Block::readNextAddr() {
-    char nextAddr[8] = "\0";
-    unsigned int offset = addrOfLastRow;
-    for (int i = 0; i < 8; ++i) {
-        nextAddr[i] = *(blkData + offset + i);
-    }
-    addr_t next;
-    if (sscanf(nextAddr, "%8d", &next) < 0)
-        next = END_OF_FILE;
+addr_t Block::readNextAddr() { return parseNextAddr(blkData); }
+
+/**
+ * @brief 判断当前块是否还占用着缓冲区
+ * 读到未写满的最后一块时，getNewRow不会自动释放该块，可据此判断是否需要手动释放
+ * 
+ * @return bool 是否占用着缓冲区
+ */
+bool Block::isLoaded() { return blkData != releasedBlkData; }
+
+/**
+ * @brief 获取当前块能容纳的记录数
+ * v4格式的块以块头中记录的容量为准，其他格式由块的大小决定
+ * 
+ * @return int 块的容量
+ */
+int Block::getCapacity() {
+    if (format == BLK_FORMAT_PACKED)
+        return loadUInt16(blkData + 8);
+    return (endOfBlock - sizeOfNextAddr) / sizeOfRow;
+}
+
+/**
+ * @brief 将已装载的块转换为newFormat格式，写回原来的地址并释放该块
+ * 块中的记录和指向的下一块地址都保持不变
+ * 
+ * @param newFormat 转换后的块格式
+ * @return addr_t 该块指向的下一块地址
+ */
+addr_t Block::convertFormat(blkFormat_t newFormat) {
+    std::vector<row_t> rows(numOfRowInBlk);
+    addr_t addr = readBlkAddr, next = readNextAddr();
+    int numOfSlots = _numOfFilledSlots();
+    for (int i = 0; i < numOfSlots; ++i)
+        rows[i] = _readRow(i * sizeOfRow);
+    freeBlock();
+    writeInit(addr, numOfRowInBlk, newFormat);
+    for (int i = 0; i < numOfSlots; ++i)
+        writeRow(rows[i]);
+    _writeAddr(next);
+    _writeToDisk(addr);
     return next;
 }
 
@@ -194,13 +561,25 @@ addr_t Block::readNextAddr() {
 // -----------------------------------------------------------
 
 /**
- * @brief дַǰ
+ * @brief 写地址到当前块中
  * 
- * @param nextAddr дĵַ
+ * @param nextAddr 写入的地址
  */
 void Block::_writeAddr(addr_t nextAddr) {
+    if (format != BLK_FORMAT_ASCII) {
+        // 块头中记录本块写入的记录数
+        int numOfRows = cursor / sizeOfRow;
+        blkData[0] = blkMagicOf(format);
+        blkData[1] = format;
+        blkData[2] = numOfRows & 0xFF;
+        blkData[3] = (numOfRows >> 8) & 0xFF;
+        storeInt32(blkData + 4, (int32_t)nextAddr);
+        if (format == BLK_FORMAT_PACKED)
+            _packRows(numOfRows);
+        return;
+    }
     char buf[9];
-    unsigned int offset = addrOfLastRow;
+    unsigned int offset = endOfBlock - sizeOfNextAddr;  // 下一块地址位于块的末尾
     snprintf(buf, 8, "%-8d", nextAddr);
     for (int i = 0; i < 8; ++i) {
         if (buf[i] < CHAR_ZERO_ASCII || buf[i] > CHAR_NINE_ASCII)
@@ -210,19 +589,168 @@ void Block::_writeAddr(addr_t nextAddr) {
 }
 
 /**
- * @brief ǰд뵽
+ * @brief 将当前块的内容写入到磁盘上
  * 
- * @param addr дĴ̵ַ
+ * @param addr 写入的磁盘地址
  */
 void Block::_writeToDisk(addr_t addr) {
-    if (writeBlockToDisk(blkData, addr, &buff) != 0) {
+    int res;
+    {
+        std::lock_guard<std::mutex> lock(buffMutex);
+        res = writeBlockToDisk(blkData, addr, &buff);
+    }
+    if (res != 0) {
         printf("Fail to write to disk %d!\n", addr);
         system("pause");
         exit(FAIL);
     }
-    // printf("д̵%d\n", addr);
-    cursor = BLK_START_ADDR;    // ָ븴λ
+    // printf("写磁盘到第%d块\n", addr);
+    cursor = BLK_START_ADDR;    // 指针复位
+    blkData = releasedBlkData;  // 写出的帧成为该块在缓冲池中的缓存，不能清空
     memset(blkData, 0, endOfBlock);
+    writeBehind.notify();       // 脏块攒够一批后由写回线程写回磁盘
+}
+
+/**
+ * @brief 按当前块的格式解析位置pos处的记录
+ * 
+ * @param pos 记录在块中的位置(不含块头)
+ * @return row_t 解析出的记录，空槽位解析为空记录
+ */
+row_t Block::_readRow(cursor_t pos) {
+    row_t R;
+    if (format == BLK_FORMAT_PACKED) {
+        packed_header_t header(blkData);
+        int slot = pos / sizeOfRow;
+        if (slot >= header.numOfRows)
+            return R;
+        const blkData_t *codes = blkData + sizeOfPackedHeader;
+        uint32_t codeA = loadBits(codes, slot * header.widthA, header.widthA);
+        uint32_t codeB = loadBits(codes, header.numOfRows * header.widthA + slot * header.widthB, header.widthB);
+        R.isFilled = (codeA != EMPTY_CODE_PACKED);
+        R.A = R.isFilled ? header.decode(header.baseA, codeA) : MAX_ATTR_VAL;
+        R.B = (codeB != EMPTY_CODE_PACKED) ? header.decode(header.baseB, codeB) : MAX_ATTR_VAL;
+        return R;
+    }
+    if (format != BLK_FORMAT_ASCII) {
+        // 超出块头记录数的槽位都是空记录
+        int slot = pos / sizeOfRow;
+        if (slot >= loadUInt16(blkData + 2))
+            return R;
+        int32_t A = loadInt32(blkData + _attrPos(slot, 0)), B = loadInt32(blkData + _attrPos(slot, 1));
+        R.isFilled = (A != EMPTY_ATTR_BINARY);
+        R.A = R.isFilled ? A : MAX_ATTR_VAL;
+        R.B = (B != EMPTY_ATTR_BINARY) ? B : MAX_ATTR_VAL;
+        return R;
+    }
+    // 读取Row中的属性值A, B
+    R.isFilled = parseAttrASCII(blkData + pos, R.A);
+    if (!parseAttrASCII(blkData + pos + sizeOfAttr, R.B))
+        R.B = MAX_ATTR_VAL;
+    return R;
+}
+
+/**
+ * @brief 按当前块的格式将记录写到块中位置pos处
+ * ASCII格式只能表示[0, MAX_ATTR_VAL)内的属性值，二进制格式没有这一限制
+ * 
+ * @param pos 记录在块中的位置(不含块头)
+ * @param R 写入的记录
+ */
+void Block::_putRow(cursor_t pos, const row_t &R) {
+    if (format == BLK_FORMAT_PACKED) {
+        // 压缩时需要知道整块记录的取值范围，因此先暂存，写出时再统一压缩
+        size_t slot = pos / sizeOfRow;
+        if (slot >= packedRows.size())
+            packedRows.resize(slot + 1);
+        packedRows[slot] = R;
+        return;
+    }
+    if (format != BLK_FORMAT_ASCII) {
+        // 默认构造的空记录写为空属性
+        bool emptyA = !R.isFilled && R.A == MAX_ATTR_VAL;
+        int slot = pos / sizeOfRow;
+        storeInt32(blkData + _attrPos(slot, 0), emptyA ? EMPTY_ATTR_BINARY : R.A);
+        storeInt32(blkData + _attrPos(slot, 1), R.B);
+        return;
+    }
+    char a_buf[5] = "\0", b_buf[5] = "\0";
+    if (R.A < MAX_ATTR_VAL)
+        snprintf(a_buf, 5, "%-4d", R.A);
+    if (R.B < MAX_ATTR_VAL)
+        snprintf(b_buf, 5, "%-4d", R.B);
+    for (int i = 0; i < 4; ++i) {
+        if (a_buf[i] < CHAR_ZERO_ASCII || a_buf[i] > CHAR_NINE_ASCII)
+            a_buf[i] = CHAR_EMPTY_ASCII;
+        *(blkData + pos + i) = a_buf[i];
+        if (b_buf[i] < CHAR_ZERO_ASCII || b_buf[i] > CHAR_NINE_ASCII)
+            b_buf[i] = CHAR_EMPTY_ASCII;
+        *(blkData + pos + 4 + i) = b_buf[i];
+    }
+}
+
+/**
+ * @brief 统计当前块中写过的槽位数量
+ * ASCII块没有记录数，以最后一个非空的槽位为准
+ * 
+ * @return int 槽位数量
+ */
+int Block::_numOfFilledSlots() {
+    if (format != BLK_FORMAT_ASCII)
+        return std::min(loadUInt16(blkData + 2), numOfRowInBlk);
+    int numOfSlots = 0;
+    for (int i = 0; i < endOfBlock - sizeOfNextAddr; ++i) {
+        if (blkData[i] != CHAR_EMPTY_ASCII)
+            numOfSlots = i / sizeOfRow + 1;
+    }
+    return numOfSlots;
+}
+
+/**
+ * @brief 二进制格式的块中，第slot条记录的属性attr在块中的位置
+ * v2格式按记录逐条存放A、B属性，v3格式按属性分列存放
+ * 
+ * @param slot 记录在块中的序号
+ * @param attr 属性的序号，0为A，1为B
+ * @return cursor_t 属性值在块中的位置(含块头)
+ */
+cursor_t Block::_attrPos(int slot, int attr) {
+    if (format == BLK_FORMAT_PAX)
+        return sizeOfBlkHeader + (attr * getCapacity() + slot) * sizeOfAttr;
+    return sizeOfBlkHeader + slot * sizeOfRow + attr * sizeOfAttr;
+}
+
+/**
+ * @brief 将暂存的前numOfRows条记录压缩成v4格式写到块中
+ * 先写A的编码，再写B的编码，记录的取值范围太大而放不下时报错退出
+ * 
+ * @param numOfRows 块中的记录数
+ */
+void Block::_packRows(int numOfRows) {
+    int32_t baseA, baseB;
+    int widthA, widthB;
+    int numOfBits = packedSizeInBits(packedRows.data(), numOfRows, baseA, baseB, widthA, widthB);
+    if (numOfBits == FAIL || numOfBits > (sizeOfBlock - sizeOfPackedHeader) * 8) {
+        printf("错误：写入磁盘块%d的%d条记录取值范围太大，无法压缩进一个块中！\n", writeBlkAddr, numOfRows);
+        system("pause");
+        exit(FAIL);
+    }
+    blkData[8] = numOfRowInBlk & 0xFF;
+    blkData[9] = (numOfRowInBlk >> 8) & 0xFF;
+    blkData[10] = widthA;
+    blkData[11] = widthB;
+    storeInt32(blkData + 12, baseA);
+    storeInt32(blkData + 16, baseB);
+    blkData_t *codes = blkData + sizeOfPackedHeader;
+    memset(codes, 0, sizeOfBlock - sizeOfPackedHeader);
+    for (int i = 0; i < numOfRows; ++i) {
+        const row_t &R = packedRows[i];
+        bool emptyA = !R.isFilled && R.A == MAX_ATTR_VAL;
+        uint32_t codeA = emptyA ? EMPTY_CODE_PACKED : (uint32_t)((int64_t)R.A - baseA + 1);
+        uint32_t codeB = (R.B == MAX_ATTR_VAL) ? EMPTY_CODE_PACKED : (uint32_t)((int64_t)R.B - baseB + 1);
+        storeBits(codes, i * widthA, widthA, codeA);
+        storeBits(codes, numOfRows * widthA + i * widthB, widthB, codeB);
+    }
 }
 
 
@@ -231,43 +759,153 @@ void Block::_writeToDisk(addr_t addr) {
 // -----------------------------------------------------------
 
 /**
- * @brief ʼȫֻ
- * ʹûmainУʹûǰҪô˺һȫֻ
- * ޷ʹû
+ * @brief 解析块中指向的下一块地址
+ * 
+ * @param blkData 块的数据
+ * @return addr_t 解析出的地址
  */
-void bufferInit() {
-    if (!initBuffer(520, 64, &buff)) {
+addr_t parseNextAddr(const blkData_t *blkData) {
+    if (parseBlkFormat(blkData) != BLK_FORMAT_ASCII)
+        return (addr_t)loadInt32(blkData + 4);
+    char nextAddr[8] = "\0";
+    unsigned int offset = endOfBlock - sizeOfNextAddr;  // 下一块地址位于块的末尾
+    for (int i = 0; i < 8; ++i) {
+        nextAddr[i] = *(blkData + offset + i);
+    }
+    addr_t next;
+    if (sscanf(nextAddr, "%8d", &next) < 0)
+        next = END_OF_FILE;
+    return next;
+}
+
+
+/**
+ * @brief 将全局缓冲区中的脏块写回磁盘
+ */
+void bufferFlush() {
+    std::lock_guard<std::mutex> lock(buffMutex);
+    flushBuffer(&buff);
+}
+
+
+/**
+ * @brief 将一个文件留在缓冲池中的脏块写回磁盘，并等待该文件的块落盘
+ * 其他文件的脏块仍留在缓冲池中；文件不在地址分配器的文件表中时，写回全部脏块
+ * 
+ * @param fileStartAddr 文件的起始地址块
+ */
+void syncFile(const addr_t fileStartAddr) {
+    auto extents = blkAllocator.extentsOf(fileStartAddr);
+    std::lock_guard<std::mutex> lock(buffMutex);
+    int res = 0;
+    if (extents.empty())
+        res = flushBuffer(&buff) | syncSegmentStore();
+    for (auto &extent : extents)
+        res |= flushBlockRange(extent.first, extent.second, &buff);
+    for (auto &extent : extents)
+        res |= syncBlockRange(extent.first, extent.second);
+    if (res != 0) {
+        perror("Buffer Synchronization Failed!\n");
+        system("pause");
+        exit(FAIL);
+    }
+}
+
+
+/**
+ * @brief 程序退出前的收尾工作：停止预读和写回线程，并将脏块写回磁盘
+ */
+void bufferExit() {
+    prefetcher.stop();
+    writeBehind.stop();
+    bufferFlush();
+}
+
+
+/**
+ * @brief 按当前的配置启动全局缓冲区
+ * 若data目录下已有段文件(由segmentPacker生成)，则所有块都从段文件中读写
+ */
+void bufferStart() {
+    static bool exitRegistered = false;
+    if (!initBuffer(numOfBufBlock * (sizeOfBlock + 1), sizeOfBlock, &buff)) {
         perror("Buffer Initialization Failed!\n");
         system("pause");
         exit(FAIL);
     }
+    if (!initBufferPool(numOfPoolFrame, poolPolicy, &buff)) {
+        perror("Buffer Pool Initialization Failed!\n");
+        system("pause");
+        exit(FAIL);
+    }
+    if (!exitRegistered) {
+        atexit(bufferExit);     // 缓冲池中的脏块在程序退出前写回磁盘
+        exitRegistered = true;
+    }
+    // 多留出一个字节作为块的标记位，使其可以像缓冲块一样被释放
+    releasedBlkData = (blkData_t *)calloc(buff.blkSize + 1, sizeof(blkData_t)) + 1;
+    if (openSegmentStore(buff.blkSize, 0) == 0 && useMappedRead) {
+        if (mapSegmentStore() != 0)
+            printf("当前平台不支持内存映射，将按普通方式读块\n");
+    }
+    // 预读的块数不能超过缓冲池中用于缓存的帧数，否则预读入的块会在使用前被换出
+    prefetcher.start(std::min(numOfPrefetchBlk, (int)(buff.numFrame - buff.numAllBlk)));
+    writeBehind.start(numOfWriteBatch);
 }
 
 
 /**
- * @brief ջIOļ
+ * @brief 停止全局缓冲区：停止预读和写回线程，写回脏块并释放缓冲区
+ * 之后可以修改块的大小等配置，再调用bufferStart重新启动
  */
-void clear_Buff_IO_Count() { buff.numIO = 0; }
+void bufferStop() {
+    prefetcher.stop();
+    writeBehind.stop();
+    freeBuffer(&buff);
+    closeSegmentStore();
+    free(releasedBlkData - 1);
+    releasedBlkData = NULL;
+}
 
 
 /**
- * @brief ֻ1BlockȡһN¼
- * ȡβʱԶ黹
- * ǰ᣺blkѱʼ(ͨloadFromDiskȷ)
+ * @brief 初始化全局缓冲区
+ * 在所有使用缓冲区的main方法中，在使用缓冲区前必须要调用此函数生成一个全局缓冲区变量
+ * 否则会无法正常使用缓冲区
+ * 块的大小、缓冲区的块数等参数从配置文件和命令行参数中读取，见Config.h
  * 
- * @param readBlk ڶȡ¼Ļ
- * @param R ڶȡ¼
- * @param N ¼󳤶
- * @return int ʵʶȡļ¼
+ * @param argc 命令行参数的数量
+ * @param argv 命令行参数
+ */
+void bufferInit(int argc = 0, char *argv[] = NULL) {
+    loadConfig(argc, argv);
+    bufferStart();
+}
+
+
+/**
+ * @brief 清空缓冲区中IO的计数
+ */
+void clear_Buff_IO_Count() { buff.numIO = buff.numHit = buff.numPhysIO = 0; }
+
+
+/**
+ * @brief 只利用1个Block，连续读取一个表中最多N条记录
+ * 读取到表尾时，会自动归还缓冲区块
+ * 前提：blk必须已被初始化(通过loadFromDisk等方法)
+ * 
+ * @param readBlk 用于读取记录的缓冲区块
+ * @param R 用于读取记录数组
+ * @param N 记录数组的最大长度
+ * @return int 实际读取的记录数量
  */
 int read_N_Rows_From_1_Block(block_t &readBlk, row_t *R, int N) {
-    int totalRead = N;
-    for (int i = 0; i < N; ++i) {
-        R[i] = readBlk.getNewRow();
-        if (R[i].isFilled == false) {
-            // Щblockһ7¼һǱĩβ
-            totalRead = i;
-            break;
+    int totalRead = 0;
+    while (totalRead < N) {
+        totalRead += readBlk.decodeAll(R + totalRead, N - totalRead);
+        if (R[totalRead - 1].isFilled == false) {
+            // 有些block不一定有完整的7条记录，一般是表的末尾
+            return totalRead - 1;
         }
     }
     return totalRead;
@@ -275,55 +913,60 @@ int read_N_Rows_From_1_Block(block_t &readBlk, row_t *R, int N) {
 
 
 /**
- * @brief MBlockȡһN¼
- * ȡN¼󣬻Զһ鵽Уһζȡ
- * ȡβʱԶ黹
- * ǰ᣺Mblkѱʼ(ͨloadFromDiskȷ)
+ * @brief 利用M个Block，连续读取一个表中最多N条记录
+ * 读取完N条记录后，会自动加载下一组表块到缓冲区中，方便下一次读取
+ * 读取到表尾时，会自动归还缓冲区块
+ * 前提：所有M个blk都必须已被初始化(通过loadFromDisk等方法)
  * 
- * @param readBlk ڶȡ¼
- * @param R ڶȡ¼
- * @param N ¼󳤶
- * @param M block
- * @return int ʵʶȡļ¼
+ * @param readBlk 用于读取记录的连续缓冲区块
+ * @param R 用于读取记录数组
+ * @param N 记录数组的最大长度
+ * @param M block的最大数量
+ * @return int 实际读取的记录数量
  */
 int read_N_Rows_From_M_Block(block_t *readBlk, row_t *R, int N, int M) {
     int totalRead = 0;
-    row_t rtemp;
-    // ӵǰMжȡ¼
-    for (int i = 0; i < N; ) {
+    // 从当前的M块中读取记录，每块轮流读取一条，共读取numOfRounds轮
+    // 先将每块要读的记录一次解析出来，再按轮流的顺序合并，结果与逐条轮流读取一致
+    int numOfRounds = (N > 0) ? (N + M - 1) / M : 0;
+    std::vector<row_t> slots(M * numOfRounds + 1);
+    for (int j = 0; j < M; ++j) {
+        row_t *blkSlots = slots.data() + j * numOfRounds;
+        for (int decoded = 0; decoded < numOfRounds; )
+            decoded += readBlk[j].decodeAll(blkSlots + decoded, numOfRounds - decoded);
+    }
+    for (int i = 0; i < numOfRounds; ++i) {
         for (int j = 0; j < M; ++j) {
-            rtemp = readBlk[j].getNewRow();
-            i += 1;
-            if (rtemp.isFilled)
-                R[totalRead++] = rtemp;
+            if (slots[j * numOfRounds + i].isFilled)
+                R[totalRead++] = slots[j * numOfRounds + i];
         }
     }
     addr_t next = readBlk[M - 1].readNextAddr();
     int count = 0;
     if (next == END_OF_FILE) {
-        // һûʹãֻǴѾ黹״̬
-        // ʱĵַһEND_OF_FILEԴжǷβ
+        // 最后一块若没被使用，只可能是处于已经被归还的状态
+        // 这时读出来的地址一定是END_OF_FILE，以此判断是否读到表尾
         if (totalRead > 0) {
-            do {    // 黹ʣĻ
+            do {    // 归还剩余的缓冲区
                 next = readBlk[count].readNextAddr();
                 readBlk[count].freeBlock();
                 count += 1;
             } while(next != END_OF_FILE);
         } else {
-            // һָպöűһֲҪ黹
-            // Ϊһлѱͷ
+            // 上一轮刚好读完整张表，这一轮不需要归还缓冲区
+            // 因为在上一轮所有缓冲区都已被释放
             ;
         }
     } else {
         while(count < M && next != END_OF_FILE) {
-            // װغʣĿ飬next=END_OF_FILEʱѶ
+            // 装载后续剩余的块，当next=END_OF_FILE时表已读完
             readBlk[count].freeBlock();
-            readBlk[count].loadFromDisk(next);
+            readBlk[count].loadFromDisk(next, addrOfLastRow, true);
             next = readBlk[count].readNextAddr();
             count += 1;
         }
         for (int i = 0; i < M - count; ++i) {
-            // 黹ûϵĻ
+            // 归还没有用上的缓冲区块
             readBlk[count + i].freeBlock();
         }
     }
@@ -332,24 +975,122 @@ int read_N_Rows_From_M_Block(block_t *readBlk, row_t *R, int N, int M) {
 
 
 /**
- * @brief ɾһļµп
+ * @brief 删除一个文件下的所有块
+ * 地址分配器中记录了该文件的区段时，直接按区段删除，不读任何块
+ * 否则只能沿块链逐块读出下一块地址再删除
  * 
- * @param fileStartAddr ļʼַ
+ * @param fileStartAddr 文件的起始地址块
  */
 void DropFiles(const addr_t fileStartAddr) {
     addr_t curAddr, next = fileStartAddr;
     if (next == END_OF_FILE) {
-        printf("ɾļΪգʼַΪ%uļ޷ɾ\n", fileStartAddr);
+        printf("错误：删除文件为空，起始地址为%u的文件无法删除！\n", fileStartAddr);
         system("pause");
         exit(FAIL);
-    } else {
-        block_t delBlk;
-        do {
-            delBlk.loadFromDisk(next);
-            curAddr = next;
-            next = delBlk.readNextAddr();
-            dropBlockOnDisk(curAddr);
-            delBlk.freeBlock();
-        } while (next != END_OF_FILE);
     }
+    auto extents = blkAllocator.extentsOf(fileStartAddr);
+    if (!extents.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(buffMutex);
+            for (auto &extent : extents) {
+                for (curAddr = extent.first; curAddr <= extent.second; ++curAddr)
+                    dropBlockInBuffer(curAddr, &buff);
+            }
+        }
+        blkAllocator.dropFile(fileStartAddr);
+        return;
+    }
+    block_t delBlk;
+    do {
+        delBlk.loadFromDisk(next);
+        curAddr = next;
+        next = delBlk.readNextAddr();
+        {
+            std::lock_guard<std::mutex> lock(buffMutex);
+            dropBlockInBuffer(curAddr, &buff);
+        }
+        delBlk.freeBlock();
+    } while (next != END_OF_FILE);
+}
+
+
+/**
+ * @brief 在地址分配器中登记一个已有文件的所有块
+ * 用于登记启动前就存在于磁盘上的表，之后申请的区段不会覆盖它们
+ * 
+ * @param fileStartAddr 文件的起始地址块
+ */
+void reserveFile(const addr_t fileStartAddr) {
+    addr_t next = fileStartAddr;
+    block_t readBlk;
+    while (next != END_OF_FILE) {
+        readBlk.loadFromDisk(next);
+        blkAllocator.claim(next, fileStartAddr);
+        next = readBlk.readNextAddr();
+        readBlk.freeBlock();
+    }
+}
+
+
+/**
+ * @brief 获取一个文件所使用的块格式
+ * 
+ * @param fileStartAddr 文件的起始地址块
+ * @return blkFormat_t 文件首块的格式
+ */
+blkFormat_t detectFileFormat(const addr_t fileStartAddr) {
+    block_t readBlk;
+    readBlk.loadFromDisk(fileStartAddr);
+    blkFormat_t format = readBlk.getFormat();
+    readBlk.freeBlock();
+    return format;
+}
+
+
+/**
+ * @brief 之后写入的块沿用一个文件的块格式
+ * v4格式的文件还要按其首块记录的容量设置每块的记录数，之后的读写都按这一容量进行
+ * 
+ * @param fileStartAddr 文件的起始地址块
+ */
+void useFileFormat(const addr_t fileStartAddr) {
+    block_t readBlk;
+    readBlk.loadFromDisk(fileStartAddr);
+    writeFormat = readBlk.getFormat();
+    int capacity = readBlk.getCapacity();
+    readBlk.freeBlock();
+    if (writeFormat == BLK_FORMAT_PACKED && !setPackedCapacity(capacity)) {
+        printf("错误：起始地址为%u的文件中压缩块的容量%d不合法！\n", fileStartAddr, capacity);
+        system("pause");
+        exit(FAIL);
+    }
+}
+
+
+/**
+ * @brief 将一个文件下的所有块原地转换为format格式
+ * 每块的地址、记录和指向的下一块地址都保持不变，已是该格式的块会被跳过
+ * 文件尚未在地址分配器中登记时，转换的同时登记它的所有块
+ * 
+ * @param fileStartAddr 文件的起始地址块
+ * @param format 转换后的块格式
+ * @return int 转换的块数量
+ */
+int convertFileFormat(const addr_t fileStartAddr, blkFormat_t format) {
+    addr_t next = fileStartAddr;
+    int numOfConverted = 0;
+    block_t convBlk;
+    while (next != END_OF_FILE) {
+        convBlk.loadFromDisk(next);
+        blkAllocator.claim(next, fileStartAddr);   // 未登记的块要记在本文件名下，最后才能同步整个文件
+        if (convBlk.getFormat() == format) {
+            next = convBlk.readNextAddr();
+            convBlk.freeBlock();
+        } else {
+            next = convBlk.convertFormat(format);
+            numOfConverted += 1;
+        }
+    }
+    syncFile(fileStartAddr);
+    return numOfConverted;
 }
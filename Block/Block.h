@@ -2,6 +2,8 @@
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <mutex>
+#include <vector>
 extern "C" {
     #include "extmem.h"
 }
@@ -18,28 +20,54 @@ typedef unsigned int    file_t;
 typedef unsigned int    cursor_t;
 typedef unsigned int    addr_t;
 typedef unsigned char   blkData_t;
+typedef unsigned char   blkFormat_t;
 
-const int numOfBufBlock = 8;    // block
-const int sizeOfAttr = 4;       // һֵĳ
-const int sizeOfRow = 8;        // һ¼ĳ
-const int numOfRowInBlk = 7;    // һblockпɵļ¼
+// 以下参数可在启动时通过配置文件或命令行修改，见Config.h
+int numOfBufBlock = 8;          // 缓冲区中block的数量
+int numOfPoolFrame = 0;         // 缓冲池中帧的数量，多于numOfBufBlock的帧用于缓存最近读写过的块，为0时取numOfBufBlock的8倍
+int numOfPrefetchBlk = 4;       // 预读线程沿块链提前读入缓冲池的块数
+int numOfWriteBatch = 8;        // 写回线程每批写回磁盘的脏块数
+int poolPolicy = POLICY_CLOCK;  // 缓冲池的替换策略
+bool useMappedRead = false;     // 是否将段文件映射到内存中，读块时直接返回映射中的地址而不做拷贝
+int sizeOfBlock = 64;           // 块的大小
 
-const int addrOfLastRow = numOfRowInBlk * sizeOfRow;    // һ¼ĵַ
-const int endOfBlock = numOfRowInBlk * sizeOfRow + 8;   // ĩβַ
-const int MAX_ATTR_VAL = 10000; // Եֵ + 1ÿռ¼
+const int sizeOfAttr = 4;       // 一个属性值的长度
+const int sizeOfRow = 8;        // 一条记录的长度
+const int sizeOfNextAddr = 8;   // 块末尾下一块地址的长度
 
-// ̺ڴһЩ
+// 以下参数由块的大小决定，随sizeOfBlock一起更新
+int numOfRowInBlk = 7;          // 一个block中可容纳的记录数量
+int addrOfLastRow = numOfRowInBlk * sizeOfRow;          // 块中最后一条记录的地址
+int endOfBlock = numOfRowInBlk * sizeOfRow + sizeOfNextAddr;    // 块的末尾地址
+const int MAX_ATTR_VAL = 10000; // 属性的最大值 + 1，可用于设置空记录
+
+// 块格式：v1为ASCII文本格式，v2为二进制格式，v3为二进制的PAX格式，v4为压缩格式，读块时根据块首字节自动识别
+// v2的块头：魔数(1B) + 版本号(1B) + 记录数(2B) + 下一块地址(4B)，之后是小端int32的A、B属性
+// v3的块头与v2相同，之后先连续存放块中所有记录的A属性，再连续存放所有记录的B属性
+// v4的块头在v2块头之后还有：块的容量(2B) + A、B编码的位宽(各1B) + A、B的基准值(各4B)
+// 之后先连续存放所有A的编码，再连续存放所有B的编码，编码为属性值减去基准值再加1，0表示空属性
+const blkFormat_t BLK_FORMAT_ASCII = 1;
+const blkFormat_t BLK_FORMAT_BINARY = 2;
+const blkFormat_t BLK_FORMAT_PAX = 3;
+const blkFormat_t BLK_FORMAT_PACKED = 4;
+const blkData_t BLK_MAGIC_BINARY = 0xB2;    // v2块的首字节，ASCII块的首字节只可能是数字或0
+const blkData_t BLK_MAGIC_PAX = 0xB3;       // v3块的首字节
+const blkData_t BLK_MAGIC_PACKED = 0xB4;    // v4块的首字节
+const int sizeOfBlkHeader = 8;              // v2块头的长度
+const int sizeOfPackedHeader = 20;          // v4块头的长度
+blkFormat_t writeFormat = BLK_FORMAT_ASCII; // 新写入的块默认使用的格式
+
+// 磁盘和内存的一些参数
 const int ADDR_NOT_EXISTS = -1;
 const int DEFAULT_ADDR = 0;
-const int addrOfScan_1 = 100;   // һʼַ
-const int addrOfScan_2 = 200;   // ڶʼַ
 
-Buffer buff;   // ȫֻһ
+Buffer buff;   // 全局只定义一个缓冲区
+std::mutex buffMutex;   // 主线程与预读、写回线程互斥地访问缓冲区
 
 /**
- * @brief ԪԪ
- * ABҸҪһЩȽ
- * ڶԪԶӦֵԣҲ
+ * @brief 二元元组
+ * 有两个属性A和B，并且根据要求定义了一些比较运算符
+ * 由于二元组可以对应键值对，因此也可用作索引
  */
 typedef struct Row {
     bool isFilled = false;
@@ -55,40 +83,56 @@ typedef struct Row {
 } row_t, index_t;
 
 /**
- * @brief ӳ㣩
- * extmemĻٳһ㣬дͷŵȲװ˽ȥ
- * ͬʱһ̶˻
+ * @brief 缓冲区（映射层）
+ * 在extmem的基础上再抽象一层，将读写、申请释放等操作封装了进去
+ * 同时还在一定程度上增加了缓冲区管理功能
  */
 class Block {
 public:
     Block();
+    ~Block();
     void freeBlock();
-    void loadFromDisk(addr_t addr, cursor_t endPos = addrOfLastRow);
-    void writeInit(const file_t filename, int numOfRows = numOfRowInBlk);
-    addr_t writeLastBlock();
+    void loadFromDisk(addr_t addr, cursor_t endPos = addrOfLastRow, bool isSequential = false);
+    void writeInit(const file_t filename, int numOfRows = numOfRowInBlk, blkFormat_t newFormat = writeFormat);
+    addr_t writeLastBlock(bool isDurable = true);
     row_t getNewRow();
+    int decodeAll(row_t *R, int maxRows);
+    int decodeColumnA(int *A, int maxRows);
+    row_t decodedRow(int i);
     addr_t writeRow(const row_t R);
     addr_t readNextAddr();
+    blkFormat_t getFormat() { return format; }
+    bool isLoaded();
+    int getCapacity();
+    addr_t convertFormat(blkFormat_t newFormat);
 
 private:
     blkData_t *blkData;
+    blkFormat_t format;     // 当前块的格式
     addr_t readBlkAddr, writeBlkAddr;
-    cursor_t cursor;        // ǰĶдλ
-    cursor_t endAddrOfData; // еһ¼λ
+    cursor_t cursor;        // 缓冲区当前的读写位置
+    cursor_t endAddrOfData; // 缓冲区中的最后一条记录的位置
+    cursor_t decodedFrom;   // 上一次decodeColumnA开始解析的位置
+    std::vector<row_t> packedRows;  // v4格式的块写出前暂存的记录，写出时统一压缩
     void _writeAddr(unsigned int nextAddr);
     void _writeToDisk(addr_t addr);
+    row_t _readRow(cursor_t pos);
+    void _putRow(cursor_t pos, const row_t &R);
+    int _numOfFilledSlots();
+    cursor_t _attrPos(int slot, int attr);
+    void _packRows(int numOfRows);
 };
 
 typedef Block block_t;
 
 /**
- * @brief ¼һЩϢ
+ * @brief 记录表的一些基本信息
  */
 typedef struct Table {
-    addr_t start;   // Ŀʼ̵ַ
-    addr_t end;     // Ľ̵ַ
-    int size;       // ļ¼
-    int rowSize;    // ļ¼
+    addr_t start;   // 表的开始磁盘地址
+    addr_t end;     // 表的结束磁盘地址
+    int size;       // 表的记录总数量
+    int rowSize;    // 表的记录长度
     Table(addr_t newStart = 0, int newSize = 0, addr_t newEnd = 0, int newRowSize = sizeOfRow): 
         start(newStart), end(newEnd), size(newSize), rowSize(newRowSize)
     {}
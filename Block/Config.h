@@ -0,0 +1,194 @@
+#include <cctype>
+#include <fstream>
+#include <string>
+#include "Block.h"
+#pragma once
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+/**
+ * @brief 缓冲区与块的运行时配置
+ * 配置依次来自Block.h中的默认值、配置文件和命令行参数，后者覆盖前者
+ * 配置文件默认为当前目录下的buffer.conf(不存在时忽略)，也可用--config=<文件名>指定
+ * 配置文件中每行一项，格式为 key = value，#之后的内容为注释；命令行参数的格式为 --key=value
+ * 
+ * block_size       块的大小(字节)，须为8的倍数，取值范围为[64, 65536]
+ * buffer_blocks    缓冲区中的块数，各操作的分组大小、散列桶数等都由它推导
+ * pool_frames      缓冲池的帧数，不少于buffer_blocks，为0或不指定时取buffer_blocks的8倍
+ * prefetch_blocks  沿块链预读的块数，为0时不预读
+ * write_batch      写回线程每批写回的脏块数，为0时不启动写回线程
+ * policy           缓冲池的替换策略，取值为clock、lru或2q
+ * mmap             是否将段文件映射到内存中读取，取值为0或1
+ * 
+ * 注意：块的大小决定了磁盘上的数据格式，必须与数据生成(或用formatConverter转换)时所用的块大小一致
+ */
+
+const char *defaultConfigFile = "buffer.conf";
+const int minBlockSize = 64, maxBlockSize = 65536;
+const int minBufBlock = 4;
+const int maxPackedCapacity = 0xFFFF;   // v4块头中容量字段的最大值
+
+/**
+ * @brief 设置块的大小，并更新由块的大小决定的各个参数
+ * 
+ * @param blkSize 块的大小(字节)
+ * @return bool 块的大小是否合法
+ */
+bool setBlockSize(int blkSize) {
+    if (blkSize < minBlockSize || blkSize > maxBlockSize || blkSize % sizeOfRow != 0)
+        return false;
+    sizeOfBlock = blkSize;
+    numOfRowInBlk = (sizeOfBlock - sizeOfNextAddr) / sizeOfRow;
+    addrOfLastRow = numOfRowInBlk * sizeOfRow;
+    endOfBlock = addrOfLastRow + sizeOfNextAddr;
+    return true;
+}
+
+/**
+ * @brief 按v4格式的块容量设置每块的记录数
+ * v4格式的块经过压缩，能容纳的记录数多于按块大小算出的记录数，读写v4格式的表之前要先调用此函数
+ * 块在磁盘和缓冲区中的大小不变，因此endOfBlock保持不变
+ * 
+ * @param capacity 每块的记录数
+ * @return bool 容量是否合法
+ */
+bool setPackedCapacity(int capacity) {
+    if (capacity < (sizeOfBlock - sizeOfNextAddr) / sizeOfRow || capacity > maxPackedCapacity)
+        return false;
+    numOfRowInBlk = capacity;
+    addrOfLastRow = numOfRowInBlk * sizeOfRow;
+    return true;
+}
+
+/**
+ * @brief 应用一条配置项
+ * 
+ * @param key 配置项的名称，其中的'-'视同'_'
+ * @param value 配置项的值
+ * @return int 成功返回OK；名称未知返回1；值不合法返回FAIL
+ */
+int applyConfigItem(std::string key, const std::string &value) {
+    for (char &ch : key) {
+        if (ch == '-')
+            ch = '_';
+    }
+    char *end = NULL;
+    long num = strtol(value.c_str(), &end, 10);
+    bool isNum = !value.empty() && *end == '\0' && num >= 0;
+
+    if (key == "block_size") {
+        if (!isNum || !setBlockSize((int)num))
+            return FAIL;
+    } else if (key == "buffer_blocks") {
+        if (!isNum || num < minBufBlock)
+            return FAIL;
+        numOfBufBlock = (int)num;
+    } else if (key == "pool_frames") {
+        if (!isNum)
+            return FAIL;
+        numOfPoolFrame = (int)num;
+    } else if (key == "prefetch_blocks") {
+        if (!isNum)
+            return FAIL;
+        numOfPrefetchBlk = (int)num;
+    } else if (key == "write_batch") {
+        if (!isNum)
+            return FAIL;
+        numOfWriteBatch = (int)num;
+    } else if (key == "policy") {
+        if (value == "clock")
+            poolPolicy = POLICY_CLOCK;
+        else if (value == "lru")
+            poolPolicy = POLICY_LRU;
+        else if (value == "2q")
+            poolPolicy = POLICY_2Q;
+        else
+            return FAIL;
+    } else if (key == "mmap") {
+        if (!isNum || num > 1)
+            return FAIL;
+        useMappedRead = (num == 1);
+    } else {
+        return 1;
+    }
+    return OK;
+}
+
+/**
+ * @brief 去掉字符串首尾的空白字符
+ */
+std::string trimSpace(const std::string &str) {
+    size_t first = 0, last = str.size();
+    while (first < last && isspace((unsigned char)str[first]))
+        first += 1;
+    while (last > first && isspace((unsigned char)str[last - 1]))
+        last -= 1;
+    return str.substr(first, last - first);
+}
+
+/**
+ * @brief 从配置文件中读取配置
+ * 
+ * @param filename 配置文件名
+ * @return bool 配置文件是否存在
+ */
+bool loadConfigFile(const char *filename) {
+    std::ifstream fin(filename);
+    if (!fin)
+        return false;
+    std::string line;
+    for (int lineNo = 1; std::getline(fin, line); ++lineNo) {
+        line = trimSpace(line.substr(0, line.find('#')));
+        if (line.empty())
+            continue;
+        size_t pos = line.find('=');
+        int res = (pos == std::string::npos) ? FAIL :
+            applyConfigItem(trimSpace(line.substr(0, pos)), trimSpace(line.substr(pos + 1)));
+        if (res != OK) {
+            printf("配置文件%s第%d行有误：%s\n", filename, lineNo, line.c_str());
+            system("pause");
+            exit(FAIL);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 读取配置文件和命令行参数中的配置
+ * 命令行中不以--开头的参数和未知的配置项会被忽略，留给各个程序自己处理
+ * 
+ * @param argc 命令行参数的数量
+ * @param argv 命令行参数
+ */
+void loadConfig(int argc, char *argv[]) {
+    const char *configFile = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--config=", 9) == 0)
+            configFile = argv[i] + 9;
+    }
+    if (configFile == NULL)
+        loadConfigFile(defaultConfigFile);
+    else if (!loadConfigFile(configFile)) {
+        printf("配置文件%s不存在！\n", configFile);
+        system("pause");
+        exit(FAIL);
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t pos = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || pos == std::string::npos)
+            continue;
+        if (applyConfigItem(arg.substr(2, pos - 2), arg.substr(pos + 1)) == FAIL) {
+            printf("命令行参数有误：%s\n", argv[i]);
+            system("pause");
+            exit(FAIL);
+        }
+    }
+    if (numOfPoolFrame == 0)
+        numOfPoolFrame = 8 * numOfBufBlock;
+    else if (numOfPoolFrame < numOfBufBlock)
+        numOfPoolFrame = numOfBufBlock;
+}
+
+#endif // !CONFIG_H
@@ -0,0 +1,128 @@
+#include <thread>
+#include <atomic>
+#include <deque>
+#include <condition_variable>
+#include "Block.h"
+#pragma once
+
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+addr_t parseNextAddr(const blkData_t *blkData);
+
+/**
+ * @brief 块链预读器
+ * 每张表都是一条由块末尾的后继地址串起来的链，顺序读取时下一块的地址在读入当前块后即可得知
+ * 预读器在后台线程中沿着块链向前读入若干块到缓冲池的空闲帧中，使得读盘与主线程的解码重叠进行
+ * 预读入的块不计入numIO，主线程真正读取它们时会在缓冲池中命中
+ */
+class Prefetcher {
+public:
+    Prefetcher() { stopping = false; depth = 0; }
+    ~Prefetcher() { stop(); }
+    void start(int numOfBlocks);
+    void stop();
+    void request(addr_t nextAddr);
+
+private:
+    void run();
+    void prefetchChain(addr_t addr);
+
+    std::thread worker;
+    std::mutex queueMutex;
+    std::condition_variable queueCond;
+    std::deque<addr_t> pending;     // 等待预读的块链起始地址
+    std::atomic<bool> stopping;
+    int depth;                      // 沿块链预读的块数
+};
+
+const size_t maxPendingChains = 8;  // 等待预读的块链数量上限，超出时丢弃最早的请求
+
+/**
+ * @brief 启动预读线程
+ * 
+ * @param numOfBlocks 每次沿块链预读的块数，为0时不启动预读
+ */
+void Prefetcher::start(int numOfBlocks) {
+    stop();
+    depth = numOfBlocks;
+    if (depth <= 0)
+        return;
+    stopping = false;
+    worker = std::thread(&Prefetcher::run, this);
+}
+
+/**
+ * @brief 停止预读线程，未完成的预读请求将被丢弃
+ */
+void Prefetcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+        pending.clear();
+    }
+    queueCond.notify_one();
+    if (worker.joinable())
+        worker.join();
+}
+
+/**
+ * @brief 提交一个预读请求
+ * 
+ * @param nextAddr 刚读入的块的后继地址，预读从这一块开始
+ */
+void Prefetcher::request(addr_t nextAddr) {
+    if (nextAddr == END_OF_FILE || !worker.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for (auto iter = pending.begin(); iter != pending.end(); ++iter) {
+            if (*iter == nextAddr)
+                return;
+        }
+        if (pending.size() >= maxPendingChains)
+            pending.pop_front();
+        pending.push_back(nextAddr);
+    }
+    queueCond.notify_one();
+}
+
+/**
+ * @brief 预读线程的主循环
+ */
+void Prefetcher::run() {
+    while (1) {
+        addr_t addr;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCond.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (stopping)
+                return;
+            addr = pending.front();
+            pending.pop_front();
+        }
+        prefetchChain(addr);
+    }
+}
+
+/**
+ * @brief 从addr开始沿块链预读depth块
+ * 每读一块都单独加锁，使主线程可以在两次读盘之间访问缓冲区
+ * 
+ * @param addr 预读的起始块地址
+ */
+void Prefetcher::prefetchChain(addr_t addr) {
+    for (int i = 0; i < depth && addr != END_OF_FILE; ++i) {
+        std::lock_guard<std::mutex> lock(buffMutex);
+        if (stopping)
+            return;
+        blkData_t *blkData = prefetchBlock(addr, &buff);
+        if (blkData == NULL)
+            return;
+        addr = parseNextAddr(blkData);
+    }
+}
+
+Prefetcher prefetcher;  // 全局的预读器
+
+#endif // !PREFETCHER_H
@@ -0,0 +1,100 @@
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include "Block.h"
+#pragma once
+
+#ifndef WRITE_BEHIND_H
+#define WRITE_BEHIND_H
+
+/**
+ * @brief 后台写回器
+ * 写块时块只是作为脏块留在缓冲池中，写回器在后台线程中攒够一批脏块后按地址顺序统一写回磁盘
+ * 使用段文件时地址连续的脏块合并成一次写入，使写盘与主线程的计算重叠进行
+ * 写回不改变numIO的计数，只影响实际读写磁盘的次数
+ */
+class WriteBehind {
+public:
+    WriteBehind() { stopping = false; notified = false; batch = 0; }
+    ~WriteBehind() { stop(); }
+    void start(int numOfBlocks);
+    void stop();
+    void notify();
+
+private:
+    void run();
+
+    std::thread worker;
+    std::mutex waitMutex;
+    std::condition_variable waitCond;
+    std::atomic<bool> stopping;
+    bool notified;                  // 是否有新的脏块产生
+    int batch;                      // 每批写回的块数
+};
+
+/**
+ * @brief 启动写回线程
+ * 
+ * @param numOfBlocks 攒够多少个脏块后写回一批，为0时不启动写回线程
+ */
+void WriteBehind::start(int numOfBlocks) {
+    stop();
+    batch = numOfBlocks;
+    if (batch <= 0)
+        return;
+    stopping = false;
+    worker = std::thread(&WriteBehind::run, this);
+}
+
+/**
+ * @brief 停止写回线程，剩余的脏块由调用者负责写回
+ */
+void WriteBehind::stop() {
+    {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        stopping = true;
+    }
+    waitCond.notify_one();
+    if (worker.joinable())
+        worker.join();
+}
+
+/**
+ * @brief 通知写回线程有新的脏块产生
+ */
+void WriteBehind::notify() {
+    if (!worker.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        notified = true;
+    }
+    waitCond.notify_one();
+}
+
+/**
+ * @brief 写回线程的主循环
+ * 每写回一批都单独加锁，使主线程可以在两批之间访问缓冲区
+ */
+void WriteBehind::run() {
+    while (1) {
+        {
+            std::unique_lock<std::mutex> lock(waitMutex);
+            waitCond.wait(lock, [this] { return stopping || notified; });
+            if (stopping)
+                return;
+            notified = false;
+        }
+        while (!stopping) {
+            std::lock_guard<std::mutex> lock(buffMutex);
+            if (buff.numDirty < (size_t)batch)
+                break;
+            if (flushDirtyBlocks(batch, &buff) <= 0)
+                break;
+        }
+    }
+}
+
+WriteBehind writeBehind;  // 全局的写回器
+
+#endif // !WRITE_BEHIND_H
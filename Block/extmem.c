@@ -7,35 +7,590 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 #include "extmem.h"
 
+#ifdef _WIN32
+#define SEG_OPEN_FLAGS (O_RDWR | O_BINARY)
+#else
+#define SEG_OPEN_FLAGS O_RDWR
+#endif
+
+static int segFd[MAX_NUM_SEGMENT]; /* File descriptors of the segment files */
+static int segOpened = 0; /* Whether the segment store is in use */
+static size_t segBlkSize = 0; /* Block size of the segment store */
+static unsigned char *segMap[MAX_NUM_SEGMENT]; /* Read-only mappings of the segments */
+static int segMapped = 0; /* Whether blocks are read through the mappings */
+
+/* Return the file descriptor of the segment holding the block addr,
+ * creating and preallocating the segment file when create is set.
+ */
+static int getSegment(unsigned int addr, int create)
+{
+    char filename[40];
+    unsigned int seg = addr / SEGMENT_NUM_BLK;
+    int fd;
+
+    if (seg >= MAX_NUM_SEGMENT)
+        return -1;
+
+    if (segFd[seg] >= 0)
+        return segFd[seg];
+
+    sprintf(filename, "data/segment_%u.dat", seg);
+    fd = open(filename, SEG_OPEN_FLAGS);
+
+    if (fd < 0 && create)
+    {
+        fd = open(filename, SEG_OPEN_FLAGS | O_CREAT, 0644);
+
+        if (fd < 0)
+            return -1;
+
+#ifdef _WIN32
+        _chsize_s(fd, (long long)SEGMENT_NUM_BLK * segBlkSize);
+#else
+        if (ftruncate(fd, (off_t)SEGMENT_NUM_BLK * segBlkSize) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+#endif
+    }
+
+    segFd[seg] = fd;
+    return fd;
+}
+
+/* Read or write the block addr at its offset inside the segment. */
+static int segmentIO(int write, unsigned int addr, unsigned char *blkPtr)
+{
+    int fd = getSegment(addr, write);
+    long long offset = (long long)(addr % SEGMENT_NUM_BLK) * segBlkSize;
+    long n;
+
+    if (fd < 0)
+        return -1;
+
+#ifdef _WIN32
+    if (_lseeki64(fd, offset, SEEK_SET) < 0)
+        return -1;
+    n = write ? _write(fd, blkPtr, (unsigned int)segBlkSize)
+              : _read(fd, blkPtr, (unsigned int)segBlkSize);
+#else
+    n = write ? pwrite(fd, blkPtr, segBlkSize, (off_t)offset)
+              : pread(fd, blkPtr, segBlkSize, (off_t)offset);
+#endif
+
+    return (n == (long)segBlkSize) ? 0 : -1;
+}
+
+/* Write numBlk consecutive blocks starting at addr with a single call.
+ * The blocks must all lie inside the same segment.
+ */
+static int segmentWriteRun(unsigned int addr, unsigned char *runPtr, size_t numBlk)
+{
+    int fd = getSegment(addr, 1);
+    long long offset = (long long)(addr % SEGMENT_NUM_BLK) * segBlkSize;
+    size_t len = numBlk * segBlkSize;
+    long n;
+
+    if (fd < 0)
+        return -1;
+
+#ifdef _WIN32
+    if (_lseeki64(fd, offset, SEEK_SET) < 0)
+        return -1;
+    n = _write(fd, runPtr, (unsigned int)len);
+#else
+    n = pwrite(fd, runPtr, len, (off_t)offset);
+#endif
+
+    return (n == (long)len) ? 0 : -1;
+}
+
+/* Return the address of the block addr inside the mapping of its segment,
+ * mapping the segment on first use.
+ */
+static unsigned char *getMapping(unsigned int addr)
+{
+#ifdef _WIN32
+    return NULL;
+#else
+    unsigned int seg = addr / SEGMENT_NUM_BLK;
+    void *map;
+    int fd;
+
+    if (!segMapped || seg >= MAX_NUM_SEGMENT)
+        return NULL;
+
+    if (!segMap[seg])
+    {
+        if ((fd = getSegment(addr, 0)) < 0)
+            return NULL;
+
+        map = mmap(NULL, SEGMENT_NUM_BLK * segBlkSize, PROT_READ, MAP_SHARED, fd, 0);
+
+        if (map == MAP_FAILED)
+            return NULL;
+
+        segMap[seg] = (unsigned char *)map;
+    }
+
+    return segMap[seg] + (addr % SEGMENT_NUM_BLK) * segBlkSize;
+#endif
+}
+
+/* A block that has never been written (or has been dropped) is all zero. */
+static int isEmptyBlock(unsigned char *blkPtr, size_t blkSize)
+{
+    size_t i;
+
+    for (i = 0; i < blkSize; i++)
+        if (blkPtr[i])
+            return 0;
+
+    return 1;
+}
+
+/* Return the frame number of a pointer into the pool, or -1 if the
+ * pointer does not belong to the pool (e.g. it points into a mapping).
+ */
+static int getFrameNo(unsigned char *blk, Buffer *buf)
+{
+    if (blk <= buf->data || blk >= buf->data + (buf->blkSize + 1) * buf->numFrame)
+        return -1;
+
+    return (int)((blk - buf->data - 1) / (buf->blkSize + 1));
+}
+
+static unsigned char *getFrameData(int frameNo, Buffer *buf)
+{
+    return buf->data + (buf->blkSize + 1) * frameNo + 1;
+}
+
+static size_t hashAddr(unsigned int addr, Buffer *buf)
+{
+    return (addr * 2654435761u) % buf->pageTableSize;
+}
+
+/* Look up the frame caching the block addr in the page table. */
+static int lookupPage(unsigned int addr, Buffer *buf)
+{
+    int i = buf->pageTable[hashAddr(addr, buf)];
+
+    while (i >= 0 && buf->frames[i].addr != addr)
+        i = buf->frames[i].hashNext;
+
+    return i;
+}
+
+static void insertPage(int frameNo, unsigned int addr, Buffer *buf)
+{
+    size_t h = hashAddr(addr, buf);
+
+    buf->frames[frameNo].addr = addr;
+    buf->frames[frameNo].valid = 1;
+    buf->frames[frameNo].hashNext = buf->pageTable[h];
+    buf->pageTable[h] = frameNo;
+}
+
+static void removePage(int frameNo, Buffer *buf)
+{
+    int *link = &buf->pageTable[hashAddr(buf->frames[frameNo].addr, buf)];
+
+    while (*link >= 0 && *link != frameNo)
+        link = &buf->frames[*link].hashNext;
+
+    if (*link == frameNo)
+        *link = buf->frames[frameNo].hashNext;
+
+    if (buf->frames[frameNo].dirty)
+        buf->numDirty--;
+
+    buf->frames[frameNo].valid = 0;
+    buf->frames[frameNo].dirty = 0;
+    buf->frames[frameNo].hashNext = -1;
+}
+
+/* Read the block addr from the disk, bypassing the buffer pool. */
+static int readPhysical(unsigned int addr, unsigned char *blkPtr, size_t blkSize)
+{
+    char filename[40] = "\0";
+    unsigned char *bytePtr;
+    char ch;
+
+    if (segOpened)
+        return (segmentIO(0, addr, blkPtr) != 0 || isEmptyBlock(blkPtr, blkSize)) ? -1 : 0;
+
+    sprintf(filename, "data/%d.blk", addr);
+    FILE *fp = fopen(filename, "r");
+
+    if (!fp)
+        return -1;
+
+    for (bytePtr = blkPtr; bytePtr < blkPtr + blkSize; bytePtr++)
+    {
+        ch = fgetc(fp);
+        *bytePtr = ch;
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+/* Write the block addr to the disk, bypassing the buffer pool. */
+static int writePhysical(unsigned int addr, unsigned char *blkPtr, size_t blkSize)
+{
+    char filename[40];
+    unsigned char *bytePtr;
+
+    if (segOpened)
+        return segmentIO(1, addr, blkPtr);
+
+    sprintf(filename, "data/%d.blk", addr);
+    FILE *fp = fopen(filename, "w");
+
+    if (!fp)
+        return -1;
+
+    for (bytePtr = blkPtr; bytePtr < blkPtr + blkSize; bytePtr++)
+        fputc((int)(*bytePtr), fp);
+
+    fclose(fp);
+    return 0;
+}
+
+/* Write a dirty frame back to the disk. */
+static int flushFrame(int frameNo, Buffer *buf)
+{
+    Frame *frame = &buf->frames[frameNo];
+
+    if (!frame->valid || !frame->dirty)
+        return 0;
+
+    if (writePhysical(frame->addr, getFrameData(frameNo, buf), buf->blkSize) != 0)
+    {
+        perror("Writing Block Failed!\n");
+        return -1;
+    }
+
+    frame->dirty = 0;
+    buf->numDirty--;
+    buf->numPhysIO++;
+    return 0;
+}
+
+typedef struct tagDirtyPage {
+    unsigned int addr;
+    int frameNo;
+} DirtyPage;
+
+static int compareDirtyPage(const void *a, const void *b)
+{
+    unsigned int x = ((const DirtyPage*)a)->addr, y = ((const DirtyPage*)b)->addr;
+    return (x > y) - (x < y);
+}
+
+/* Write a run of dirty pages with consecutive addresses to the disk.
+ * Inside the segment store the run is gathered and written at once.
+ */
+static int flushRun(DirtyPage *run, size_t numBlk, Buffer *buf)
+{
+    unsigned char *runPtr;
+    size_t i;
+    int res;
+
+    if (numBlk == 1 || !segOpened)
+    {
+        for (i = 0, res = 0; i < numBlk; i++)
+            if (flushFrame(run[i].frameNo, buf) != 0)
+                res = -1;
+        return res;
+    }
+
+    runPtr = (unsigned char*)malloc(numBlk * buf->blkSize);
+
+    if (!runPtr)
+        return -1;
+
+    for (i = 0; i < numBlk; i++)
+        memcpy(runPtr + i * buf->blkSize, getFrameData(run[i].frameNo, buf), buf->blkSize);
+
+    res = segmentWriteRun(run[0].addr, runPtr, numBlk);
+    free(runPtr);
+
+    if (res != 0)
+    {
+        perror("Writing Block Failed!\n");
+        return -1;
+    }
+
+    for (i = 0; i < numBlk; i++)
+        buf->frames[run[i].frameNo].dirty = 0;
+
+    buf->numDirty -= numBlk;
+    buf->numPhysIO += numBlk;
+    return 0;
+}
+
+/* Record an access to a frame for the replacement policy. */
+static void touchFrame(int frameNo, int isHit, Buffer *buf)
+{
+    Frame *frame = &buf->frames[frameNo];
+
+    frame->refBit = 1;
+    frame->stamp = ++buf->clock;
+
+    if (!isHit)
+        frame->queue = QUEUE_A1;
+    else if (frame->queue == QUEUE_A1)
+        frame->queue = QUEUE_AM;
+}
+
+/* Choose an unpinned frame caching a block to be evicted. */
+static int chooseVictim(Buffer *buf)
+{
+    size_t i, numA1 = 0;
+    int victim = -1, victimA1 = -1;
+    Frame *frames = buf->frames;
+
+    if (buf->policy == POLICY_CLOCK)
+    {
+        /* Every unpinned frame is met at most twice by the hand */
+        for (i = 0; i < 2 * buf->numFrame; i++)
+        {
+            size_t hand = buf->clockHand;
+
+            buf->clockHand = (hand + 1) % buf->numFrame;
+
+            if (frames[hand].pinCount > 0)
+                continue;
+
+            if (!frames[hand].refBit)
+                return (int)hand;
+
+            frames[hand].refBit = 0;
+        }
+
+        return -1;
+    }
+
+    for (i = 0; i < buf->numFrame; i++)
+    {
+        if (frames[i].pinCount > 0)
+            continue;
+
+        if (buf->policy == POLICY_2Q && frames[i].queue == QUEUE_A1)
+        {
+            numA1++;
+
+            if (victimA1 < 0 || frames[i].stamp < frames[victimA1].stamp)
+                victimA1 = (int)i;
+        }
+        else if (victim < 0 || frames[i].stamp < frames[victim].stamp)
+            victim = (int)i;
+    }
+
+    /* 2Q: evict from the FIFO A1 while it holds more than a quarter of the pool */
+    if (victimA1 >= 0 && (victim < 0 || numA1 > buf->numFrame / 4))
+        return victimA1;
+
+    return victim;
+}
+
+/* Get an unpinned frame for a new block, evicting a cached block if needed. */
+static int allocFrame(Buffer *buf)
+{
+    size_t i;
+    int frameNo = -1;
+
+    for (i = 0; i < buf->numFrame; i++)
+    {
+        if (buf->frames[i].pinCount == 0 && !buf->frames[i].valid)
+        {
+            frameNo = (int)i;
+            break;
+        }
+    }
+
+    if (frameNo < 0)
+    {
+        if ((frameNo = chooseVictim(buf)) < 0)
+            return -1;
+
+        if (flushFrame(frameNo, buf) != 0)
+            return -1;
+
+        removePage(frameNo, buf);
+    }
+
+    buf->frames[frameNo].pinCount = 1;
+    buf->frames[frameNo].refBit = 0;
+    *(getFrameData(frameNo, buf) - 1) = BLOCK_UNAVAILABLE;
+    return frameNo;
+}
+
+/* Unpin a frame; a frame not caching any block becomes free. */
+static void unpinFrame(int frameNo, Buffer *buf)
+{
+    Frame *frame = &buf->frames[frameNo];
+
+    if (frame->pinCount > 0)
+        frame->pinCount--;
+
+    if (frame->pinCount == 0)
+        *(getFrameData(frameNo, buf) - 1) = BLOCK_AVAILABLE;
+}
+
 Buffer *initBuffer(size_t bufSize, size_t blkSize, Buffer *buf)
 {
     buf->numIO = 0;
+    buf->numHit = 0;
+    buf->numPhysIO = 0;
     buf->bufSize = bufSize;
     buf->blkSize = blkSize;
     buf->numAllBlk = bufSize / (blkSize + 1);
     buf->numFreeBlk = buf->numAllBlk;
-    buf->data = (unsigned char*)malloc(bufSize * sizeof(unsigned char));
+    buf->data = NULL;
+    buf->frames = NULL;
+    buf->pageTable = NULL;
 
-    if (!buf->data)
+    if (!initBufferPool(buf->numAllBlk, POLICY_CLOCK, buf))
     {
         perror("Buffer Initialization Failed!\n");
         return NULL;
     }
 
-    memset(buf->data, 0, bufSize * sizeof(unsigned char));
     return buf;
 }
 
+Buffer *initBufferPool(size_t numFrame, int policy, Buffer *buf)
+{
+    size_t i;
+
+    if (buf->data)
+        flushBuffer(buf);
+
+    if (numFrame < buf->numAllBlk)
+        numFrame = buf->numAllBlk;
+
+    free(buf->data);
+    free(buf->frames);
+    free(buf->pageTable);
+
+    buf->numFrame = numFrame;
+    buf->numDirty = 0;
+    buf->pageTableSize = 2 * numFrame + 1;
+    buf->policy = policy;
+    buf->clockHand = 0;
+    buf->clock = 0;
+    buf->data = (unsigned char*)malloc((buf->blkSize + 1) * numFrame * sizeof(unsigned char));
+    buf->frames = (Frame*)calloc(numFrame, sizeof(Frame));
+    buf->pageTable = (int*)malloc(buf->pageTableSize * sizeof(int));
+
+    if (!buf->data || !buf->frames || !buf->pageTable)
+        return NULL;
+
+    memset(buf->data, 0, (buf->blkSize + 1) * numFrame * sizeof(unsigned char));
+
+    for (i = 0; i < numFrame; i++)
+        buf->frames[i].hashNext = -1;
+
+    for (i = 0; i < buf->pageTableSize; i++)
+        buf->pageTable[i] = -1;
+
+    return buf;
+}
+
+static int flushDirtyRange(size_t maxNumBlk, unsigned int first, unsigned int last, Buffer *buf);
+
+int flushBuffer(Buffer *buf)
+{
+    return flushDirtyBlocks(buf->numFrame, buf) < 0 ? -1 : 0;
+}
+
+int flushDirtyBlocks(size_t maxNumBlk, Buffer *buf)
+{
+    return flushDirtyRange(maxNumBlk, 0, ~0u, buf);
+}
+
+int flushBlockRange(unsigned int first, unsigned int last, Buffer *buf)
+{
+    return flushDirtyRange(buf->numFrame, first, last, buf) < 0 ? -1 : 0;
+}
+
+/* Write at most maxNumBlk dirty blocks with addresses in [first, last]
+ * back to the disk, lowest addresses first.
+ */
+static int flushDirtyRange(size_t maxNumBlk, unsigned int first, unsigned int last, Buffer *buf)
+{
+    DirtyPage *pages;
+    size_t i, j, numPage = 0;
+    int res = 0;
+
+    if (buf->numDirty == 0 || maxNumBlk == 0)
+        return 0;
+
+    pages = (DirtyPage*)malloc(buf->numDirty * sizeof(DirtyPage));
+
+    if (!pages)
+        return -1;
+
+    for (i = 0; i < buf->numFrame && numPage < buf->numDirty; i++)
+    {
+        if (buf->frames[i].valid && buf->frames[i].dirty
+            && buf->frames[i].addr >= first && buf->frames[i].addr <= last)
+        {
+            pages[numPage].addr = buf->frames[i].addr;
+            pages[numPage].frameNo = (int)i;
+            numPage++;
+        }
+    }
+
+    /* Write the blocks in the order of their addresses */
+    qsort(pages, numPage, sizeof(DirtyPage), compareDirtyPage);
+
+    if (numPage > maxNumBlk)
+        numPage = maxNumBlk;
+
+    for (i = 0; i < numPage; i = j)
+    {
+        for (j = i + 1; j < numPage; j++)
+            if (pages[j].addr != pages[j - 1].addr + 1 || pages[j].addr % SEGMENT_NUM_BLK == 0)
+                break;
+
+        if (flushRun(pages + i, j - i, buf) != 0)
+            res = -1;
+    }
+
+    free(pages);
+    return res < 0 ? -1 : (int)numPage;
+}
+
 void freeBuffer(Buffer *buf)
 {
+    flushBuffer(buf);
     free(buf->data);
+    free(buf->frames);
+    free(buf->pageTable);
+    buf->data = NULL;
+    buf->frames = NULL;
+    buf->pageTable = NULL;
+    buf->numFrame = 0;
+    buf->numDirty = 0;
 }
 
 unsigned char *getNewBlockInBuffer(Buffer *buf)
 {
-    unsigned char *blkPtr;
+    int frameNo;
 
     if (buf->numFreeBlk == 0)
     {
@@ -43,47 +598,86 @@ unsigned char *getNewBlockInBuffer(Buffer *buf)
         return NULL;
     }
 
-    blkPtr = buf->data;
-
-    while (blkPtr < buf->data + (buf->blkSize + 1) * buf->numAllBlk)
+    if ((frameNo = allocFrame(buf)) < 0)
     {
-        if (*blkPtr == BLOCK_AVAILABLE)
-            break;
-        else
-            blkPtr += buf->blkSize + 1;
+        perror("Buffer is full!\n");
+        return NULL;
     }
 
-    *blkPtr = BLOCK_UNAVAILABLE;
     buf->numFreeBlk--;
-    return blkPtr + 1;
+    return getFrameData(frameNo, buf);
 }
 
 void freeBlockInBuffer(unsigned char *blk, Buffer *buf)
 {
-    *(blk - 1) = BLOCK_AVAILABLE;
+    int frameNo = getFrameNo(blk, buf);
+
+    if (frameNo >= 0)
+        unpinFrame(frameNo, buf);
+
     buf->numFreeBlk++;
 }
 
-int dropBlockOnDisk(unsigned int addr)
+/* Remove the block addr from the disk. */
+static int dropPhysical(unsigned int addr, int quiet)
 {
     char filename[40];
 
+    if (segOpened)
+    {
+        unsigned char *zero = (unsigned char *)calloc(segBlkSize, 1);
+        int res = zero ? segmentIO(1, addr, zero) : -1;
+
+        free(zero);
+
+        if (res != 0 && !quiet)
+            perror("Dropping Block Fails!\n");
+
+        return res;
+    }
+
     sprintf(filename, "data/%d.blk", addr);
 
     if (remove(filename) == -1)
     {
-        perror("Dropping Block Fails!\n");
+        if (!quiet)
+            perror("Dropping Block Fails!\n");
         return -1;
     }
 
     return 0;
 }
 
+int dropBlockOnDisk(unsigned int addr)
+{
+    return dropPhysical(addr, 0);
+}
+
+int dropBlockInBuffer(unsigned int addr, Buffer *buf)
+{
+    int frameNo = lookupPage(addr, buf);
+    int wasDirty = 0;
+
+    if (frameNo >= 0)
+    {
+        /* A dirty block may never have reached the disk */
+        wasDirty = buf->frames[frameNo].dirty;
+        removePage(frameNo, buf);
+    }
+
+    if (wasDirty)
+    {
+        dropPhysical(addr, 1);
+        return 0;
+    }
+
+    return dropPhysical(addr, 0);
+}
+
 unsigned char *readBlockFromDisk(unsigned int addr, Buffer *buf)
 {
-    char filename[40] = "\0";
-    unsigned char *blkPtr, *bytePtr;
-    char ch;
+    unsigned char *blkPtr;
+    int frameNo;
 
     if (buf->numFreeBlk == 0)
     {
@@ -91,62 +685,292 @@ unsigned char *readBlockFromDisk(unsigned int addr, Buffer *buf)
         return NULL;
     }
 
-    blkPtr = buf->data;
-
-    while (blkPtr < buf->data + (buf->blkSize + 1) * buf->numAllBlk)
+    if ((frameNo = lookupPage(addr, buf)) >= 0)
     {
-        if (*blkPtr == BLOCK_AVAILABLE)
-            break;
-        else
-            blkPtr += buf->blkSize + 1;
+        /* Served by the block cached in the pool */
+        buf->frames[frameNo].pinCount++;
+        *(getFrameData(frameNo, buf) - 1) = BLOCK_UNAVAILABLE;
+        touchFrame(frameNo, 1, buf);
+        buf->numFreeBlk--;
+        buf->numIO++;
+        buf->numHit++;
+        return getFrameData(frameNo, buf);
     }
 
-    sprintf(filename, "data/%d.blk", addr);
-    FILE *fp = fopen(filename, "r");
+    if ((blkPtr = getMapping(addr)) != NULL)
+    {
+        if (isEmptyBlock(blkPtr, buf->blkSize))
+        {
+            perror("Reading Block Failed!\n");
+            return NULL;
+        }
 
-    if (!fp)
+        buf->numFreeBlk--;
+        buf->numIO++;
+        return blkPtr;
+    }
+
+    if ((frameNo = allocFrame(buf)) < 0)
     {
-        perror("Reading Block Failed!\n");
+        perror("Buffer Overflows!\n");
         return NULL;
     }
 
-    *blkPtr = BLOCK_UNAVAILABLE;
-    blkPtr++;
-    bytePtr = blkPtr;
+    blkPtr = getFrameData(frameNo, buf);
 
-    while (bytePtr < blkPtr + buf->blkSize)
+    if (readPhysical(addr, blkPtr, buf->blkSize) != 0)
     {
-        ch = fgetc(fp);
-        *bytePtr = ch;
-        bytePtr++;
+        unpinFrame(frameNo, buf);
+        perror("Reading Block Failed!\n");
+        return NULL;
     }
 
-    fclose(fp);
+    insertPage(frameNo, addr, buf);
+    touchFrame(frameNo, 0, buf);
     buf->numFreeBlk--;
     buf->numIO++;
+    buf->numPhysIO++;
     return blkPtr;
 }
 
-int writeBlockToDisk(unsigned char *blkPtr, unsigned int addr, Buffer *buf)
+unsigned char *prefetchBlock(unsigned int addr, Buffer *buf)
 {
-    char filename[40];
-    unsigned char *bytePtr;
+    unsigned char *blkPtr;
+    int frameNo;
 
-    sprintf(filename, "data/%d.blk", addr);
-    FILE *fp = fopen(filename, "w");
+    if ((frameNo = lookupPage(addr, buf)) >= 0)
+        return getFrameData(frameNo, buf);
 
-    if (!fp)
+    if ((blkPtr = getMapping(addr)) != NULL)
+        return isEmptyBlock(blkPtr, buf->blkSize) ? NULL : blkPtr;
+
+    if ((frameNo = allocFrame(buf)) < 0)
+        return NULL;
+
+    blkPtr = getFrameData(frameNo, buf);
+
+    if (readPhysical(addr, blkPtr, buf->blkSize) != 0)
+    {
+        unpinFrame(frameNo, buf);
+        return NULL;
+    }
+
+    insertPage(frameNo, addr, buf);
+    touchFrame(frameNo, 0, buf);
+    unpinFrame(frameNo, buf);
+    buf->numPhysIO++;
+    return blkPtr;
+}
+
+int writeBlockToDisk(unsigned char *blkPtr, unsigned int addr, Buffer *buf)
+{
+    int frameNo = getFrameNo(blkPtr, buf);
+    int oldFrameNo = lookupPage(addr, buf);
+
+    if (frameNo < 0)
     {
         perror("Writing Block Failed!\n");
         return -1;
     }
 
-    for (bytePtr = blkPtr; bytePtr < blkPtr + buf->blkSize; bytePtr++)
-        fputc((int)(*bytePtr), fp);
+    /* The frame written becomes the cached copy of the block addr */
+    if (oldFrameNo >= 0 && oldFrameNo != frameNo)
+        removePage(oldFrameNo, buf);
 
-    fclose(fp);
-    *(blkPtr - 1) = BLOCK_AVAILABLE;
+    if (oldFrameNo != frameNo)
+        insertPage(frameNo, addr, buf);
+
+    if (!buf->frames[frameNo].dirty)
+        buf->numDirty++;
+
+    buf->frames[frameNo].dirty = 1;
+    touchFrame(frameNo, 0, buf);
+    unpinFrame(frameNo, buf);
     buf->numFreeBlk++;
     buf->numIO++;
     return 0;
 }
+
+int openSegmentStore(size_t blkSize, int create)
+{
+    closeSegmentStore();
+    segBlkSize = blkSize;
+
+    if (getSegment(0, create) < 0)
+        return -1;
+
+    segOpened = 1;
+    return 0;
+}
+
+void closeSegmentStore(void)
+{
+    int i;
+
+    unmapSegmentStore();
+
+    for (i = 0; i < MAX_NUM_SEGMENT; i++)
+    {
+        if (segOpened && segFd[i] >= 0)
+            close(segFd[i]);
+        segFd[i] = -1;
+    }
+
+    segOpened = 0;
+}
+
+int syncSegmentStore(void)
+{
+    int i, res = 0;
+
+    if (!segOpened)
+        return 0;
+
+    for (i = 0; i < MAX_NUM_SEGMENT; i++)
+    {
+        if (segFd[i] < 0)
+            continue;
+#ifdef _WIN32
+        if (_commit(segFd[i]) != 0)
+            res = -1;
+#else
+        if (fdatasync(segFd[i]) != 0)
+            res = -1;
+#endif
+    }
+
+    return res;
+}
+
+int syncBlockRange(unsigned int first, unsigned int last)
+{
+    char filename[40];
+    unsigned int addr, seg;
+    int fd, res = 0;
+
+    if (segOpened)
+    {
+        for (seg = first / SEGMENT_NUM_BLK; seg <= last / SEGMENT_NUM_BLK && seg < MAX_NUM_SEGMENT; seg++)
+        {
+            if (segFd[seg] < 0)
+                continue;
+#ifdef _WIN32
+            if (_commit(segFd[seg]) != 0)
+                res = -1;
+#else
+            if (fdatasync(segFd[seg]) != 0)
+                res = -1;
+#endif
+        }
+        return res;
+    }
+
+    for (addr = first; addr <= last; addr++)
+    {
+        sprintf(filename, "data/%d.blk", addr);
+        fd = open(filename, SEG_OPEN_FLAGS);
+
+        if (fd < 0)
+            continue;
+#ifdef _WIN32
+        if (_commit(fd) != 0)
+            res = -1;
+#else
+        if (fsync(fd) != 0)
+            res = -1;
+#endif
+        close(fd);
+    }
+
+    return res;
+}
+
+int isSegmentStoreOpen(void)
+{
+    return segOpened;
+}
+
+int mapSegmentStore(void)
+{
+#ifdef _WIN32
+    return -1;
+#else
+    if (!segOpened)
+        return -1;
+
+    segMapped = 1;
+    return 0;
+#endif
+}
+
+void unmapSegmentStore(void)
+{
+    int i;
+
+    for (i = 0; i < MAX_NUM_SEGMENT; i++)
+    {
+#ifndef _WIN32
+        if (segMap[i])
+            munmap(segMap[i], SEGMENT_NUM_BLK * segBlkSize);
+#endif
+        segMap[i] = NULL;
+    }
+
+    segMapped = 0;
+}
+
+int isMappedBlock(unsigned char *blk)
+{
+    int i;
+
+    for (i = 0; i < MAX_NUM_SEGMENT; i++)
+        if (segMap[i] && blk >= segMap[i] && blk < segMap[i] + SEGMENT_NUM_BLK * segBlkSize)
+            return 1;
+
+    return 0;
+}
+
+int packBlocksToSegment(unsigned int maxAddr, size_t blkSize)
+{
+    char filename[40];
+    unsigned char *blk = (unsigned char *)malloc(blkSize);
+    unsigned int addr;
+    size_t i;
+    int ch, count = 0;
+
+    if (!blk || openSegmentStore(blkSize, 1) != 0)
+    {
+        free(blk);
+        perror("Opening Segment Store Failed!\n");
+        return -1;
+    }
+
+    for (addr = 0; addr <= maxAddr; addr++)
+    {
+        sprintf(filename, "data/%d.blk", addr);
+        FILE *fp = fopen(filename, "r");
+
+        if (!fp)
+            continue;
+
+        for (i = 0; i < blkSize; i++)
+        {
+            ch = fgetc(fp);
+            blk[i] = (ch == EOF) ? 0 : (unsigned char)ch;
+        }
+
+        fclose(fp);
+
+        if (segmentIO(1, addr, blk) != 0)
+        {
+            free(blk);
+            perror("Packing Block Failed!\n");
+            return -1;
+        }
+
+        count++;
+    }
+
+    free(blk);
+    return count;
+}
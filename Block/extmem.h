@@ -11,13 +11,44 @@
 #define BLOCK_AVAILABLE 0
 #define BLOCK_UNAVAILABLE 1
 
+#define POLICY_CLOCK 0 /* Replacement policies of the buffer pool */
+#define POLICY_LRU 1
+#define POLICY_2Q 2
+
+#define QUEUE_A1 0 /* Queues of the 2Q policy */
+#define QUEUE_AM 1
+
+#define SEGMENT_NUM_BLK 4096 /* Number of blocks kept in one segment file */
+#define MAX_NUM_SEGMENT 16 /* Maximum number of segment files */
+
+typedef struct tagFrame {
+    unsigned int addr; /* Address of the block cached in the frame */
+    int valid; /* Whether the frame caches the block addr */
+    int dirty; /* Whether the cached block is newer than the disk */
+    int pinCount; /* Number of users holding the frame */
+    int refBit; /* Reference bit of the CLOCK policy */
+    int queue; /* Queue of the 2Q policy the frame is in */
+    unsigned long stamp; /* Time of the last access */
+    int hashNext; /* Next frame in the same page table bucket */
+} Frame;
+
 typedef struct tagBuffer {
     unsigned long numIO; /* Number of IO's*/
+    unsigned long numHit; /* Number of reads served by the buffer pool */
+    unsigned long numPhysIO; /* Number of reads and writes reaching the disk */
     size_t bufSize; /* Buffer size*/
     size_t blkSize; /* Block size */
     size_t numAllBlk; /* Number of blocks that can be kept in the buffer */
     size_t numFreeBlk; /* Number of available blocks in the buffer */
     unsigned char *data; /* Starting address of the buffer */
+    size_t numFrame; /* Number of frames in the pool, no less than numAllBlk */
+    size_t numDirty; /* Number of dirty blocks not yet written to the disk */
+    Frame *frames; /* Descriptors of the frames */
+    int *pageTable; /* Hash table from block addresses to frames */
+    size_t pageTableSize; /* Number of buckets of the page table */
+    int policy; /* Replacement policy */
+    size_t clockHand; /* Hand of the CLOCK policy */
+    unsigned long clock; /* Logical time for LRU and 2Q */
 } Buffer;
 
 /* Initialize a buffer with the specified buffer size and block size.
@@ -26,7 +57,29 @@ typedef struct tagBuffer {
  */
 Buffer *initBuffer(size_t bufSize, size_t blkSize, Buffer *buf);
 
-/* Free the memory used by a buffer. */
+/* Resize the pool of a buffer to numFrame frames with the given replacement
+ * policy. At most numAllBlk frames can be held at the same time, and the
+ * other frames keep recently used blocks so that repeated reads are served
+ * from memory. If the initialization fails, the return value is NULL.
+ */
+Buffer *initBufferPool(size_t numFrame, int policy, Buffer *buf);
+
+/* Write all the dirty blocks in a buffer back to the disk. */
+int flushBuffer(Buffer *buf);
+
+/* Write at most maxNumBlk dirty blocks of a buffer back to the disk, lowest
+ * addresses first. Inside the segment store the blocks with consecutive
+ * addresses are written together by a single call.
+ * The return value is the number of blocks written, or -1 on failure.
+ */
+int flushDirtyBlocks(size_t maxNumBlk, Buffer *buf);
+
+/* Write the dirty blocks of a buffer with addresses in [first, last] back
+ * to the disk, leaving the other dirty blocks cached.
+ */
+int flushBlockRange(unsigned int first, unsigned int last, Buffer *buf);
+
+/* Free the memory used by a buffer, writing the dirty blocks back first. */
 void freeBuffer(Buffer *buf);
 
 /* Apply for a new block from a buffer.
@@ -41,10 +94,64 @@ void freeBlockInBuffer(unsigned char *blk, Buffer *buf);
 /* Drop a block on the disk */
 int dropBlockOnDisk(unsigned int addr);
 
+/* Drop a block on the disk together with its copy cached in a buffer. */
+int dropBlockInBuffer(unsigned int addr, Buffer *buf);
+
 /* Read a block from the hard disk to the buffer by the address of the block. */
 unsigned char *readBlockFromDisk(unsigned int addr, Buffer *buf);
 
-/* Read a block in the buffer to the hard disk by the address of the block. */
+/* Read a block from the hard disk into an unpinned frame of the pool ahead
+ * of its use, without counting it in numIO or taking a free block.
+ * The return value is the cached block, which stays valid only until the
+ * next call on the buffer, or NULL if the block cannot be read.
+ */
+unsigned char *prefetchBlock(unsigned int addr, Buffer *buf);
+
+/* Read a block in the buffer to the hard disk by the address of the block.
+ * The block stays cached as dirty and reaches the disk when it is evicted
+ * or the buffer is flushed.
+ */
 int writeBlockToDisk(unsigned char *blkPtr, unsigned int addr, Buffer *buf);
 
+/* Open the segment store in which the block of address addr lives at
+ * offset (addr % SEGMENT_NUM_BLK) * blkSize of data/segment_<n>.dat.
+ * If create is 0 and no segment store exists, the return value is -1 and
+ * the blocks keep being stored one file per block; otherwise 0.
+ */
+int openSegmentStore(size_t blkSize, int create);
+
+/* Close all the segment files opened by openSegmentStore. */
+void closeSegmentStore(void);
+
+/* Force the written segment files to the storage device. */
+int syncSegmentStore(void);
+
+/* Force the blocks with addresses in [first, last] to the storage device.
+ * Inside the segment store the segments holding them are synchronized;
+ * otherwise each block file is synchronized on its own.
+ */
+int syncBlockRange(unsigned int first, unsigned int last);
+
+/* Return 1 if blocks are read from and written to the segment store. */
+int isSegmentStoreOpen(void);
+
+/* Map the segment store read-only into memory. Afterwards readBlockFromDisk
+ * hands back a pointer into the mapping instead of copying the block into a
+ * buffer frame, while numIO and numFreeBlk are accounted as before.
+ * The return value is 0 on success, or -1 if mapping is not available.
+ */
+int mapSegmentStore(void);
+
+/* Unmap the segment store, so that blocks are copied into the buffer again. */
+void unmapSegmentStore(void);
+
+/* Return 1 if blk points into the mapped segment store. */
+int isMappedBlock(unsigned char *blk);
+
+/* Pack the blocks data/<addr>.blk with addr in [0, maxAddr] into the
+ * segment store, which is created if necessary.
+ * The return value is the number of blocks packed, or -1 on failure.
+ */
+int packBlocksToSegment(unsigned int maxAddr, size_t blkSize);
+
 #endif // EXTMEM_H
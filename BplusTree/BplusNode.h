@@ -1,6 +1,12 @@
 #include <cstdio>
 #include <cstdlib>
+#include <type_traits>
 #include "../Block/Block.h"
+#include "NodePool.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BPLUS_USE_SSE2
+#endif
 #pragma once
 
 #ifndef BPLUS_NODE
@@ -8,69 +14,151 @@
 
 enum NODE_TYPE {INTERNAL, LEAF};				// 结点类型：内结点、叶子结点
 enum SIBLING_DIRECTION {LEFT, RIGHT};			// 兄弟结点方向：左兄弟结点、右兄弟结点
-typedef float key_t;                         	// 键类型
-typedef addr_t tree_data_t;                    	// 值类型
-extern const int ORDER = 8;                     // B+树的阶（非根内结点的最小子树个数）
-extern const int MINNUM_KEY = ORDER - 1;		// 最小键值个数
-extern const int MAXNUM_KEY = 2 * ORDER - 1;	// 最大键值个数
-extern const int MINNUM_CHILD = MINNUM_KEY + 1; // 最小子树个数
-extern const int MAXNUM_CHILD = MAXNUM_KEY + 1; // 最大子树个数
-extern const int MINNUM_LEAF = MINNUM_KEY;      // 最小叶子结点键值个数
-extern const int MAXNUM_LEAF = MAXNUM_KEY;      // 最大叶子结点键值个数
+typedef addr_t tree_data_t;                    	// 默认的值类型
+extern const int CACHE_LINE_SIZE = 64;          // 缓存行的大小
+extern const int NODE_CACHE_LINES = 4;          // 默认每个结点占的缓存行数
 
 extern const tree_data_t INVALID_INDEX = (addr_t)-1;
 
-// 结点基类
+/**
+ * @brief B+树的参数：键类型、值类型和结点的大小
+ * 阶数(非根内结点的最小子树个数)在编译期由结点大小算出，取内结点能放进NodeBytes字节的最大值
+ * 分裂与合并要求最大键值个数为2 * ORDER - 1，叶结点与内结点的键值个数上下限相同
+ */
+template <typename Key, typename Data, int NodeBytes>
+struct BplusTraits {
+	static_assert(std::is_integral<Key>::value, "B+树的键必须是整数类型");
+	typedef Key key_type;
+	typedef Data data_type;
+	static const int HEADER_SIZE = 2 * sizeof(int);	// 结点类型和键值个数
+	static const int ORDER = (NodeBytes - HEADER_SIZE + (int)sizeof(Key)) / (2 * (int)(sizeof(Key) + sizeof(void *)));
+	static_assert(ORDER >= 2, "结点太小，放不下B+树的最小阶数");
+	static const int MINNUM_KEY = ORDER - 1;		// 最小键值个数
+	static const int MAXNUM_KEY = 2 * ORDER - 1;	// 最大键值个数
+	static const int MINNUM_CHILD = MINNUM_KEY + 1; // 最小子树个数
+	static const int MAXNUM_CHILD = MAXNUM_KEY + 1; // 最大子树个数
+	static const int MINNUM_LEAF = MINNUM_KEY;      // 最小叶子结点键值个数
+	static const int MAXNUM_LEAF = MAXNUM_KEY;      // 最大叶子结点键值个数
+	static const int NODE_SIZE = NodeBytes;
+};
+
+/**
+ * @brief 统计有序数组keys的前n个键中小于key的个数，即key在其中的插入位置
+ * 结点只有几个缓存行大，不带分支地顺序比较所有键，比折半查找难以预测的跳转更快
+ * 
+ * @param keys 按递增顺序存放的键
+ * @param n 键的个数
+ * @param key 查询键值
+ * @return int 小于key的键的个数
+ */
+template <typename Key>
+inline int countLess(const Key *keys, int n, Key key) {
+	int count = 0;
+	for (int i = 0; i < n; ++i)
+		count += (keys[i] < key);
+	return count;
+}
+
+#ifdef BPLUS_USE_SSE2
+/**
+ * @brief 32位整数键的countLess，支持SSE2时一次比较4个键
+ */
+template <>
+inline int countLess<int>(const int *keys, int n, int key) {
+	__m128i target = _mm_set1_epi32(key), counts = _mm_setzero_si128();
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128i block = _mm_loadu_si128((const __m128i *)(keys + i));
+		counts = _mm_sub_epi32(counts, _mm_cmplt_epi32(block, target));	// 比较结果为真的位置是-1
+	}
+	int lanes[4];
+	_mm_storeu_si128((__m128i *)lanes, counts);
+	int count = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	for (; i < n; ++i)
+		count += (keys[i] < key);
+	return count;
+}
+#endif
+
+template <class T> class InternalNode;
+template <class T> class LeafNode;
+
+/**
+ * @brief 结点基类
+ * 结点的操作不用虚函数，而是按结点类型转换成叶结点或内结点后直接调用，结点中也就没有虚表指针
+ */
+template <class T>
 class BplusNode{
 public:
+	typedef typename T::key_type key_t;
+
 	BplusNode() { setKeyNum(0); }
-	virtual ~BplusNode() { setKeyNum(0); }
- 
+
 	NODE_TYPE getType() const { return m_Type; }
 	void setType(NODE_TYPE type){ m_Type = type; }
 	int getKeyNum() const { return m_KeyNum; }
 	void setKeyNum(int n) { m_KeyNum = n; }
 	key_t getKeyValue(int i) const { return m_KeyValues[i]; }
 	void setKeyValue(int i, key_t key) { m_KeyValues[i] = key; }
-	int getKeyIndex(key_t key) const;  
-    
-    // 清空结点，同时会清空结点所包含的子树结点
-	virtual void clear() = 0; 
+	int getKeyIndex(key_t key) const { return countLess<key_t>(m_KeyValues, getKeyNum(), key); }
+	InternalNode<T> *asInternal() { return static_cast<InternalNode<T> *>(this); }
+	LeafNode<T> *asLeaf() { return static_cast<LeafNode<T> *>(this); }
+
     // 从结点中移除键值
-	virtual void removeKey(int keyIndex, int childIndex) = 0;
+	void removeKey(int keyIndex, int childIndex);
     // 分裂结点
-	virtual void split(BplusNode *parentNode, int childIndex) = 0;
+	void split(BplusNode *parentNode, int childIndex, NodePool &pool);
     // 合并结点
-	virtual void mergeChild(BplusNode *parentNode, BplusNode *childNode, int keyIndex) = 0;
+	void mergeChild(BplusNode *parentNode, BplusNode *childNode, int keyIndex, NodePool &pool);
     // 从兄弟结点中借一个键值
-	virtual void borrowFrom(BplusNode *destNode, BplusNode *parentNode, int keyIndex, SIBLING_DIRECTION d) = 0;
+	void borrowFrom(BplusNode *destNode, BplusNode *parentNode, int keyIndex, SIBLING_DIRECTION d);
     // 根据键值获取孩子结点指针下标
-	virtual int getChildIndex(key_t key, int keyIndex) const = 0; 
+	int getChildIndex(key_t key, int keyIndex) const;
 protected:
 	NODE_TYPE m_Type;	// 节点类型
 	int m_KeyNum;		// 当前节点的孩子节点数
-	key_t m_KeyValues[MAXNUM_KEY];	// 节点值
+	key_t m_KeyValues[T::MAXNUM_KEY];	// 节点值
 };
 
-/**
- * @brief 折半查找查询键值key在结点中存储的下标
- * 
- * @param key 查询键值
- * @return int 键值对应的下标
- */
-int BplusNode::getKeyIndex(key_t key) const {
-	int left = 0;
-    int right = getKeyNum();
-    int current;
-	do {
-        current = (left + right) / 2;
-        key_t currentKey = getKeyValue(current);
-		if (key > currentKey)
-            left = current + 1;
-        else
-			right = current;
-	} while (left < right);
-	return left;
+// 以下按结点类型分派到叶结点或内结点的同名操作
+
+template <class T>
+void BplusNode<T>::removeKey(int keyIndex, int childIndex) {
+	if (m_Type == LEAF)
+		asLeaf()->removeKey(keyIndex, childIndex);
+	else
+		asInternal()->removeKey(keyIndex, childIndex);
+}
+
+template <class T>
+void BplusNode<T>::split(BplusNode *parentNode, int childIndex, NodePool &pool) {
+	if (m_Type == LEAF)
+		asLeaf()->split(parentNode, childIndex, pool);
+	else
+		asInternal()->split(parentNode, childIndex, pool);
+}
+
+template <class T>
+void BplusNode<T>::mergeChild(BplusNode *parentNode, BplusNode *childNode, int keyIndex, NodePool &pool) {
+	if (m_Type == LEAF)
+		asLeaf()->mergeChild(parentNode, childNode, keyIndex, pool);
+	else
+		asInternal()->mergeChild(parentNode, childNode, keyIndex, pool);
+}
+
+template <class T>
+void BplusNode<T>::borrowFrom(BplusNode *destNode, BplusNode *parentNode, int keyIndex, SIBLING_DIRECTION d) {
+	if (m_Type == LEAF)
+		asLeaf()->borrowFrom(destNode, parentNode, keyIndex, d);
+	else
+		asInternal()->borrowFrom(destNode, parentNode, keyIndex, d);
+}
+
+template <class T>
+int BplusNode<T>::getChildIndex(key_t key, int keyIndex) const {
+	if (m_Type == LEAF)
+		return keyIndex;
+	return (keyIndex < m_KeyNum && key == getKeyValue(keyIndex)) ? keyIndex + 1 : keyIndex;
 }
 
 #endif
@@ -15,39 +15,87 @@ enum COMPARE_OPERATOR {
 	LT, LE, EQ, GE, GT, BETWEEN
 }; 	// 比较操作符：<、<=、=、>=、>、<>
  
-struct SelectResult {
-	int keyIndex;
-	LeafNode *targetNode;
-};
- 
+/**
+ * @brief B+树模板
+ * 
+ * @tparam Key 键类型，必须是整数类型
+ * @tparam Data 值类型
+ * @tparam NodeBytes 每个结点的大小，决定了B+树的阶数，默认占NODE_CACHE_LINES个缓存行
+ */
+template <typename Key, typename Data = tree_data_t, int NodeBytes = NODE_CACHE_LINES * CACHE_LINE_SIZE>
 class BPlusTree {
 public:
-	BPlusTree() { m_Root = NULL; m_DataHead = NULL; }
-	~BPlusTree() { clear(); }
+	typedef BplusTraits<Key, Data, NodeBytes> traits_t;
+	typedef BplusNode<traits_t> node_t;
+	typedef LeafNode<traits_t> leaf_t;
+	typedef InternalNode<traits_t> internal_t;
+	typedef Key key_t;
+	typedef Data data_t;
+	typedef pair<key_t, data_t> item_t;	// 批量建树时的(键值, 数据)
+	static_assert(sizeof(leaf_t) <= NodeBytes && sizeof(internal_t) <= NodeBytes, "结点超出了NodeBytes");
+	static_assert(std::is_trivially_destructible<leaf_t>::value && std::is_trivially_destructible<internal_t>::value,
+		"结点由内存池整体回收，不调用析构函数");
+
+	BPlusTree() : m_Pool(NodeBytes, CACHE_LINE_SIZE) { m_Root = NULL; m_DataHead = NULL; }
 	void clear();
-	bool insert(key_t key, const tree_data_t &data);
-	bool remove(key_t key, tree_data_t &dataValue);
+	bool insert(key_t key, const data_t &data);
+	// 由按键值递增的键值对自底向上批量建树
+	bool bulkLoad(const vector<item_t> &sortedItems, double fillFactor = 1.0);
+	bool remove(key_t key, data_t &dataValue);
 	bool update(key_t oldKey, key_t newKey);
 	bool search(key_t key);
-	// 定值查询，compareOperator可以是LT(<)、LE(<=)、EQ(=)、BE(>=)、BT(>)
-	vector<tree_data_t> select(key_t compareKey, int compareOpeartor);
+	// 定值查询，compareOperator可以是LT(<)、LE(<=)、EQ(=)、GE(>=)、GT(>)
+	vector<data_t> select(key_t compareKey, COMPARE_OPERATOR compareOpeartor);
 	// 范围查询，BETWEEN
-	vector<tree_data_t> select(key_t smallKey, key_t largeKey);
+	vector<data_t> select(key_t smallKey, key_t largeKey);
+
+	/**
+	 * @brief 沿叶结点的兄弟指针按键值顺序遍历的游标
+	 * 游标只记录所在的叶结点和下标，移动时不申请内存，遍历可以随时停下
+	 * 对B+树做插入、删除之后，之前得到的游标失效
+	 */
+	class Cursor {
+	public:
+		Cursor() : m_Leaf(NULL), m_Index(0) {}
+		bool isValid() const { return m_Leaf != NULL; }		// 是否指向某个键值
+		key_t key() const { return m_Leaf->getKeyValue(m_Index); }
+		data_t data() const { return m_Leaf->getData(m_Index); }
+		bool next();		// 移到下一个键值，已是最后一个时游标失效
+		bool prev();		// 移到上一个键值，已是第一个时游标失效
+	private:
+		friend class BPlusTree;
+		Cursor(leaf_t *leaf, int index) : m_Leaf(leaf), m_Index(index) {}
+		void _skipForward();
+		void _skipBackward();
+		leaf_t *m_Leaf;		// 所在的叶结点
+		int m_Index;		// 在叶结点中的下标
+	};
+	// 定位到第一个不小于key的键值
+	Cursor seek(key_t key) const;
+	// 定位到最小、最大的键值
+	Cursor first() const;
+	Cursor last() const;
 	// void printKey() const { printInConcavo(m_Root, 10); }
 	void printData() const ;    // 打印数据
 private:
-	void recursive_insert(BplusNode *parentNode, key_t key, const tree_data_t &data);
-	void recursive_remove(BplusNode *parentNode, key_t key, tree_data_t &dataValue);
-	void search(key_t key, SelectResult &result);
-	bool recursive_search(BplusNode *pNode, key_t key) const;
-	void recursive_search(BplusNode *pNode, key_t key, SelectResult &result);
-	void changeKey(BplusNode *pNode, key_t oldKey, key_t newKey);
-	void printInConcavo(BplusNode *pNode, int count) const;
+	struct SelectResult {
+		int keyIndex;
+		leaf_t *targetNode;
+	};
+
+	void recursive_insert(node_t *parentNode, key_t key, const data_t &data);
+	void recursive_remove(node_t *parentNode, key_t key, data_t &dataValue);
+	void search(key_t key, SelectResult &result) const;
+	bool recursive_search(node_t *pNode, key_t key) const;
+	void recursive_search(node_t *pNode, key_t key, SelectResult &result) const;
+	void changeKey(node_t *pNode, key_t oldKey, key_t newKey);
+	void printInConcavo(node_t *pNode, int count) const;
+	static int numOfNodes(int numOfItems, int maxItems, int minItems, double fillFactor);
 
 	// 成员变量
-	BplusNode *m_Root;		// B+树的根节点
-	LeafNode *m_DataHead; 	// 叶结点的头部
-	key_t m_MaxKey;		// B+树中的最大键
+	node_t *m_Root;		// B+树的根节点
+	leaf_t *m_DataHead; 	// 叶结点的头部
+	NodePool m_Pool;	// 所有结点都从这个内存池中分配
 };
  
 #endif
@@ -57,62 +105,135 @@ private:
 
 /**
  * @brief 对外提供的B+树的清空操作接口
+ * 所有结点一次性归还给内存池，不必遍历整棵树，内存池已申请的内存留给之后的插入和建树使用
  */
-void BPlusTree::clear() {
-	if (m_Root != NULL) {
-		m_Root->clear();
-		delete m_Root;
-		m_Root = NULL;
-		m_DataHead = NULL;
-	}
+template <typename Key, typename Data, int NodeBytes>
+void BPlusTree<Key, Data, NodeBytes>::clear() {
+	m_Pool.reset();
+	m_Root = NULL;
+	m_DataHead = NULL;
 }
 
 /**
  * @brief 对外提供的B+树的插入操作接口
  */
-bool BPlusTree::insert(key_t key, const tree_data_t &data){
+template <typename Key, typename Data, int NodeBytes>
+bool BPlusTree<Key, Data, NodeBytes>::insert(key_t key, const data_t &data){
 	// 是否已经存在
 	if (search(key))
 		return false;
 		
 	// 找到可以插入的叶子结点，否则创建新的叶子结点
 	if(m_Root == NULL) {
-		m_Root = new LeafNode();
-		m_DataHead = (LeafNode*)m_Root;
-		m_MaxKey = key;
+		m_Root = m_Pool.create<leaf_t>();
+		m_DataHead = m_Root->asLeaf();
 	}
-	if (m_Root->getKeyNum() >= MAXNUM_KEY) {
+	if (m_Root->getKeyNum() >= traits_t::MAXNUM_KEY) {
 		// 根结点已满，分裂
-		InternalNode *newNode = new InternalNode();  //创建新的根节点
+		internal_t *newNode = m_Pool.create<internal_t>();  //创建新的根节点
 		newNode->setChild(0, m_Root);
-		m_Root->split(newNode, 0);
+		m_Root->split(newNode, 0, m_Pool);
 		m_Root = newNode;
 	}
-	if (key > m_MaxKey)
-		// 更新最大键值
-		m_MaxKey = key;
-	
 	recursive_insert(m_Root, key, data);
 	return true;
 }
 
+/**
+ * @brief 对外提供的B+树批量建树接口
+ * 先从左到右依次填满叶结点，再自底向上逐层建立内结点，不必逐个查找插入位置，也没有结点分裂
+ * 原有的内容会被清空，重复的键值只保留第一个，与insert一致
+ * 
+ * @param sortedItems 按键值递增排列的(键值, 数据)
+ * @param fillFactor 结点的填充率，小于1时结点中留有空位，之后的插入可以少做分裂
+ * @return true 建树成功
+ * @return false sortedItems不是按键值递增排列的，此时B+树为空
+ */
+template <typename Key, typename Data, int NodeBytes>
+bool BPlusTree<Key, Data, NodeBytes>::bulkLoad(const vector<item_t> &sortedItems, double fillFactor) {
+	clear();
+	int numOfItems = 0;
+	for (size_t i = 0; i < sortedItems.size(); ++i) {
+		if (i > 0 && sortedItems[i].first < sortedItems[i - 1].first)
+			return false;
+		if (i == 0 || sortedItems[i - 1].first < sortedItems[i].first)
+			numOfItems += 1;
+	}
+	if (numOfItems == 0)
+		return true;
+
+	// 叶结点层：各叶结点平均分配所有的键值
+	int numOfLeaves = numOfNodes(numOfItems, traits_t::MAXNUM_LEAF, traits_t::MINNUM_LEAF, fillFactor);
+	vector<node_t *> level;
+	vector<key_t> minKeys;		// level中每棵子树的最小键值
+	leaf_t *prior = NULL;
+	size_t pos = 0;
+	for (int i = 0; i < numOfLeaves; ++i) {
+		int numOfKeys = numOfItems / numOfLeaves + (i < numOfItems % numOfLeaves);
+		leaf_t *leaf = m_Pool.create<leaf_t>();
+		for (int j = 0; j < numOfKeys; ++pos) {
+			if (pos > 0 && sortedItems[pos - 1].first == sortedItems[pos].first)
+				continue;	// 跳过重复的键值
+			leaf->setKeyValue(j, sortedItems[pos].first);
+			leaf->setData(j, sortedItems[pos].second);
+			++j;
+		}
+		leaf->setKeyNum(numOfKeys);
+		leaf->setLeftSibling(prior);
+		if (prior == NULL)
+			m_DataHead = leaf;
+		else
+			prior->setRightSibling(leaf);
+		prior = leaf;
+		level.push_back(leaf);
+		minKeys.push_back(leaf->getKeyValue(0));
+	}
+
+	// 内结点层：以下一层各子树的最小键值作为分隔键，直到只剩一个结点
+	while (level.size() > 1) {
+		int numOfChilds = level.size();
+		int numOfParents = numOfNodes(numOfChilds, traits_t::MAXNUM_CHILD, traits_t::MINNUM_CHILD, fillFactor);
+		vector<node_t *> parents;
+		vector<key_t> parentMinKeys;
+		int child = 0;
+		for (int i = 0; i < numOfParents; ++i) {
+			int numOfChildsInNode = numOfChilds / numOfParents + (i < numOfChilds % numOfParents);
+			internal_t *node = m_Pool.create<internal_t>();
+			parentMinKeys.push_back(minKeys[child]);
+			for (int j = 0; j < numOfChildsInNode; ++j, ++child) {
+				node->setChild(j, level[child]);
+				if (j > 0)
+					node->setKeyValue(j - 1, minKeys[child]);
+			}
+			node->setKeyNum(numOfChildsInNode - 1);
+			parents.push_back(node);
+		}
+		level.swap(parents);
+		minKeys.swap(parentMinKeys);
+	}
+	m_Root = level[0];
+	return true;
+}
+
 /**
  * @brief 对外提供的B+树的删除操作接口
  */
-bool BPlusTree::remove(key_t key, tree_data_t &dataValue) {
+template <typename Key, typename Data, int NodeBytes>
+bool BPlusTree<Key, Data, NodeBytes>::remove(key_t key, data_t &dataValue) {
 	if (!search(key))
 		return false;
 	if (m_Root->getKeyNum() == 1) {
 		//特殊情况处理
 		if (m_Root->getType() == LEAF) {
+			dataValue = m_Root->asLeaf()->getData(0);
 			clear();
 			return true;
 		} else {
-			BplusNode *pChild1 = ((InternalNode *)m_Root)->getChild(0);
-			BplusNode *pChild2 = ((InternalNode *)m_Root)->getChild(1);
-			if (pChild1->getKeyNum() == MINNUM_KEY && pChild2->getKeyNum() == MINNUM_KEY) {
-				pChild1->mergeChild(m_Root, pChild2, 0);
-				delete m_Root;
+			node_t *pChild1 = m_Root->asInternal()->getChild(0);
+			node_t *pChild2 = m_Root->asInternal()->getChild(1);
+			if (pChild1->getKeyNum() == traits_t::MINNUM_KEY && pChild2->getKeyNum() == traits_t::MINNUM_KEY) {
+				pChild1->mergeChild(m_Root, pChild2, 0, m_Pool);
+				m_Pool.deallocate(m_Root);
 				m_Root = pChild1;
 			}
 		}
@@ -124,14 +245,14 @@ bool BPlusTree::remove(key_t key, tree_data_t &dataValue) {
 /**
  * @brief 对外提供的B+树的更新操作接口
  */
-bool BPlusTree::update(key_t oldKey, key_t newKey) {
+template <typename Key, typename Data, int NodeBytes>
+bool BPlusTree<Key, Data, NodeBytes>::update(key_t oldKey, key_t newKey) {
 	if (search(newKey)) 
 		// 检查更新后的键是否已经存在
 		return false;
 	else {
-		tree_data_t dataValue;
-		BPlusTree::remove(oldKey, dataValue);
-		if (dataValue == INVALID_INDEX)
+		data_t dataValue;
+		if (!remove(oldKey, dataValue))
 			return false;
 		else
 			return insert(newKey, dataValue);
@@ -141,15 +262,17 @@ bool BPlusTree::update(key_t oldKey, key_t newKey) {
 /**
  * @brief 对外提供的B+树搜索接口
  */
-bool BPlusTree::search(key_t key) {
+template <typename Key, typename Data, int NodeBytes>
+bool BPlusTree<Key, Data, NodeBytes>::search(key_t key) {
 	return recursive_search(m_Root, key);
 }
  
 /**
  * @brief 对外提供的B+树结构输出接口
  */
-void BPlusTree::printData() const {
-	LeafNode *itr = m_DataHead;
+template <typename Key, typename Data, int NodeBytes>
+void BPlusTree<Key, Data, NodeBytes>::printData() const {
+	leaf_t *itr = m_DataHead;
 	while(itr) {
 		for (int i = 0; i < itr->getKeyNum(); ++i)
 			cout << itr->getKeyValue(i) << "->" << itr->getData(i) << " ";
@@ -159,106 +282,155 @@ void BPlusTree::printData() const {
 }
  
 /**
- * @brief 选择比较条件为compareOpeartor，比较值为compareKey的所有叶结点的值
+ * @brief 定位到第一个不小于key的键值
+ * 
+ * @param key 查询键值
+ * @return Cursor 指向该键值的游标，所有键值都小于key时游标无效
  */
-vector<tree_data_t> BPlusTree::select(key_t compareKey, int compareOpeartor) {
-	vector<tree_data_t> results;
-	if (m_Root) {
-		if (compareKey > m_MaxKey) {
-			// 比较键值大于B+树中最大的键值
-			if (compareOpeartor == LE || compareOpeartor == LT) {
-				for(LeafNode *itr = m_DataHead; itr!=NULL; itr= itr->getRightSibling())
-					for (int i = 0; i < itr->getKeyNum(); ++i)
-						results.push_back(itr->getData(i));
-			}
-		} else if (compareKey < m_DataHead->getKeyValue(0)) {
-			// 比较键值小于B+树中最小的键值
-			if (compareOpeartor == GE || compareOpeartor == GT) {
-				for(LeafNode *itr = m_DataHead; itr!=NULL; itr= itr->getRightSibling())
-					for (int i = 0; i < itr->getKeyNum(); ++i)
-						results.push_back(itr->getData(i));
-			}
-		} else {
-			// 比较键值在B+树中
-			SelectResult result;
-			search(compareKey, result);
-			switch(compareOpeartor) {
-				case LE: {
-					LeafNode *itr = m_DataHead;
-					int i;
-					while (itr!=result.targetNode) {
-						for (i=0; i<itr->getKeyNum(); ++i)
-							results.push_back(itr->getData(i));
-						itr = itr->getRightSibling();
-					}
-					for (i=0; i<result.keyIndex; ++i)
-						results.push_back(itr->getData(i));
-					if (itr->getKeyValue(i) < compareKey || 
-						(compareOpeartor==LE && compareKey==itr->getKeyValue(i)))
-						results.push_back(itr->getData(i));
-					break;
-				}
-				case EQ: {
-					if (result.targetNode->getKeyValue(result.keyIndex)==compareKey)
-					{
-						results.push_back(result.targetNode->getData(result.keyIndex));
-					}
-					break;
-				}
-				case GT: {
-					LeafNode *itr = result.targetNode;
-					if (compareKey<itr->getKeyValue(result.keyIndex) ||
-						(compareOpeartor==GE && compareKey==itr->getKeyValue(result.keyIndex)))
-						results.push_back(itr->getData(result.keyIndex));
-					int i;
-					for (i=result.keyIndex+1; i<itr->getKeyNum(); ++i)
-						results.push_back(itr->getData(i));
-					itr = itr->getRightSibling();
-					while (itr!=NULL) {
-						for (i=0; i<itr->getKeyNum(); ++i)
-							results.push_back(itr->getData(i));
-						itr = itr->getRightSibling();
-					}
-					break;
-				}
-				default:  // 范围查询
+template <typename Key, typename Data, int NodeBytes>
+typename BPlusTree<Key, Data, NodeBytes>::Cursor BPlusTree<Key, Data, NodeBytes>::seek(key_t key) const {
+	if (m_Root == NULL)
+		return Cursor();
+	SelectResult result;
+	search(key, result);
+	Cursor cursor(result.targetNode, result.keyIndex);
+	if (result.keyIndex >= result.targetNode->getKeyNum())
+		// key大于该叶结点中所有的键值，第一个不小于key的键值在右兄弟结点中
+		cursor._skipForward();
+	return cursor;
+}
+
+/**
+ * @brief 定位到最小的键值
+ */
+template <typename Key, typename Data, int NodeBytes>
+typename BPlusTree<Key, Data, NodeBytes>::Cursor BPlusTree<Key, Data, NodeBytes>::first() const {
+	Cursor cursor(m_DataHead, 0);
+	if (m_DataHead != NULL && m_DataHead->getKeyNum() == 0)
+		cursor._skipForward();
+	return cursor;
+}
+
+/**
+ * @brief 定位到最大的键值
+ */
+template <typename Key, typename Data, int NodeBytes>
+typename BPlusTree<Key, Data, NodeBytes>::Cursor BPlusTree<Key, Data, NodeBytes>::last() const {
+	if (m_Root == NULL)
+		return Cursor();
+	node_t *pNode = m_Root;
+	while (pNode->getType() != LEAF)
+		pNode = pNode->asInternal()->getChild(pNode->getKeyNum());
+	Cursor cursor(pNode->asLeaf(), pNode->getKeyNum() - 1);
+	if (pNode->getKeyNum() == 0)
+		cursor._skipBackward();
+	return cursor;
+}
+ 
+/**
+ * @brief 选择比较条件为compareOpeartor，比较值为compareKey的所有叶结点的值，结果按键值递增排列
+ */
+template <typename Key, typename Data, int NodeBytes>
+vector<Data> BPlusTree<Key, Data, NodeBytes>::select(key_t compareKey, COMPARE_OPERATOR compareOpeartor) {
+	vector<data_t> results;
+	switch(compareOpeartor) {
+		case LT:
+		case LE: {
+			for (Cursor cursor = first(); cursor.isValid(); cursor.next()) {
+				if (compareKey < cursor.key() || (compareOpeartor == LT && compareKey == cursor.key()))
 					break;
+				results.push_back(cursor.data());
 			}
+			break;
+		}
+		case EQ: {
+			Cursor cursor = seek(compareKey);
+			if (cursor.isValid() && cursor.key() == compareKey)
+				results.push_back(cursor.data());
+			break;
 		}
+		case GE:
+		case GT: {
+			Cursor cursor = seek(compareKey);
+			if (compareOpeartor == GT && cursor.isValid() && cursor.key() == compareKey)
+				cursor.next();
+			for (; cursor.isValid(); cursor.next())
+				results.push_back(cursor.data());
+			break;
+		}
+		default:  // 范围查询
+			break;
 	}
-	sort<vector<tree_data_t>::iterator>(results.begin(), results.end());
 	return results;
 }
  
 /**
- * @brief 选择介于smallKey和largeKey之间的所有叶节点的值
+ * @brief 选择介于smallKey和largeKey之间的所有叶节点的值，结果按键值递增排列
  */
-vector<tree_data_t> BPlusTree::select(key_t smallKey, key_t largeKey) {
-	vector<tree_data_t> results;
-	if (smallKey <= largeKey) {
-		SelectResult start, end;
-		search(smallKey, start);
-		search(largeKey, end);
-		LeafNode *itr = start.targetNode;
-		int i = start.keyIndex;
-		if (itr->getKeyValue(i) < smallKey)
-			++i;
-		if (end.targetNode->getKeyValue(end.keyIndex) > largeKey)
-			--end.keyIndex;
-		while (itr!=end.targetNode) {
-			for (; i<itr->getKeyNum(); ++i)
-				results.push_back(itr->getData(i));
-			itr = itr->getRightSibling();
-			i = 0;
-		}
-		for (; i<=end.keyIndex; ++i)
-			results.push_back(itr->getData(i));
-	}
-	sort<vector<tree_data_t>::iterator>(results.begin(), results.end());
+template <typename Key, typename Data, int NodeBytes>
+vector<Data> BPlusTree<Key, Data, NodeBytes>::select(key_t smallKey, key_t largeKey) {
+	vector<data_t> results;
+	for (Cursor cursor = seek(smallKey); cursor.isValid() && !(largeKey < cursor.key()); cursor.next())
+		results.push_back(cursor.data());
 	return results;
 }
 
 
+/**
+ * @brief 游标移到下一个键值，当前叶结点走完后沿右兄弟指针进入下一个叶结点
+ * 
+ * @return true 游标指向下一个键值
+ * @return false 已经越过最大的键值，游标失效
+ */
+template <typename Key, typename Data, int NodeBytes>
+bool BPlusTree<Key, Data, NodeBytes>::Cursor::next() {
+	if (m_Leaf == NULL)
+		return false;
+	m_Index += 1;
+	if (m_Index >= m_Leaf->getKeyNum())
+		_skipForward();
+	return m_Leaf != NULL;
+}
+
+/**
+ * @brief 游标移到上一个键值，当前叶结点走完后沿左兄弟指针进入上一个叶结点
+ * 
+ * @return true 游标指向上一个键值
+ * @return false 已经越过最小的键值，游标失效
+ */
+template <typename Key, typename Data, int NodeBytes>
+bool BPlusTree<Key, Data, NodeBytes>::Cursor::prev() {
+	if (m_Leaf == NULL)
+		return false;
+	m_Index -= 1;
+	if (m_Index < 0)
+		_skipBackward();
+	return m_Leaf != NULL;
+}
+
+/**
+ * @brief 移到右兄弟结点中第一个键值，跳过没有键值的叶结点
+ */
+template <typename Key, typename Data, int NodeBytes>
+void BPlusTree<Key, Data, NodeBytes>::Cursor::_skipForward() {
+	do {
+		m_Leaf = m_Leaf->getRightSibling();
+	} while (m_Leaf != NULL && m_Leaf->getKeyNum() == 0);
+	m_Index = 0;
+}
+
+/**
+ * @brief 移到左兄弟结点中最后一个键值，跳过没有键值的叶结点
+ */
+template <typename Key, typename Data, int NodeBytes>
+void BPlusTree<Key, Data, NodeBytes>::Cursor::_skipBackward() {
+	do {
+		m_Leaf = m_Leaf->getLeftSibling();
+	} while (m_Leaf != NULL && m_Leaf->getKeyNum() == 0);
+	m_Index = (m_Leaf != NULL) ? m_Leaf->getKeyNum() - 1 : 0;
+}
+
+
 // -----------------------------------------------------------------------
 //                                 Private                                
 // -----------------------------------------------------------------------
@@ -270,19 +442,20 @@ vector<tree_data_t> BPlusTree::select(key_t smallKey, key_t largeKey) {
  * @param key 待插入的键值
  * @param data 需要插入的新节点的值
  */
-void BPlusTree::recursive_insert(BplusNode *parentNode, key_t key, const tree_data_t &data) {
+template <typename Key, typename Data, int NodeBytes>
+void BPlusTree<Key, Data, NodeBytes>::recursive_insert(node_t *parentNode, key_t key, const data_t &data) {
 	if (parentNode->getType() == LEAF)  // 叶子结点
-		((LeafNode*)parentNode)->insert(key, data);
+		parentNode->asLeaf()->insert(key, data);
 	else {
 		// 找到子结点
 		int keyIndex = parentNode->getKeyIndex(key);
 		int childIndex = parentNode->getChildIndex(key, keyIndex); // 孩子结点指针索引
-		BplusNode *childNode = ((InternalNode*)parentNode)->getChild(childIndex);
-		if (childNode->getKeyNum() >= MAXNUM_LEAF) {
+		node_t *childNode = parentNode->asInternal()->getChild(childIndex);
+		if (childNode->getKeyNum() >= traits_t::MAXNUM_LEAF) {
 			// 子结点已满，需进行分裂
-			childNode->split(parentNode, childIndex);      
+			childNode->split(parentNode, childIndex, m_Pool);      
 			if (parentNode->getKeyValue(childIndex) <= key)
-				childNode = ((InternalNode *)parentNode)->getChild(childIndex + 1);
+				childNode = parentNode->asInternal()->getChild(childIndex + 1);
 		}
 		recursive_insert(childNode, key, data);
 	}
@@ -296,45 +469,45 @@ void BPlusTree::recursive_insert(BplusNode *parentNode, key_t key, const tree_da
  * @param key 待删除的键值
  * @param dataValue 需要删除的节点的值
  */
-void BPlusTree::recursive_remove(BplusNode *parentNode, key_t key, tree_data_t &dataValue) {
+template <typename Key, typename Data, int NodeBytes>
+void BPlusTree<Key, Data, NodeBytes>::recursive_remove(node_t *parentNode, key_t key, data_t &dataValue) {
 	int keyIndex = parentNode->getKeyIndex(key);
 	int childIndex= parentNode->getChildIndex(key, keyIndex);
 	if (parentNode->getType() == LEAF) {
 		// 找到目标叶子节点
-		if (key == m_MaxKey && keyIndex > 0)
-			m_MaxKey = parentNode->getKeyValue(keyIndex - 1);
-		dataValue = ((LeafNode *)parentNode)->getData(keyIndex);
+		dataValue = parentNode->asLeaf()->getData(keyIndex);
 		parentNode->removeKey(keyIndex, childIndex);
 		// 如果键值在内部结点中存在，也要相应的替换内部结点
 		if (childIndex == 0 && m_Root->getType() != LEAF && parentNode != m_DataHead)
 			changeKey(m_Root, key, parentNode->getKeyValue(0));
 	} else {
 		// 内结点 
-		BplusNode *pChildNode = ((InternalNode*)parentNode)->getChild(childIndex); //包含key的子树根节点
-		if (pChildNode->getKeyNum() == MINNUM_KEY) {
+		node_t *pChildNode = parentNode->asInternal()->getChild(childIndex); //包含key的子树根节点
+		if (pChildNode->getKeyNum() == traits_t::MINNUM_KEY) {
 			// 包含键数量达到下限值，进行相关操作
-			BplusNode *pLeft = childIndex>0 ? ((InternalNode*)parentNode)->getChild(childIndex-1) : NULL;                       //左兄弟节点
-			BplusNode *pRight = childIndex<parentNode->getKeyNum() ? ((InternalNode*)parentNode)->getChild(childIndex+1) : NULL;//右兄弟节点
-			if (pLeft && pLeft->getKeyNum()>MINNUM_KEY)
+			node_t *pLeft = childIndex>0 ? parentNode->asInternal()->getChild(childIndex-1) : NULL;                       //左兄弟节点
+			node_t *pRight = childIndex<parentNode->getKeyNum() ? parentNode->asInternal()->getChild(childIndex+1) : NULL;//右兄弟节点
+			if (pLeft && pLeft->getKeyNum()>traits_t::MINNUM_KEY)
 				// 左兄弟结点可借
 				pChildNode->borrowFrom(pLeft, parentNode, childIndex-1, LEFT);
-			else if (pRight && pRight->getKeyNum()>MINNUM_KEY)
+			else if (pRight && pRight->getKeyNum()>traits_t::MINNUM_KEY)
 				// 右兄弟结点可借
 				pChildNode->borrowFrom(pRight, parentNode, childIndex, RIGHT);
 			else if (pLeft) {
 				// 与左兄弟合并
-				pLeft->mergeChild(parentNode, pChildNode, childIndex-1);
+				pLeft->mergeChild(parentNode, pChildNode, childIndex-1, m_Pool);
 				pChildNode = pLeft;
 			} else if (pRight)
 				// 与右兄弟合并
-				pChildNode->mergeChild(parentNode, pRight, childIndex);
+				pChildNode->mergeChild(parentNode, pRight, childIndex, m_Pool);
 		}
 		recursive_remove(pChildNode, key, dataValue);
 	}
 }
  
 
-void BPlusTree::search(key_t key, SelectResult &result) {
+template <typename Key, typename Data, int NodeBytes>
+void BPlusTree<Key, Data, NodeBytes>::search(key_t key, SelectResult &result) const {
 	recursive_search(m_Root, key, result);
 }
  
@@ -346,7 +519,8 @@ void BPlusTree::search(key_t key, SelectResult &result) {
  * @return true 搜索成功：搜索到了对应的节点
  * @return false 搜索失败
  */
-bool BPlusTree::recursive_search(BplusNode *pNode, key_t key) const {
+template <typename Key, typename Data, int NodeBytes>
+bool BPlusTree<Key, Data, NodeBytes>::recursive_search(node_t *pNode, key_t key) const {
 	if (pNode == NULL)  //检测节点指针是否为空，或该节点是否为叶子节点
 		return false;
 	else {
@@ -359,7 +533,7 @@ bool BPlusTree::recursive_search(BplusNode *pNode, key_t key) const {
 				//检查该节点是否为叶子节点
 				return false;
 			else
-				return recursive_search(((InternalNode *)pNode)->getChild(childIndex), key);
+				return recursive_search(pNode->asInternal()->getChild(childIndex), key);
 		}
 	}
 }
@@ -371,16 +545,17 @@ bool BPlusTree::recursive_search(BplusNode *pNode, key_t key) const {
  * @param key 搜索的键
  * @param result 搜索结果
  */
-void BPlusTree::recursive_search(BplusNode *pNode, key_t key, SelectResult &result) {
+template <typename Key, typename Data, int NodeBytes>
+void BPlusTree<Key, Data, NodeBytes>::recursive_search(node_t *pNode, key_t key, SelectResult &result) const {
 	int keyIndex = pNode->getKeyIndex(key);
 	int childIndex = pNode->getChildIndex(key, keyIndex); // 孩子结点指针索引
 	if (pNode->getType() == LEAF) {
 		result.keyIndex = keyIndex;
-		result.targetNode = (LeafNode*)pNode;
+		result.targetNode = pNode->asLeaf();
 		return;
 	}
 	else
-		return recursive_search(((InternalNode*)pNode)->getChild(childIndex), key, result);
+		return recursive_search(pNode->asInternal()->getChild(childIndex), key, result);
 }
 
 /**
@@ -390,33 +565,52 @@ void BPlusTree::recursive_search(BplusNode *pNode, key_t key, SelectResult &resu
  * @param oldKey 旧键内容
  * @param newKey 新键内容
  */
-void BPlusTree::changeKey(BplusNode *pNode, key_t oldKey, key_t newKey) {
+template <typename Key, typename Data, int NodeBytes>
+void BPlusTree<Key, Data, NodeBytes>::changeKey(node_t *pNode, key_t oldKey, key_t newKey) {
 	if (pNode!=NULL && pNode->getType() != LEAF) {
 		int keyIndex = pNode->getKeyIndex(oldKey);
 		if (keyIndex < pNode->getKeyNum() && oldKey == pNode->getKeyValue(keyIndex))
 			pNode->setKeyValue(keyIndex, newKey);
 		else
-			changeKey(((InternalNode*)pNode)->getChild(keyIndex), oldKey, newKey);
+			changeKey(pNode->asInternal()->getChild(keyIndex), oldKey, newKey);
 	}
 }
  
+/**
+ * @brief 计算批量建树时一层需要的结点数
+ * 按填充率算出每个结点放多少项，再保证平均分配之后每个结点都不少于下限，只有一个结点(根结点)时不受下限约束
+ * 
+ * @param numOfItems 这一层的总项数：叶结点层为键值数，内结点层为下一层的结点数
+ * @param maxItems 每个结点的项数上限
+ * @param minItems 每个结点的项数下限
+ * @param fillFactor 结点的填充率
+ * @return int 这一层的结点数
+ */
+template <typename Key, typename Data, int NodeBytes>
+int BPlusTree<Key, Data, NodeBytes>::numOfNodes(int numOfItems, int maxItems, int minItems, double fillFactor) {
+	int itemsPerNode = max(minItems, min(maxItems, (int)(maxItems * fillFactor + 0.5)));
+	int numOfNodes = (numOfItems + itemsPerNode - 1) / itemsPerNode;
+	return max(1, min(numOfNodes, numOfItems / minItems));
+}
+
 /**
  * @brief 递归输出B+树的键值
  * 
  * @param pNode 当前搜索到的节点
  * @param count 当前节点键的数量
  */
-void BPlusTree::printInConcavo(BplusNode *pNode, int count) const {
+template <typename Key, typename Data, int NodeBytes>
+void BPlusTree<Key, Data, NodeBytes>::printInConcavo(node_t *pNode, int count) const {
 	if (pNode != NULL) {
 		int i, j;
 		for (i = 0; i < pNode->getKeyNum(); ++i) {
 			if (pNode->getType() != LEAF)
-				printInConcavo(((InternalNode *)pNode)->getChild(i), count - 2);
+				printInConcavo(pNode->asInternal()->getChild(i), count - 2);
 			for (j = count; j >= 0; --j)
 				cout << "-";
 			cout << pNode->getKeyValue(i) << endl;
 		}
 		if (pNode->getType() != LEAF)
-			printInConcavo(((InternalNode *)pNode)->getChild(i), count - 2);
+			printInConcavo(pNode->asInternal()->getChild(i), count - 2);
 	}
 }
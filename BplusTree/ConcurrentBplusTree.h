@@ -0,0 +1,560 @@
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "BplusNode.h"
+#include "BplusTree.h"
+#include "NodePool.h"
+#include "EpochManager.h"
+#pragma once
+
+#ifndef CONCURRENT_BPLUS_TREE_H
+#define CONCURRENT_BPLUS_TREE_H
+
+/**
+ * @brief 结点上的乐观锁
+ * 版本号的第0位表示结点已从树中摘下，第1位表示结点被写锁锁住，其余位在每次写完解锁时加一
+ * 读者不加锁：读之前记下版本号，读完后检查版本号没变，变了就说明读的过程中有人写过，需要重读
+ * 写者把读时记下的版本号原子地换成加锁的版本号，换不成功说明结点已被改过，同样需要重来
+ */
+class OptLock {
+public:
+	OptLock() { m_Version.store(0); }
+	bool readLock(uint64_t &version) const;		// 记下版本号，结点被锁住或已摘下时返回false
+	bool validate(uint64_t version) const { return m_Version.load() == version; }
+	bool upgrade(uint64_t version);				// 由读升级为写锁，结点在version之后被改过时返回false
+	void writeUnlock() { m_Version.fetch_add(2); }
+	void writeUnlockObsolete() { m_Version.fetch_add(3); }
+private:
+	std::atomic<uint64_t> m_Version;
+};
+
+bool OptLock::readLock(uint64_t &version) const {
+	version = m_Version.load();
+	return (version & 3) == 0;
+}
+
+bool OptLock::upgrade(uint64_t version) {
+	return m_Version.compare_exchange_strong(version, version + 2);
+}
+
+/**
+ * @brief 支持多线程并发读写的B+树，采用乐观锁耦合(optimistic lock coupling)
+ * 查找与范围查询全程不加锁，自上而下读结点时只记录并校验版本号，多个线程的查询可以同时进行
+ * 插入时在下降途中提前分裂已满的结点，只需锁住被分裂的结点及其父结点
+ * 删除不做借键与合并，叶结点删空时从父结点和兄弟链表中摘下，摘下的结点交给纪元管理器延后释放
+ * 结点从内存池中分配，与BPlusTree的结点一样占NodeBytes字节
+ * 
+ * @tparam Key 键类型，必须是整数类型
+ * @tparam Data 值类型
+ * @tparam NodeBytes 每个结点的大小
+ */
+template <typename Key, typename Data = tree_data_t, int NodeBytes = NODE_CACHE_LINES * CACHE_LINE_SIZE>
+class ConcurrentBPlusTree {
+public:
+	typedef Key key_t;
+	typedef Data data_t;
+	static_assert(std::is_integral<Key>::value, "B+树的键必须是整数类型");
+
+	ConcurrentBPlusTree();
+	ConcurrentBPlusTree(const ConcurrentBPlusTree &) = delete;
+	ConcurrentBPlusTree &operator=(const ConcurrentBPlusTree &) = delete;
+	bool insert(key_t key, const data_t &data);
+	bool remove(key_t key, data_t &dataValue);
+	bool search(key_t key, data_t &dataValue);
+	// 定值查询，compareOperator可以是LT(<)、LE(<=)、EQ(=)、GE(>=)、GT(>)
+	vector<data_t> select(key_t compareKey, COMPARE_OPERATOR compareOpeartor);
+	// 范围查询，BETWEEN
+	vector<data_t> select(key_t smallKey, key_t largeKey);
+private:
+	static const int HEADER_SIZE = sizeof(OptLock) + 2 * sizeof(int);
+	static const int MAXNUM_LEAF = (NodeBytes - HEADER_SIZE - (int)sizeof(void *)) / (int)(sizeof(Key) + sizeof(Data));
+	static const int MAXNUM_KEY = (NodeBytes - HEADER_SIZE - (int)sizeof(void *)) / (int)(sizeof(Key) + sizeof(void *));
+	static_assert(MAXNUM_LEAF >= 2 && MAXNUM_KEY >= 2, "结点太小，放不下B+树的最小阶数");
+
+	struct Node {
+		OptLock lock;
+		NODE_TYPE type;
+		int keyNum;
+		// 乐观读时keyNum可能是读到一半的值，先限制在[0, maxNum]内再使用，读完后的版本号校验会发现它
+		int safeKeyNum(int maxNum) const { int n = keyNum; return n < 0 ? 0 : (n > maxNum ? maxNum : n); }
+	};
+	struct Leaf : Node {
+		key_t keys[MAXNUM_LEAF];
+		data_t datas[MAXNUM_LEAF];
+		Leaf *right;				// 右兄弟结点
+		Leaf() { this->type = LEAF; this->keyNum = 0; right = NULL; }
+	};
+	struct Inner : Node {
+		key_t keys[MAXNUM_KEY];
+		Node *childs[MAXNUM_KEY + 1];
+		Inner() { this->type = INTERNAL; this->keyNum = 0; }
+		int childIndex(key_t key) const;
+	};
+	static_assert(sizeof(Leaf) <= NodeBytes && sizeof(Inner) <= NodeBytes, "结点超出了NodeBytes");
+	static_assert(std::is_trivially_destructible<Leaf>::value && std::is_trivially_destructible<Inner>::value,
+		"结点由内存池整体回收，不调用析构函数");
+
+	bool _tryInsert(key_t key, const data_t &data, bool &inserted);
+	bool _tryRemove(key_t key, data_t &dataValue, bool &removed);
+	bool _trySearch(key_t key, data_t &dataValue, bool &found);
+	bool _tryScan(key_t &fromKey, key_t largeKey, vector<data_t> &results, bool &done);
+	Leaf *_findLeaf(key_t key, uint64_t &version, Inner *&parent, uint64_t &parentVersion, int &childIndex);
+	void _split(Node *node, uint64_t version, Inner *parent, uint64_t parentVersion);
+	template <class N> N *_newNode();
+	void _retire(Node *node);
+
+	std::atomic<Node *> m_Root;		// B+树的根结点，空树时是一个没有键值的叶结点
+	NodePool m_Pool;				// 所有结点都从这个内存池中分配
+	std::mutex m_PoolMutex;			// 保护m_Pool
+	EpochManager m_Epoch;			// 延后释放被摘下的结点
+};
+
+#endif // !CONCURRENT_BPLUS_TREE_H
+
+// -----------------------------------------------------------------------
+//                            Public Interfaces
+// -----------------------------------------------------------------------
+
+template <typename Key, typename Data, int NodeBytes>
+ConcurrentBPlusTree<Key, Data, NodeBytes>::ConcurrentBPlusTree() : m_Pool(NodeBytes, CACHE_LINE_SIZE) {
+	m_Root.store(_newNode<Leaf>());
+}
+
+/**
+ * @brief 插入键值对，与其他线程的读写同时进行时冲突则重试
+ * 
+ * @return true 插入成功
+ * @return false 键值已存在
+ */
+template <typename Key, typename Data, int NodeBytes>
+bool ConcurrentBPlusTree<Key, Data, NodeBytes>::insert(key_t key, const data_t &data) {
+	EpochGuard guard(m_Epoch);
+	bool inserted;
+	while (!_tryInsert(key, data, inserted))
+		std::this_thread::yield();
+	return inserted;
+}
+
+/**
+ * @brief 删除键值
+ * 
+ * @param dataValue 被删除的键值对应的数据
+ * @return true 删除成功
+ * @return false 键值不存在
+ */
+template <typename Key, typename Data, int NodeBytes>
+bool ConcurrentBPlusTree<Key, Data, NodeBytes>::remove(key_t key, data_t &dataValue) {
+	EpochGuard guard(m_Epoch);
+	bool removed;
+	while (!_tryRemove(key, dataValue, removed))
+		std::this_thread::yield();
+	return removed;
+}
+
+/**
+ * @brief 定值查找
+ * 
+ * @param dataValue 找到的数据
+ * @return true 找到了键值
+ */
+template <typename Key, typename Data, int NodeBytes>
+bool ConcurrentBPlusTree<Key, Data, NodeBytes>::search(key_t key, data_t &dataValue) {
+	EpochGuard guard(m_Epoch);
+	bool found;
+	while (!_trySearch(key, dataValue, found))
+		std::this_thread::yield();
+	return found;
+}
+
+/**
+ * @brief 选择比较条件为compareOpeartor，比较值为compareKey的所有叶结点的值，结果按键值递增排列
+ */
+template <typename Key, typename Data, int NodeBytes>
+vector<Data> ConcurrentBPlusTree<Key, Data, NodeBytes>::select(key_t compareKey, COMPARE_OPERATOR compareOpeartor) {
+	const key_t minKey = std::numeric_limits<key_t>::min(), maxKey = std::numeric_limits<key_t>::max();
+	vector<data_t> results;
+	switch(compareOpeartor) {
+		case LT:
+			if (compareKey != minKey)
+				results = select(minKey, compareKey - 1);
+			break;
+		case LE:
+			results = select(minKey, compareKey);
+			break;
+		case EQ: {
+			data_t dataValue;
+			if (search(compareKey, dataValue))
+				results.push_back(dataValue);
+			break;
+		}
+		case GE:
+			results = select(compareKey, maxKey);
+			break;
+		case GT:
+			if (compareKey != maxKey)
+				results = select(compareKey + 1, maxKey);
+			break;
+		default:  // 范围查询
+			break;
+	}
+	return results;
+}
+
+/**
+ * @brief 选择介于smallKey和largeKey之间的所有叶节点的值，结果按键值递增排列
+ * 逐个叶结点读出并校验，每个叶结点的内容是某一时刻的快照，整个范围不是同一时刻的快照
+ */
+template <typename Key, typename Data, int NodeBytes>
+vector<Data> ConcurrentBPlusTree<Key, Data, NodeBytes>::select(key_t smallKey, key_t largeKey) {
+	EpochGuard guard(m_Epoch);
+	vector<data_t> results;
+	bool done = (largeKey < smallKey);
+	while (!done) {
+		// 冲突时从尚未读出的最小键值处重新下降
+		if (!_tryScan(smallKey, largeKey, results, done))
+			std::this_thread::yield();
+	}
+	return results;
+}
+
+
+// -----------------------------------------------------------------------
+//                                 Private
+// -----------------------------------------------------------------------
+
+/**
+ * @brief 内结点中key所在子树的下标，分隔键等于key时进入右子树
+ */
+template <typename Key, typename Data, int NodeBytes>
+int ConcurrentBPlusTree<Key, Data, NodeBytes>::Inner::childIndex(key_t key) const {
+	int n = this->safeKeyNum(MAXNUM_KEY);
+	int keyIndex = countLess<key_t>(keys, n, key);
+	return (keyIndex < n && keys[keyIndex] == key) ? keyIndex + 1 : keyIndex;
+}
+
+/**
+ * @brief 乐观地从根结点下降到key所在的叶结点，每读完一个结点的孩子指针都校验该结点的版本号
+ * 
+ * @param version 返回叶结点的版本号
+ * @param parent 返回叶结点的父结点，叶结点是根结点时为NULL
+ * @param parentVersion 返回父结点的版本号
+ * @param childIndex 返回叶结点在父结点中的下标
+ * @return Leaf* 叶结点，途中遇到冲突时为NULL，需要重试
+ */
+template <typename Key, typename Data, int NodeBytes>
+typename ConcurrentBPlusTree<Key, Data, NodeBytes>::Leaf *ConcurrentBPlusTree<Key, Data, NodeBytes>::_findLeaf(
+	key_t key, uint64_t &version, Inner *&parent, uint64_t &parentVersion, int &childIndex) {
+	Node *node = m_Root.load();
+	if (!node->lock.readLock(version) || node != m_Root.load())
+		return NULL;
+	parent = NULL;
+	parentVersion = 0;
+	childIndex = 0;
+	while (node->type == INTERNAL) {
+		Inner *inner = static_cast<Inner *>(node);
+		int index = inner->childIndex(key);
+		Node *child = inner->childs[index];
+		if (!inner->lock.validate(version))
+			return NULL;
+		uint64_t childVersion;
+		// 读孩子的版本号之后再校验一次，确保孩子在此之前没有被分裂或摘下
+		if (!child->lock.readLock(childVersion) || !inner->lock.validate(version))
+			return NULL;
+		parent = inner;
+		parentVersion = version;
+		childIndex = index;
+		node = child;
+		version = childVersion;
+	}
+	return static_cast<Leaf *>(node);
+}
+
+/**
+ * @brief 尝试插入一次，下降途中遇到已满的结点时先分裂它，再从根结点重新开始
+ * 
+ * @param inserted 返回是否插入了键值
+ * @return bool 是否完成，为false时需要重试
+ */
+template <typename Key, typename Data, int NodeBytes>
+bool ConcurrentBPlusTree<Key, Data, NodeBytes>::_tryInsert(key_t key, const data_t &data, bool &inserted) {
+	Node *node = m_Root.load();
+	uint64_t version, parentVersion = 0;
+	if (!node->lock.readLock(version) || node != m_Root.load())
+		return false;
+	Inner *parent = NULL;
+	while (node->type == INTERNAL) {
+		Inner *inner = static_cast<Inner *>(node);
+		if (inner->keyNum >= MAXNUM_KEY) {
+			_split(inner, version, parent, parentVersion);
+			return false;
+		}
+		Node *child = inner->childs[inner->childIndex(key)];
+		if (!inner->lock.validate(version))
+			return false;
+		uint64_t childVersion;
+		if (!child->lock.readLock(childVersion) || !inner->lock.validate(version))
+			return false;
+		parent = inner;
+		parentVersion = version;
+		node = child;
+		version = childVersion;
+	}
+	Leaf *leaf = static_cast<Leaf *>(node);
+	if (leaf->keyNum >= MAXNUM_LEAF) {
+		_split(leaf, version, parent, parentVersion);
+		return false;
+	}
+	int n = leaf->safeKeyNum(MAXNUM_LEAF);
+	int pos = countLess<key_t>(leaf->keys, n, key);
+	if (pos < n && leaf->keys[pos] == key) {
+		// 键值已存在
+		inserted = false;
+		return leaf->lock.validate(version);
+	}
+	if (!leaf->lock.upgrade(version))
+		return false;
+	for (int i = leaf->keyNum; i > pos; --i) {
+		leaf->keys[i] = leaf->keys[i - 1];
+		leaf->datas[i] = leaf->datas[i - 1];
+	}
+	leaf->keys[pos] = key;
+	leaf->datas[pos] = data;
+	leaf->keyNum += 1;
+	leaf->lock.writeUnlock();
+	inserted = true;
+	return true;
+}
+
+/**
+ * @brief 锁住已满的结点及其父结点，将结点分裂成两半，右半部分作为新结点插入父结点
+ * 结点是根结点时新建一个根结点，任一把锁加不上都直接返回，由调用者重试
+ * 
+ * @param node 已满的结点
+ * @param version 读node时记下的版本号
+ * @param parent node的父结点，node是根结点时为NULL
+ * @param parentVersion 读parent时记下的版本号
+ */
+template <typename Key, typename Data, int NodeBytes>
+void ConcurrentBPlusTree<Key, Data, NodeBytes>::_split(Node *node, uint64_t version, Inner *parent, uint64_t parentVersion) {
+	if (parent != NULL && !parent->lock.upgrade(parentVersion))
+		return;
+	if (!node->lock.upgrade(version)) {
+		if (parent != NULL)
+			parent->lock.writeUnlock();
+		return;
+	}
+	if (parent == NULL && node != m_Root.load()) {
+		// 读到node之后根结点已经换过了
+		node->lock.writeUnlock();
+		return;
+	}
+	key_t separator;
+	Node *rightNode;
+	if (node->type == LEAF) {
+		Leaf *leaf = static_cast<Leaf *>(node), *right = _newNode<Leaf>();
+		int numOfLeft = leaf->keyNum / 2;
+		right->keyNum = leaf->keyNum - numOfLeft;
+		for (int i = 0; i < right->keyNum; ++i) {
+			right->keys[i] = leaf->keys[numOfLeft + i];
+			right->datas[i] = leaf->datas[numOfLeft + i];
+		}
+		right->right = leaf->right;
+		leaf->right = right;
+		leaf->keyNum = numOfLeft;
+		separator = right->keys[0];
+		rightNode = right;
+	} else {
+		Inner *inner = static_cast<Inner *>(node), *right = _newNode<Inner>();
+		int numOfLeft = inner->keyNum / 2;		// 左半部分的键值个数，下一个键值上移到父结点
+		right->keyNum = inner->keyNum - numOfLeft - 1;
+		for (int i = 0; i < right->keyNum; ++i)
+			right->keys[i] = inner->keys[numOfLeft + 1 + i];
+		for (int i = 0; i <= right->keyNum; ++i)
+			right->childs[i] = inner->childs[numOfLeft + 1 + i];
+		inner->keyNum = numOfLeft;
+		separator = inner->keys[numOfLeft];
+		rightNode = right;
+	}
+	if (parent != NULL) {
+		int pos = countLess<key_t>(parent->keys, parent->keyNum, separator);
+		for (int i = parent->keyNum; i > pos; --i) {
+			parent->keys[i] = parent->keys[i - 1];
+			parent->childs[i + 1] = parent->childs[i];
+		}
+		parent->keys[pos] = separator;
+		parent->childs[pos + 1] = rightNode;
+		parent->keyNum += 1;
+	} else {
+		Inner *root = _newNode<Inner>();
+		root->keyNum = 1;
+		root->keys[0] = separator;
+		root->childs[0] = node;
+		root->childs[1] = rightNode;
+		m_Root.store(root);
+	}
+	node->lock.writeUnlock();
+	if (parent != NULL)
+		parent->lock.writeUnlock();
+}
+
+/**
+ * @brief 尝试删除一次
+ * 叶结点只剩被删的这一个键值、且有左兄弟同属一个父结点时，锁住父结点、左兄弟和叶结点，把叶结点整个摘下
+ * 
+ * @param removed 返回是否删除了键值
+ * @return bool 是否完成，为false时需要重试
+ */
+template <typename Key, typename Data, int NodeBytes>
+bool ConcurrentBPlusTree<Key, Data, NodeBytes>::_tryRemove(key_t key, data_t &dataValue, bool &removed) {
+	uint64_t version, parentVersion;
+	Inner *parent;
+	int childIndex;
+	Leaf *leaf = _findLeaf(key, version, parent, parentVersion, childIndex);
+	if (leaf == NULL)
+		return false;
+	int n = leaf->safeKeyNum(MAXNUM_LEAF);
+	int pos = countLess<key_t>(leaf->keys, n, key);
+	if (pos == n || leaf->keys[pos] != key) {
+		removed = false;
+		return leaf->lock.validate(version);
+	}
+	if (n == 1 && parent != NULL && childIndex > 0) {
+		// 摘下删空的叶结点
+		if (!parent->lock.upgrade(parentVersion))
+			return false;
+		Leaf *left = static_cast<Leaf *>(parent->childs[childIndex - 1]);
+		uint64_t leftVersion;
+		if (!left->lock.readLock(leftVersion) || !left->lock.upgrade(leftVersion)) {
+			parent->lock.writeUnlock();
+			return false;
+		}
+		if (!leaf->lock.upgrade(version)) {
+			left->lock.writeUnlock();
+			parent->lock.writeUnlock();
+			return false;
+		}
+		dataValue = leaf->datas[0];
+		left->right = leaf->right;
+		for (int i = childIndex - 1; i < parent->keyNum - 1; ++i)
+			parent->keys[i] = parent->keys[i + 1];
+		for (int i = childIndex; i < parent->keyNum; ++i)
+			parent->childs[i] = parent->childs[i + 1];
+		parent->keyNum -= 1;
+		leaf->lock.writeUnlockObsolete();
+		left->lock.writeUnlock();
+		parent->lock.writeUnlock();
+		_retire(leaf);
+	} else {
+		if (!leaf->lock.upgrade(version))
+			return false;
+		dataValue = leaf->datas[pos];
+		for (int i = pos; i < leaf->keyNum - 1; ++i) {
+			leaf->keys[i] = leaf->keys[i + 1];
+			leaf->datas[i] = leaf->datas[i + 1];
+		}
+		leaf->keyNum -= 1;
+		leaf->lock.writeUnlock();
+	}
+	removed = true;
+	return true;
+}
+
+/**
+ * @brief 尝试定值查找一次
+ * 
+ * @param found 返回是否找到了键值
+ * @return bool 是否完成，为false时需要重试
+ */
+template <typename Key, typename Data, int NodeBytes>
+bool ConcurrentBPlusTree<Key, Data, NodeBytes>::_trySearch(key_t key, data_t &dataValue, bool &found) {
+	uint64_t version, parentVersion;
+	Inner *parent;
+	int childIndex;
+	Leaf *leaf = _findLeaf(key, version, parent, parentVersion, childIndex);
+	if (leaf == NULL)
+		return false;
+	int n = leaf->safeKeyNum(MAXNUM_LEAF);
+	int pos = countLess<key_t>(leaf->keys, n, key);
+	found = (pos < n && leaf->keys[pos] == key);
+	if (found)
+		dataValue = leaf->datas[pos];
+	return leaf->lock.validate(version);
+}
+
+/**
+ * @brief 从fromKey开始沿右兄弟指针读叶结点，每个叶结点校验通过后才把其中的结果加入results
+ * 
+ * @param fromKey 尚未读出的最小键值，返回时更新为下一次应从哪里开始
+ * @param largeKey 范围的上界
+ * @param results 已读出的结果
+ * @param done 返回范围是否已读完
+ * @return bool 是否完成，为false时需要从fromKey处重新下降
+ */
+template <typename Key, typename Data, int NodeBytes>
+bool ConcurrentBPlusTree<Key, Data, NodeBytes>::_tryScan(key_t &fromKey, key_t largeKey, vector<data_t> &results, bool &done) {
+	uint64_t version, parentVersion;
+	Inner *parent;
+	int childIndex;
+	Leaf *leaf = _findLeaf(fromKey, version, parent, parentVersion, childIndex);
+	if (leaf == NULL)
+		return false;
+	data_t buffer[MAXNUM_LEAF];
+	for (;;) {
+		int n = leaf->safeKeyNum(MAXNUM_LEAF), count = 0;
+		int i = countLess<key_t>(leaf->keys, n, fromKey);
+		bool isLast = false;
+		for (; i < n; ++i) {
+			if (largeKey < leaf->keys[i]) {
+				isLast = true;
+				break;
+			}
+			buffer[count++] = leaf->datas[i];
+		}
+		key_t lastKey = (n > 0) ? leaf->keys[n - 1] : fromKey;
+		Leaf *next = leaf->right;
+		if (!leaf->lock.validate(version))
+			return false;
+		results.insert(results.end(), buffer, buffer + count);
+		if (n > 0) {
+			if (lastKey == std::numeric_limits<key_t>::max() || largeKey <= lastKey)
+				isLast = true;
+			else
+				fromKey = lastKey + 1;
+		}
+		if (isLast || next == NULL) {
+			done = true;
+			return true;
+		}
+		// 下一个叶结点已被摘下时由readLock发现，从fromKey处重新下降
+		if (!next->lock.readLock(version))
+			return false;
+		leaf = next;
+	}
+}
+
+/**
+ * @brief 从内存池中分配一个结点
+ */
+template <typename Key, typename Data, int NodeBytes>
+template <class N>
+N *ConcurrentBPlusTree<Key, Data, NodeBytes>::_newNode() {
+	std::lock_guard<std::mutex> guard(m_PoolMutex);
+	return m_Pool.create<N>();
+}
+
+/**
+ * @brief 将摘下的结点交给纪元管理器，并把已经没有线程会访问的结点归还内存池
+ */
+template <typename Key, typename Data, int NodeBytes>
+void ConcurrentBPlusTree<Key, Data, NodeBytes>::_retire(Node *node) {
+	vector<void *> reclaimable;
+	m_Epoch.retire(node, reclaimable);
+	if (reclaimable.empty())
+		return;
+	std::lock_guard<std::mutex> guard(m_PoolMutex);
+	for (size_t i = 0; i < reclaimable.size(); ++i)
+		m_Pool.deallocate(reclaimable[i]);
+}
@@ -0,0 +1,121 @@
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#pragma once
+
+#ifndef EPOCH_MANAGER
+#define EPOCH_MANAGER
+
+/**
+ * @brief 基于纪元(epoch)的内存回收
+ * 乐观读的线程不加锁，随时可能还拿着已从树中摘下的结点，因此结点摘下后不能马上释放
+ * 每个操作开始时登记当前的全局纪元，结束时撤销登记；结点摘下时记下当时的全局纪元，并让全局纪元加一
+ * 只有当所有仍在进行中的操作都是在该结点摘下之后才开始的，即登记的纪元都大于结点摘下时的纪元，结点才真正释放
+ */
+class EpochManager {
+public:
+	static const int MAX_THREADS = 64;			// 同时进行的操作数的上限
+	static const int RECLAIM_THRESHOLD = 64;	// 待回收的结点攒到这么多时尝试回收一次
+
+	EpochManager();
+	int enter();								// 登记当前纪元，返回占用的槽位
+	void exit(int slot);						// 撤销登记
+	void retire(void *node, std::vector<void *> &reclaimable);
+private:
+	static const uint64_t INACTIVE = UINT64_MAX;
+	struct Slot {
+		std::atomic<uint64_t> epoch;			// 槽位上登记的纪元，INACTIVE表示空闲
+		char padding[64 - sizeof(std::atomic<uint64_t>)];	// 每个槽位独占一个缓存行，避免不同线程互相干扰
+	};
+
+	std::atomic<uint64_t> m_GlobalEpoch;
+	Slot m_Slots[MAX_THREADS];
+	std::mutex m_Mutex;							// 保护m_Retired
+	std::vector<std::pair<uint64_t, void *>> m_Retired;	// 待回收的结点及其摘下时的纪元
+	uint64_t _minActiveEpoch();
+};
+
+/**
+ * @brief 在作用域内登记纪元，离开作用域时自动撤销
+ */
+class EpochGuard {
+public:
+	explicit EpochGuard(EpochManager &manager) : m_Manager(manager), m_Slot(manager.enter()) {}
+	~EpochGuard() { m_Manager.exit(m_Slot); }
+	EpochGuard(const EpochGuard &) = delete;
+	EpochGuard &operator=(const EpochGuard &) = delete;
+private:
+	EpochManager &m_Manager;
+	int m_Slot;
+};
+
+#endif // !EPOCH_MANAGER
+
+EpochManager::EpochManager() {
+	m_GlobalEpoch.store(0);
+	for (int i = 0; i < MAX_THREADS; ++i)
+		m_Slots[i].epoch.store(INACTIVE);
+}
+
+/**
+ * @brief 在一个空闲槽位上登记当前的全局纪元，所有槽位都被占用时等待
+ * 
+ * @return int 占用的槽位
+ */
+int EpochManager::enter() {
+	for (;;) {
+		for (int i = 0; i < MAX_THREADS; ++i) {
+			uint64_t expected = INACTIVE;
+			if (m_Slots[i].epoch.load(std::memory_order_relaxed) == INACTIVE &&
+				m_Slots[i].epoch.compare_exchange_strong(expected, m_GlobalEpoch.load()))
+				return i;
+		}
+		std::this_thread::yield();
+	}
+}
+
+/**
+ * @brief 撤销槽位上的登记
+ * 
+ * @param slot enter返回的槽位
+ */
+void EpochManager::exit(int slot) {
+	m_Slots[slot].epoch.store(INACTIVE);
+}
+
+/**
+ * @brief 登记一个已从树中摘下的结点，并取出所有可以安全释放的结点
+ * 
+ * @param node 已摘下的结点，调用者必须保证此后新开始的操作都不会再访问到它
+ * @param reclaimable 可以安全释放的结点，由调用者释放
+ */
+void EpochManager::retire(void *node, std::vector<void *> &reclaimable) {
+	std::lock_guard<std::mutex> guard(m_Mutex);
+	m_Retired.push_back(std::make_pair(m_GlobalEpoch.fetch_add(1), node));
+	if ((int)m_Retired.size() < RECLAIM_THRESHOLD)
+		return;
+	uint64_t minEpoch = _minActiveEpoch();
+	size_t kept = 0;
+	for (size_t i = 0; i < m_Retired.size(); ++i) {
+		if (m_Retired[i].first < minEpoch)
+			reclaimable.push_back(m_Retired[i].second);
+		else
+			m_Retired[kept++] = m_Retired[i];
+	}
+	m_Retired.resize(kept);
+}
+
+/**
+ * @brief 所有进行中的操作登记的最小纪元，没有进行中的操作时为INACTIVE
+ */
+uint64_t EpochManager::_minActiveEpoch() {
+	uint64_t minEpoch = INACTIVE;
+	for (int i = 0; i < MAX_THREADS; ++i) {
+		uint64_t epoch = m_Slots[i].epoch.load();
+		if (epoch < minEpoch)
+			minEpoch = epoch;
+	}
+	return minEpoch;
+}
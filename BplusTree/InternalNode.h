@@ -5,23 +5,24 @@
 #define INTERNAL_NODE
 
 
-class InternalNode : public BplusNode{
+template <class T>
+class InternalNode : public BplusNode<T>{
 public:
-	InternalNode():BplusNode() { setType(INTERNAL); }
-	virtual ~InternalNode() {}
+	typedef BplusNode<T> node_t;
+	typedef typename T::key_type key_t;
 
-	BplusNode *getChild(int i) const { return m_Childs[i]; }		// 获取子节点
-	void setChild(int i, BplusNode *child) { m_Childs[i] = child; }	// 修改指向孩子节点的指针
-	void insert(int keyIndex, int childIndex, key_t key, BplusNode *childNode);
-    
-	virtual void clear();
-	virtual void split(BplusNode *parentNode, int childIndex);
-	virtual void mergeChild(BplusNode *parentNode, BplusNode *childNode, int keyIndex);
-	virtual void removeKey(int keyIndex, int childIndex);
-	virtual void borrowFrom(BplusNode *destNode, BplusNode *parentNode, int keyIndex, SIBLING_DIRECTION d);
-	virtual int getChildIndex(key_t key, int keyIndex) const ;
+	InternalNode():node_t() { this->setType(INTERNAL); }
+
+	node_t *getChild(int i) const { return m_Childs[i]; }		// 获取子节点
+	void setChild(int i, node_t *child) { m_Childs[i] = child; }	// 修改指向孩子节点的指针
+	void insert(int keyIndex, int childIndex, key_t key, node_t *childNode);
+
+	void split(node_t *parentNode, int childIndex, NodePool &pool);
+	void mergeChild(node_t *parentNode, node_t *childNode, int keyIndex, NodePool &pool);
+	void removeKey(int keyIndex, int childIndex);
+	void borrowFrom(node_t *destNode, node_t *parentNode, int keyIndex, SIBLING_DIRECTION d);
 private:
-	BplusNode *m_Childs[MAXNUM_CHILD];	// 指向孩子节点的指针
+	node_t *m_Childs[T::MAXNUM_CHILD];	// 指向孩子节点的指针
 };
 
 #endif // !INTERNAL_NODE
@@ -34,29 +35,19 @@ private:
  * @param key 待插入键值
  * @param childNode 指向子节点的指针
  */
-void InternalNode::insert(int keyIndex, int childIndex, key_t key, BplusNode *childNode) {
+template <class T>
+void InternalNode<T>::insert(int keyIndex, int childIndex, key_t key, node_t *childNode) {
 	int i;
-	for (i = getKeyNum(); i > keyIndex; --i) {
+	for (i = this->getKeyNum(); i > keyIndex; --i) {
 		// 将父节点中的childIndex后的所有关键字的值和子树指针向后移一位
 		setChild(i + 1, m_Childs[i]);
-		setKeyValue(i, m_KeyValues[i - 1]);
+		this->setKeyValue(i, this->m_KeyValues[i - 1]);
 	}
 	if (i == childIndex)
         setChild(i + 1, m_Childs[i]);
     setChild(childIndex, childNode);
-	setKeyValue(keyIndex, key);
-    setKeyNum(m_KeyNum + 1);
-}
-
-/**
- * @brief 清空所有的内节点
- */
-void InternalNode::clear() {
-	for (int i = 0; i <= m_KeyNum; ++i) {
-		m_Childs[i]->clear();
-		delete m_Childs[i];
-		m_Childs[i] = 0;
-	}
+	this->setKeyValue(keyIndex, key);
+    this->setKeyNum(this->m_KeyNum + 1);
 }
 
 /**
@@ -64,38 +55,43 @@ void InternalNode::clear() {
  * 
  * @param parentNode 当前内节点的父节点
  * @param childIndex 当前内节点在父节点中对应键值的下标
+ * @param pool 分配新结点的内存池
  */
-void InternalNode::split(BplusNode *parentNode, int childIndex) {
-	InternalNode *newNode = new InternalNode(); //分裂后的右节点
-	newNode->setKeyNum(MINNUM_KEY);
-	for (int i = 0; i < MINNUM_KEY; ++i) {
+template <class T>
+void InternalNode<T>::split(node_t *parentNode, int childIndex, NodePool &pool) {
+	InternalNode *newNode = pool.create<InternalNode>(); //分裂后的右节点
+	newNode->setKeyNum(T::MINNUM_KEY);
+	for (int i = 0; i < T::MINNUM_KEY; ++i) {
 		// 拷贝关键字的值
-		newNode->setKeyValue(i, m_KeyValues[i + MINNUM_CHILD]);
+		newNode->setKeyValue(i, this->m_KeyValues[i + T::MINNUM_CHILD]);
 	}
-	for (int i = 0; i < MINNUM_CHILD; ++i) {
+	for (int i = 0; i < T::MINNUM_CHILD; ++i) {
 		// 拷贝孩子节点指针
-		newNode->setChild(i, m_Childs[i + MINNUM_CHILD]);
+		newNode->setChild(i, m_Childs[i + T::MINNUM_CHILD]);
 	}
-	setKeyNum(MINNUM_KEY);  //更新左子树的关键字个数
-	((InternalNode*)parentNode)->insert(childIndex, childIndex + 1, m_KeyValues[MINNUM_KEY], newNode);
+	this->setKeyNum(T::MINNUM_KEY);  //更新左子树的关键字个数
+	parentNode->asInternal()->insert(childIndex, childIndex + 1, this->m_KeyValues[T::MINNUM_KEY], newNode);
 }
- 
+
 /**
- * @brief 合并内节点
+ * @brief 合并内节点，合并后释放被合并的右兄弟
  * 
  * @param parentNode 当前节点的父节点
  * @param childNode 待合并的父节点的子节点
  * @param keyIndex 该键值在父结点中对应的下标
+ * @param pool 归还被合并结点的内存池
  */
-void InternalNode::mergeChild(BplusNode *parentNode, BplusNode *childNode, int keyIndex) {
+template <class T>
+void InternalNode<T>::mergeChild(node_t *parentNode, node_t *childNode, int keyIndex, NodePool &pool) {
+	InternalNode *rightNode = childNode->asInternal();
 	// 合并数据
-	insert(MINNUM_KEY, MINNUM_KEY+1, parentNode->getKeyValue(keyIndex), ((InternalNode*)childNode)->getChild(0));
-	for (int i = 1; i <= childNode->getKeyNum(); ++i) {
-        insert(MINNUM_KEY + i, MINNUM_KEY + i + 1, childNode->getKeyValue(i - 1), ((InternalNode *)childNode)->getChild(i));
+	insert(T::MINNUM_KEY, T::MINNUM_KEY + 1, parentNode->getKeyValue(keyIndex), rightNode->getChild(0));
+	for (int i = 1; i <= rightNode->getKeyNum(); ++i) {
+        insert(T::MINNUM_KEY + i, T::MINNUM_KEY + i + 1, rightNode->getKeyValue(i - 1), rightNode->getChild(i));
     }
 	//父节点删除index的key
 	parentNode->removeKey(keyIndex, keyIndex + 1);
-	delete ((InternalNode *)parentNode)->getChild(keyIndex + 1);
+	pool.deallocate(rightNode);
 }
 
 /**
@@ -104,12 +100,14 @@ void InternalNode::mergeChild(BplusNode *parentNode, BplusNode *childNode, int k
  * @param keyIndex 待移除键值的下标
  * @param childIndex 待移除的键值对应的子节点指针的下标
  */
-void InternalNode::removeKey(int keyIndex, int childIndex) {
-	for (int i = 0; i < (getKeyNum() - keyIndex - 1); ++i) {
-		setKeyValue(keyIndex + i, getKeyValue(keyIndex + i + 1));
-		setChild(childIndex + i, getChild(childIndex + i + 1));
-	}
-	setKeyNum(getKeyNum() - 1);
+template <class T>
+void InternalNode<T>::removeKey(int keyIndex, int childIndex) {
+	// 键值与孩子指针分别前移，childIndex可以等于keyIndex(移除最左的孩子)或keyIndex + 1
+	for (int i = keyIndex; i < this->getKeyNum() - 1; ++i)
+		this->setKeyValue(i, this->getKeyValue(i + 1));
+	for (int i = childIndex; i < this->getKeyNum(); ++i)
+		setChild(i, getChild(i + 1));
+	this->setKeyNum(this->getKeyNum() - 1);
 }
 
 /**
@@ -120,37 +118,25 @@ void InternalNode::removeKey(int keyIndex, int childIndex) {
  * @param keyIndex 需要填充的键值在该节点中的下标
  * @param d 被借的兄弟节点相对该节点的位置
  */
-void InternalNode::borrowFrom(BplusNode *siblingNode, BplusNode *parentNode, int keyIndex, SIBLING_DIRECTION d) {
+template <class T>
+void InternalNode<T>::borrowFrom(node_t *siblingNode, node_t *parentNode, int keyIndex, SIBLING_DIRECTION d) {
+	InternalNode *sibling = siblingNode->asInternal();
 	switch(d) {
 		case LEFT: {
 			// 从左兄弟结点借
-			insert(0, 0, parentNode->getKeyValue(keyIndex), ((InternalNode*)siblingNode)->getChild(siblingNode->getKeyNum()));
-			parentNode->setKeyValue(keyIndex, siblingNode->getKeyValue(siblingNode->getKeyNum()-1));
-			siblingNode->removeKey(siblingNode->getKeyNum()-1, siblingNode->getKeyNum());
+			insert(0, 0, parentNode->getKeyValue(keyIndex), sibling->getChild(sibling->getKeyNum()));
+			parentNode->setKeyValue(keyIndex, sibling->getKeyValue(sibling->getKeyNum()-1));
+			sibling->removeKey(sibling->getKeyNum()-1, sibling->getKeyNum());
 			break;
 		}
 		case RIGHT: {
 			// 从右兄弟结点借
-            insert(getKeyNum(), getKeyNum() + 1, parentNode->getKeyValue(keyIndex), ((InternalNode *)siblingNode)->getChild(0));
-            parentNode->setKeyValue(keyIndex, siblingNode->getKeyValue(0));
-			siblingNode->removeKey(0, 0);
+            insert(this->getKeyNum(), this->getKeyNum() + 1, parentNode->getKeyValue(keyIndex), sibling->getChild(0));
+            parentNode->setKeyValue(keyIndex, sibling->getKeyValue(0));
+			sibling->removeKey(0, 0);
 			break;
 		}
 		default:
 			break;
 	}
 }
-
-/**
- * @brief 根据条件获取子节点的下标
- * 
- * @param key 子节点的键值
- * @param keyIndex 子节点的
- * @return int 
- */
-int InternalNode::getChildIndex(key_t key, int keyIndex) const {
-	if (key == getKeyValue(keyIndex))
-        return keyIndex + 1;
-    else
-		return keyIndex;
-}
\ No newline at end of file
@@ -5,32 +5,34 @@
 #ifndef LEAF_NODE
 #define LEAF_NODE
 
-class LeafNode : public BplusNode{
+template <class T>
+class LeafNode : public BplusNode<T>{
 public:
-	LeafNode():BplusNode() {
-        setType(LEAF);
+	typedef BplusNode<T> node_t;
+	typedef typename T::key_type key_t;
+	typedef typename T::data_type data_t;
+
+	LeafNode():node_t() {
+        this->setType(LEAF);
         setLeftSibling(NULL); setRightSibling(NULL);
     }
-    ~LeafNode() {}
 
     LeafNode *getLeftSibling() const { return m_LeftSibling; }
 	void setLeftSibling(LeafNode *node) { m_LeftSibling = node; }
 	LeafNode *getRightSibling() const { return m_RightSibling; }
 	void setRightSibling(LeafNode *node) { m_RightSibling = node; }
-	tree_data_t getData(int i) const { return m_Datas[i]; }
-	void setData(int i, const tree_data_t &data) { m_Datas[i] = data; }
-	void insert(key_t key, const tree_data_t &data);
-    
-	virtual void split(BplusNode *parentNode, int childIndex);
-	virtual void mergeChild(BplusNode *parentNode, BplusNode *childNode, int keyIndex);
-	virtual void removeKey(int keyIndex, int childIndex);
-	virtual void clear();
-	virtual void borrowFrom(BplusNode *destNode, BplusNode *parentNode, int keyIndex, SIBLING_DIRECTION d);
-	virtual int getChildIndex(key_t key, int keyIndex)const;
+	data_t getData(int i) const { return m_Datas[i]; }
+	void setData(int i, const data_t &data) { m_Datas[i] = data; }
+	void insert(key_t key, const data_t &data);
+
+	void split(node_t *parentNode, int childIndex, NodePool &pool);
+	void mergeChild(node_t *parentNode, node_t *childNode, int keyIndex, NodePool &pool);
+	void removeKey(int keyIndex, int childIndex);
+	void borrowFrom(node_t *destNode, node_t *parentNode, int keyIndex, SIBLING_DIRECTION d);
 private:
 	LeafNode *m_LeftSibling;
 	LeafNode *m_RightSibling;
-	tree_data_t m_Datas[MAXNUM_LEAF];
+	data_t m_Datas[T::MAXNUM_LEAF];
 };
 
 #endif // !LEAF_NODE
@@ -41,26 +43,16 @@ private:
  * @param key 待插入叶结点的键值
  * @param data 待插入叶节点的数值
  */
-void LeafNode::insert(key_t key, const tree_data_t &data) {
+template <class T>
+void LeafNode<T>::insert(key_t key, const data_t &data) {
 	int i;
-	for (i = m_KeyNum; i >= 1 && m_KeyValues[i - 1] > key; --i) {
-		setKeyValue(i, m_KeyValues[i - 1]);
+	for (i = this->m_KeyNum; i >= 1 && this->m_KeyValues[i - 1] > key; --i) {
+		this->setKeyValue(i, this->m_KeyValues[i - 1]);
 		setData(i, m_Datas[i - 1]);
 	}
-	setKeyValue(i, key);
+	this->setKeyValue(i, key);
 	setData(i, data);
-	setKeyNum(m_KeyNum + 1);
-}
-
-/**
- * @brief 清空所有叶节点
- */
-void LeafNode::clear() {
-	for (int i = 0; i < m_KeyNum; ++i) {
-		// if type of m_Datas is pointer
-		//delete m_Datas[i];
-		//m_Datas[i] = NULL;
-	}
+	this->setKeyNum(this->m_KeyNum + 1);
 }
 
 /**
@@ -68,51 +60,62 @@ void LeafNode::clear() {
  * 
  * @param parentNode 当前叶节点的父节点指针
  * @param childIndex 当前叶节点在父节点中对应键值的下标
+ * @param pool 分配新结点的内存池
  */
-void LeafNode::split(BplusNode *parentNode, int childIndex) {
-	LeafNode *newNode = new LeafNode();//分裂后的右节点
-	setKeyNum(MINNUM_LEAF);
-	newNode->setKeyNum(MINNUM_LEAF + 1);
+template <class T>
+void LeafNode<T>::split(node_t *parentNode, int childIndex, NodePool &pool) {
+	LeafNode *newNode = pool.create<LeafNode>();//分裂后的右节点
+	this->setKeyNum(T::MINNUM_LEAF);
+	newNode->setKeyNum(T::MINNUM_LEAF + 1);
 	newNode->setRightSibling(getRightSibling());
+	if (getRightSibling() != NULL)
+		getRightSibling()->setLeftSibling(newNode);
 	setRightSibling(newNode);
 	newNode->setLeftSibling(this);
 	int i;
-	for (i =0 ; i < MINNUM_LEAF + 1; ++i) {
+	for (i =0 ; i < T::MINNUM_LEAF + 1; ++i) {
 		// 拷贝关键字的值
-		newNode->setKeyValue(i, m_KeyValues[i + MINNUM_LEAF]);
+		newNode->setKeyValue(i, this->m_KeyValues[i + T::MINNUM_LEAF]);
 	}
-	for (i = 0; i < MINNUM_LEAF + 1; ++i) {
+	for (i = 0; i < T::MINNUM_LEAF + 1; ++i) {
 		// 拷贝数据
-		newNode->setData(i, m_Datas[i + MINNUM_LEAF]);
+		newNode->setData(i, m_Datas[i + T::MINNUM_LEAF]);
 	}
-	((InternalNode *)parentNode)->insert(childIndex, childIndex + 1, m_KeyValues[MINNUM_LEAF], newNode);
+	parentNode->asInternal()->insert(childIndex, childIndex + 1, this->m_KeyValues[T::MINNUM_LEAF], newNode);
 }
 
 /**
- * @brief 合并叶节点
+ * @brief 合并叶节点，合并后释放被合并的右兄弟
  * 
  * @param parentNode 叶节点的父节点指针
  * @param childNode 待合并的叶结点指针
  * @param keyIndex 该键值在父结点中对应的下标
+ * @param pool 归还被合并结点的内存池
  */
-void LeafNode::mergeChild(BplusNode *parentNode, BplusNode *childNode, int keyIndex) {
+template <class T>
+void LeafNode<T>::mergeChild(node_t *parentNode, node_t *childNode, int keyIndex, NodePool &pool) {
+	LeafNode *rightNode = childNode->asLeaf();
 	// 合并数据
-	for (int i = 0; i < childNode->getKeyNum(); ++i)
-		insert(childNode->getKeyValue(i), ((LeafNode*)childNode)->getData(i));
-	setRightSibling(((LeafNode *)childNode)->getRightSibling());
+	for (int i = 0; i < rightNode->getKeyNum(); ++i)
+		insert(rightNode->getKeyValue(i), rightNode->getData(i));
+	setRightSibling(rightNode->getRightSibling());
+	if (getRightSibling() != NULL)
+		getRightSibling()->setLeftSibling(this);
 	//父节点删除index的key，
 	parentNode->removeKey(keyIndex, keyIndex + 1);
+	pool.deallocate(rightNode);
 }
- 
+
 /**
  * @brief 根据叶结点的下标，从节点中移除键值
  */
-void LeafNode::removeKey(int keyIndex, int childIndex) {
-	for (int i = keyIndex; i < getKeyNum() - 1; ++i) {
-		setKeyValue(i, getKeyValue(i + 1));
+template <class T>
+void LeafNode<T>::removeKey(int keyIndex, int childIndex) {
+	for (int i = keyIndex; i < this->getKeyNum() - 1; ++i) {
+		this->setKeyValue(i, this->getKeyValue(i + 1));
 		setData(i, getData(i + 1));
 	}
-	setKeyNum(getKeyNum() - 1);
+	this->setKeyNum(this->getKeyNum() - 1);
 }
 
 /**
@@ -123,25 +126,25 @@ void LeafNode::removeKey(int keyIndex, int childIndex) {
  * @param keyIndex 需要填充的键值在该节点中的下标
  * @param d 被借的兄弟节点的相对位置
  */
-void LeafNode::borrowFrom(BplusNode *siblingNode, BplusNode *parentNode, int keyIndex, SIBLING_DIRECTION d) {
+template <class T>
+void LeafNode<T>::borrowFrom(node_t *siblingNode, node_t *parentNode, int keyIndex, SIBLING_DIRECTION d) {
+	LeafNode *sibling = siblingNode->asLeaf();
 	switch(d) {
 		case LEFT: {
 			// 从左兄弟结点借
-			insert(siblingNode->getKeyValue(siblingNode->getKeyNum() - 1), ((LeafNode *)siblingNode)->getData(siblingNode->getKeyNum() - 1));
-			siblingNode->removeKey(siblingNode->getKeyNum() - 1, siblingNode->getKeyNum() - 1);
-			parentNode->setKeyValue(keyIndex, getKeyValue(0));
+			insert(sibling->getKeyValue(sibling->getKeyNum() - 1), sibling->getData(sibling->getKeyNum() - 1));
+			sibling->removeKey(sibling->getKeyNum() - 1, sibling->getKeyNum() - 1);
+			parentNode->setKeyValue(keyIndex, this->getKeyValue(0));
 			break;
 		}
 		case RIGHT: {
 			// 从右兄弟结点借
-			insert(siblingNode->getKeyValue(0), ((LeafNode *)siblingNode)->getData(0));
-			siblingNode->removeKey(0, 0);
-			parentNode->setKeyValue(keyIndex, siblingNode->getKeyValue(0));
+			insert(sibling->getKeyValue(0), sibling->getData(0));
+			sibling->removeKey(0, 0);
+			parentNode->setKeyValue(keyIndex, sibling->getKeyValue(0));
 			break;
 		}
 		default:
 			break;
 	}
 }
- 
-int LeafNode::getChildIndex(key_t key, int keyIndex) const { return keyIndex; }
\ No newline at end of file
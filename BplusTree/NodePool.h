@@ -0,0 +1,133 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <vector>
+#include "../Block/Block.h"
+#pragma once
+
+#ifndef NODE_POOL
+#define NODE_POOL
+
+/**
+ * @brief B+树结点的内存池
+ * 结点从一次申请的大块内存(slab)中按固定大小的槽位依次切出，同一棵树的结点在内存中紧挨着存放
+ * 合并时释放的单个结点挂到空闲链表上，留给之后分裂时复用
+ * 清空B+树时不必逐个释放结点，只需把所有槽位一次性归还给内存池，已申请的slab留给重新建树时使用
+ * 结点不调用析构函数，因此结点类型必须可以平凡析构
+ */
+class NodePool {
+public:
+	NodePool(size_t nodeSize, size_t alignment, int nodesPerSlab = 256);
+	~NodePool() { release(); }
+	NodePool(const NodePool &) = delete;
+	NodePool &operator=(const NodePool &) = delete;
+
+	void *allocate();						// 取一个空槽位
+	void deallocate(void *node);			// 归还一个槽位
+	void reset();							// 归还所有槽位，保留已申请的slab
+	void release();							// 归还所有槽位，并释放所有slab
+	template <class Node> Node *create() { return new (allocate()) Node(); }
+	int numOfSlabs() const { return m_Slabs.size(); }
+private:
+	struct FreeSlot { FreeSlot *next; };
+
+	size_t m_SlotSize;						// 每个槽位的字节数，是对齐长度的整数倍
+	size_t m_Alignment;						// 槽位的对齐长度
+	int m_NodesPerSlab;						// 每个slab的槽位数
+	std::vector<void *> m_Slabs;			// 申请到的slab，未对齐的原始地址
+	size_t m_CurSlab;						// 正在切分的slab
+	int m_NextSlot;							// 当前slab中下一个未用过的槽位
+	FreeSlot *m_FreeList;					// 被归还的槽位
+	char *_slabBase(size_t i) const;
+};
+
+#endif // !NODE_POOL
+
+/**
+ * @brief 创建内存池
+ * 
+ * @param nodeSize 结点的字节数
+ * @param alignment 槽位的对齐长度，取缓存行大小时每个结点都从缓存行的起点开始
+ * @param nodesPerSlab 每个slab的槽位数
+ */
+NodePool::NodePool(size_t nodeSize, size_t alignment, int nodesPerSlab) {
+	if (nodeSize < sizeof(FreeSlot))
+		nodeSize = sizeof(FreeSlot);
+	m_Alignment = alignment;
+	m_SlotSize = (nodeSize + alignment - 1) / alignment * alignment;
+	m_NodesPerSlab = nodesPerSlab;
+	m_CurSlab = 0;
+	m_NextSlot = 0;
+	m_FreeList = NULL;
+}
+
+/**
+ * @brief 取一个空槽位，优先复用被归还的槽位，其次切分当前的slab，都没有时再申请新的slab
+ * 
+ * @return void* 槽位的起始地址，按m_Alignment对齐
+ */
+void *NodePool::allocate() {
+	if (m_FreeList != NULL) {
+		FreeSlot *slot = m_FreeList;
+		m_FreeList = slot->next;
+		return slot;
+	}
+	if (m_CurSlab < m_Slabs.size() && m_NextSlot == m_NodesPerSlab) {
+		// 当前slab已切完，换到下一个slab
+		m_CurSlab += 1;
+		m_NextSlot = 0;
+	}
+	if (m_CurSlab == m_Slabs.size()) {
+		void *slab = malloc(m_SlotSize * m_NodesPerSlab + m_Alignment);
+		if (slab == NULL) {
+			printf("错误：无法为B+树结点申请内存！\n");
+			system("pause");
+			exit(FAIL);
+		}
+		m_Slabs.push_back(slab);
+	}
+	void *slot = _slabBase(m_CurSlab) + m_SlotSize * m_NextSlot;
+	m_NextSlot += 1;
+	return slot;
+}
+
+/**
+ * @brief 归还一个槽位，槽位挂到空闲链表上
+ * 
+ * @param node 由allocate取得的槽位
+ */
+void NodePool::deallocate(void *node) {
+	if (node == NULL)
+		return;
+	FreeSlot *slot = static_cast<FreeSlot *>(node);
+	slot->next = m_FreeList;
+	m_FreeList = slot;
+}
+
+/**
+ * @brief 一次性归还所有槽位，之后从第一个slab开始重新切分
+ */
+void NodePool::reset() {
+	m_CurSlab = 0;
+	m_NextSlot = 0;
+	m_FreeList = NULL;
+}
+
+/**
+ * @brief 归还所有槽位并释放所有slab
+ */
+void NodePool::release() {
+	for (size_t i = 0; i < m_Slabs.size(); ++i)
+		free(m_Slabs[i]);
+	m_Slabs.clear();
+	reset();
+}
+
+/**
+ * @brief 第i个slab中第一个槽位的地址，即slab的原始地址向上对齐到m_Alignment
+ */
+char *NodePool::_slabBase(size_t i) const {
+	uintptr_t addr = (uintptr_t)m_Slabs[i];
+	return (char *)((addr + m_Alignment - 1) / m_Alignment * m_Alignment);
+}
@@ -1,35 +1,37 @@
 #include <iostream>
+#include <thread>
 #include "BplusTree.h"
+#include "ConcurrentBplusTree.h"
 
-BPlusTree Tr;
+BPlusTree<int> Tr;
 
-bool INSERT(key_t a, tree_data_t b) {
+bool INSERT(int a, tree_data_t b) {
     if (Tr.insert(a, b)) {
-        printf("insert(%.0f, %d) -- OK\n", a, b);
+        printf("insert(%d, %d) -- OK\n", a, b);
         return true;
     } else {
-        printf("insert(%.0f, %d) -- Error\n", a, b);
+        printf("insert(%d, %d) -- Error\n", a, b);
         return false;
     }
 }
 
-bool UPDATE(key_t a, key_t b) {
+bool UPDATE(int a, int b) {
     if (Tr.update(a, b)) {
-        printf("update(%.0f, %.0f) -- OK\n", a, b);
+        printf("update(%d, %d) -- OK\n", a, b);
         return true;
     } else {
-        printf("update(%.0f, %.0f) -- Error\n", a, b);
+        printf("update(%d, %d) -- Error\n", a, b);
         return false;
     }
 }
 
-bool REMOVE(key_t a) {
+bool REMOVE(int a) {
     addr_t temp;
     if (Tr.remove(a, temp)) {
-        printf("remove(%.1f) -- OK\n", a);
+        printf("remove(%d) -- OK\n", a);
         return true;
     } else {
-        printf("remove(%f) -- Error\n", a);
+        printf("remove(%d) -- Error\n", a);
         return false;
     }
 }
@@ -54,6 +56,46 @@ int main() {
     REMOVE(6);
     Tr.printData();
 
+    // 批量建树，叶结点只填75%，之后的插入不必马上分裂
+    vector<BPlusTree<int>::item_t> items;
+    for (int i = 1; i <= 40; ++i)
+        items.push_back(BPlusTree<int>::item_t(i, i * 10));
+    cout << "bulkLoad 1..40: " << (Tr.bulkLoad(items, 0.75) ? "OK" : "Error") << endl;
+    Tr.printData();
+    INSERT(41, 410);
+    data = Tr.select(20, EQ);
+    cout << "select 20: " << (data.empty() ? 0 : data[0]) << endl;
+
+    // 用游标从25开始顺序扫描，遇到大于30的键值即停止，再从40往回走3步
+    cout << "scan 25..30:";
+    for (BPlusTree<int>::Cursor cursor = Tr.seek(25); cursor.isValid() && cursor.key() <= 30; cursor.next())
+        cout << " " << cursor.key() << "->" << cursor.data();
+    cout << endl;
+    cout << "back from 40:";
+    BPlusTree<int>::Cursor cursor = Tr.seek(40);
+    for (int i = 0; i < 3 && cursor.isValid(); ++i, cursor.prev())
+        cout << " " << cursor.key();
+    cout << endl;
+
+    // 4个线程同时插入，另外2个线程同时做范围查询
+    ConcurrentBPlusTree<int> concurrentTree;
+    vector<thread> workers;
+    for (int t = 0; t < 4; ++t) {
+        workers.push_back(thread([&concurrentTree, t]() {
+            for (int i = t; i < 4000; i += 4)
+                concurrentTree.insert(i, i * 10);
+        }));
+    }
+    for (int t = 0; t < 2; ++t) {
+        workers.push_back(thread([&concurrentTree]() {
+            for (int i = 0; i < 100; ++i)
+                concurrentTree.select(1000, 1100);
+        }));
+    }
+    for (auto &worker : workers)
+        worker.join();
+    cout << "concurrent insert 0..3999: " << concurrentTree.select(0, 3999).size() << " keys" << endl;
+
     system("pause");
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <random>
+#include "ConcurrentBplusTree.h"
+
+/**
+ * @brief ConcurrentBPlusTree的并发压力测试
+ * 每一轮先由多个线程并发插入[0, NUM_KEYS)，再并发删除其中成段的键值，使整片叶结点被删空、从兄弟链表中摘下并交给EpochManager
+ * 最后删掉剩下的键值，被回收的结点在下一轮插入时又从内存池中分配出去
+ * 写线程工作的同时，读线程不停地做定值查找和范围查询，检查读到的值与键值对应、范围查询的结果严格递增
+ * 建议加-fsanitize=address编译，摘下的结点若被提前释放，读线程访问它时会报告use-after-free
+ */
+
+const int NUM_KEYS = 20000;
+const int NUM_WRITERS = 4;
+const int NUM_READERS = 4;
+const int NUM_ROUNDS = 8;
+const int RUN_LENGTH = 256;     // 每次成段删除的键值个数，远多于一个叶结点的容量
+
+ConcurrentBPlusTree<int> Tr;
+std::atomic<int> numOfErrors(0);
+
+/**
+ * @brief 第round轮中第一次删除时是否删掉key
+ * 奇偶轮删除的段错开，使每一轮摘下的都是不同位置的叶结点
+ */
+bool removedFirst(int key, int round) { return (key / RUN_LENGTH + round) % 2 == 0; }
+
+/**
+ * @brief 读线程：在写线程工作时不停地查询，直到stop被置位
+ */
+void reader(int seed, const std::atomic<bool> &stop) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> keyDist(0, NUM_KEYS - 1);
+    while (!stop.load()) {
+        int key = keyDist(rng);
+        tree_data_t data;
+        if (Tr.search(key, data) && data != (tree_data_t)key * 10)
+            numOfErrors += 1;
+        int high = key + RUN_LENGTH * 2;
+        vector<tree_data_t> results = Tr.select(key, high);
+        for (size_t i = 0; i < results.size(); ++i) {
+            bool inRange = (results[i] % 10 == 0 && results[i] >= (tree_data_t)key * 10 && results[i] <= (tree_data_t)high * 10);
+            if (!inRange || (i > 0 && results[i] <= results[i - 1]))
+                numOfErrors += 1;
+        }
+    }
+}
+
+/**
+ * @brief 用NUM_WRITERS个写线程并发执行op，同时由NUM_READERS个读线程并发查询
+ * 
+ * @param op 写线程的操作，参数为写线程的编号
+ */
+template <class Op>
+void runConcurrently(Op op, int round) {
+    std::atomic<bool> stop(false);
+    vector<thread> readers, writers;
+    for (int t = 0; t < NUM_READERS; ++t)
+        readers.push_back(thread(reader, round * NUM_READERS + t, std::cref(stop)));
+    for (int t = 0; t < NUM_WRITERS; ++t)
+        writers.push_back(thread(op, t));
+    for (auto &worker : writers)
+        worker.join();
+    stop.store(true);
+    for (auto &worker : readers)
+        worker.join();
+}
+
+/**
+ * @brief 检查树中恰好是满足isKept的键值，且每个值都与键值对应
+ */
+bool checkKeys(bool (*isKept)(int, int), int round) {
+    vector<tree_data_t> results = Tr.select(0, NUM_KEYS - 1);
+    size_t pos = 0;
+    for (int key = 0; key < NUM_KEYS; ++key) {
+        if (!isKept(key, round))
+            continue;
+        if (pos >= results.size() || results[pos] != (tree_data_t)key * 10)
+            return false;
+        pos += 1;
+    }
+    return pos == results.size();
+}
+
+bool keptAll(int, int) { return true; }
+bool keptAfterFirst(int key, int round) { return !removedFirst(key, round); }
+bool keptNone(int, int) { return false; }
+
+int main() {
+    for (int round = 0; round < NUM_ROUNDS; ++round) {
+        std::atomic<int> numOfInserted(0), numOfRemoved(0);
+        runConcurrently([&numOfInserted](int t) {
+            for (int key = t; key < NUM_KEYS; key += NUM_WRITERS)
+                numOfInserted += Tr.insert(key, (tree_data_t)key * 10);
+        }, round);
+        bool isOK = (numOfInserted == NUM_KEYS) && checkKeys(keptAll, round);
+
+        // 各写线程轮流删除成段的键值，整片叶结点被删空后从树中摘下
+        runConcurrently([&numOfRemoved, round](int t) {
+            tree_data_t data;
+            for (int key = t; key < NUM_KEYS; key += NUM_WRITERS) {
+                if (removedFirst(key, round))
+                    numOfRemoved += Tr.remove(key, data);
+            }
+        }, round);
+        isOK = isOK && checkKeys(keptAfterFirst, round);
+
+        // 删掉剩下的键值，下一轮插入时复用被回收的结点
+        runConcurrently([&numOfRemoved, round](int t) {
+            tree_data_t data;
+            for (int key = NUM_KEYS - 1 - t; key >= 0; key -= NUM_WRITERS) {
+                if (!removedFirst(key, round))
+                    numOfRemoved += Tr.remove(key, data);
+            }
+        }, round);
+        isOK = isOK && (numOfRemoved == NUM_KEYS) && checkKeys(keptNone, round);
+
+        printf("round %d: insert %d, remove %d -- %s\n", round, numOfInserted.load(), numOfRemoved.load(),
+            (isOK && numOfErrors == 0) ? "OK" : "Error");
+        if (!isOK || numOfErrors != 0)
+            return 1;
+    }
+    cout << "concurrent insert/remove/scan: " << NUM_ROUNDS << " rounds OK" << endl;
+
+    system("pause");
+    return 0;
+}
@@ -0,0 +1,412 @@
+#include <cstdint>
+#include <map>
+#include "utils.cpp"
+#include "index.cpp"
+#pragma once
+
+/**
+ * @brief 位图索引
+ * 
+ * 为索引字段的每个取值建立一个位图，第i位为1表示行号为i的记录取该值，行号的含义同二级索引
+ * 位图按WAH(Word-Aligned Hybrid)方式压缩，每个32位的字有两种：
+ *   文字字：最高位为0，低31位原样存放31个连续的位
+ *   填充字：最高位为1，次高位为填充的位值，低30位为连续的全0或全1的31位组个数
+ * 压缩后的位图可以直接按字做与、或运算和计数，不必先解压
+ * 
+ * 索引文件按v2格式写出，先依次存放各个取值的位图：(取值, 字数)一行，之后每行两个字
+ * 再存放目录：每项为(取值, 该取值位图首行的位置)，位置为所在块地址 * 每块行数 + 块内序号
+ * 目录按取值有序，占一段连续的块，查找一个取值时在其中折半查找
+ */
+
+typedef struct BitmapIndex {
+    addr_t start = END_OF_FILE;         // 索引文件的首地址，即第一个位图所在的块
+    addr_t directory = END_OF_FILE;     // 目录的首地址，目录并入索引文件
+    int numOfValues = 0;                // 索引字段的取值个数
+} bitmap_index_t;
+
+typedef std::map<std::pair<addr_t, int>, bitmap_index_t> bitmap_map_t;
+
+bitmap_map_t bitmapIndexMap;    // 位图索引映射表，格式为<(原表首地址, 索引字段), 该表的位图索引>
+
+
+/**
+ * @brief WAH压缩的位图
+ */
+class WahBitmap {
+public:
+    static const int GROUP_BITS = 31;                       // 每个31位组的位数
+    static const uint32_t FILL_FLAG = 0x80000000U;          // 填充字的标志位
+    static const uint32_t FILL_ONE = 0x40000000U;           // 填充值为1的填充字的标志位
+    static const uint32_t LITERAL_MASK = 0x7FFFFFFFU;       // 文字字的有效位，也是全1的文字字
+    static const uint32_t MAX_FILL = 0x3FFFFFFFU;           // 一个填充字最多表示的组数
+
+    WahBitmap() : m_NumOfGroups(0) {}
+    void append(int pos);
+    int count() const;
+    void positions(std::vector<int> &pos) const;
+    WahBitmap operator&(const WahBitmap &other) const { return _combine(other, true); }
+    WahBitmap operator|(const WahBitmap &other) const { return _combine(other, false); }
+    const std::vector<uint32_t> &words() const { return m_Words; }
+    static WahBitmap fromWords(const std::vector<uint32_t> &words);
+
+private:
+    /**
+     * @brief 按31位组顺序读一个位图，一个填充字可以整段跳过
+     */
+    struct Reader {
+        const std::vector<uint32_t> &words;
+        size_t index = 0;       // 当前字的下标
+        uint32_t left = 0;      // 当前字中剩余的组数
+        Reader(const std::vector<uint32_t> &words) : words(words) { _load(); }
+        bool hasMore() const { return index < words.size(); }
+        bool isFill() const { return (words[index] & FILL_FLAG) != 0; }
+        bool fillValue() const { return (words[index] & FILL_ONE) != 0; }
+        uint32_t literal() const { return isFill() ? (fillValue() ? LITERAL_MASK : 0) : words[index]; }
+        void skip(uint32_t n);
+        void _load() { left = hasMore() ? (isFill() ? (words[index] & MAX_FILL) : 1) : 0; }
+    };
+
+    std::vector<uint32_t> m_Words;
+    uint32_t m_NumOfGroups;     // 已表示的组数
+    void _appendLiteral(uint32_t word);
+    void _appendFill(bool value, uint32_t n);
+    WahBitmap _combine(const WahBitmap &other, bool isAnd) const;
+};
+
+
+/**
+ * @brief 跳过n组，位图中剩下的组不足n组时停在末尾
+ */
+void WahBitmap::Reader::skip(uint32_t n) {
+    while (n > 0 && hasMore()) {
+        uint32_t step = std::min(n, left);
+        left -= step, n -= step;
+        if (left == 0) {
+            index += 1;
+            _load();
+        }
+    }
+}
+
+
+/**
+ * @brief 将第pos位置为1
+ * 
+ * @param pos 位的序号，须按递增的顺序添加
+ */
+void WahBitmap::append(int pos) {
+    uint32_t group = pos / GROUP_BITS, bit = 1U << (pos % GROUP_BITS);
+    if (group + 1 == m_NumOfGroups && !m_Words.empty() && !(m_Words.back() & FILL_FLAG)) {
+        // 仍在最后一个文字字中
+        uint32_t word = m_Words.back() | bit;
+        m_Words.pop_back();
+        m_NumOfGroups -= 1;
+        _appendLiteral(word);
+        return;
+    }
+    _appendFill(false, group - m_NumOfGroups);
+    _appendLiteral(bit);
+}
+
+
+/**
+ * @brief 统计位图中1的个数，只看压缩后的字
+ */
+int WahBitmap::count() const {
+    int numOfOnes = 0;
+    for (uint32_t word : m_Words) {
+        if (word & FILL_FLAG)
+            numOfOnes += (word & FILL_ONE) ? (word & MAX_FILL) * GROUP_BITS : 0;
+        else
+            numOfOnes += __builtin_popcount(word);
+    }
+    return numOfOnes;
+}
+
+
+/**
+ * @brief 按递增的顺序取出所有为1的位的序号
+ * 
+ * @param pos 取出的序号
+ */
+void WahBitmap::positions(std::vector<int> &pos) const {
+    pos.clear();
+    int base = 0;
+    for (uint32_t word : m_Words) {
+        if (word & FILL_FLAG) {
+            int numOfBits = (word & MAX_FILL) * GROUP_BITS;
+            if (word & FILL_ONE) {
+                for (int i = 0; i < numOfBits; ++i)
+                    pos.push_back(base + i);
+            }
+            base += numOfBits;
+        } else {
+            for (int i = 0; i < GROUP_BITS; ++i) {
+                if (word & (1U << i))
+                    pos.push_back(base + i);
+            }
+            base += GROUP_BITS;
+        }
+    }
+}
+
+
+/**
+ * @brief 由压缩后的字恢复位图
+ * 
+ * @param words 压缩后的字
+ * @return WahBitmap 恢复的位图
+ */
+WahBitmap WahBitmap::fromWords(const std::vector<uint32_t> &words) {
+    WahBitmap bitmap;
+    bitmap.m_Words = words;
+    for (uint32_t word : words)
+        bitmap.m_NumOfGroups += (word & FILL_FLAG) ? (word & MAX_FILL) : 1;
+    return bitmap;
+}
+
+
+/**
+ * @brief 在末尾添加一个组，全0或全1的组并入填充字
+ */
+void WahBitmap::_appendLiteral(uint32_t word) {
+    if (word == 0 || word == LITERAL_MASK) {
+        _appendFill(word != 0, 1);
+        return;
+    }
+    m_Words.push_back(word);
+    m_NumOfGroups += 1;
+}
+
+
+/**
+ * @brief 在末尾添加n个全为value的组，能并入最后一个填充字时直接并入
+ */
+void WahBitmap::_appendFill(bool value, uint32_t n) {
+    m_NumOfGroups += n;
+    uint32_t flag = FILL_FLAG | (value ? FILL_ONE : 0);
+    if (n > 0 && !m_Words.empty() && (m_Words.back() & ~MAX_FILL) == flag) {
+        uint32_t merged = std::min(n, MAX_FILL - (m_Words.back() & MAX_FILL));
+        m_Words.back() += merged;
+        n -= merged;
+    }
+    while (n > 0) {
+        uint32_t fill = (n < MAX_FILL) ? n : MAX_FILL;
+        m_Words.push_back(flag | fill);
+        n -= fill;
+    }
+}
+
+
+/**
+ * @brief 两个位图按位做与或者或运算
+ * 一方是能决定结果的填充字(与运算时的全0，或运算时的全1)时，整段跳过另一方
+ * 
+ * @param other 另一个位图
+ * @param isAnd 为true时做与运算，否则做或运算
+ * @return WahBitmap 运算结果
+ */
+WahBitmap WahBitmap::_combine(const WahBitmap &other, bool isAnd) const {
+    WahBitmap res;
+    Reader x(m_Words), y(other.m_Words);
+    while (x.hasMore() && y.hasMore()) {
+        bool xDominates = x.isFill() && x.fillValue() != isAnd;
+        bool yDominates = y.isFill() && y.fillValue() != isAnd;
+        if (xDominates || yDominates || (x.isFill() && y.isFill())) {
+            uint32_t n;
+            if (xDominates && yDominates)
+                n = std::max(x.left, y.left);
+            else if (xDominates)
+                n = x.left;
+            else if (yDominates)
+                n = y.left;
+            else
+                n = std::min(x.left, y.left);
+            bool value = isAnd ? (x.fillValue() && y.fillValue()) : (x.fillValue() || y.fillValue());
+            if (xDominates || yDominates)
+                value = !isAnd;
+            res._appendFill(value, n);
+            x.skip(n), y.skip(n);
+        } else {
+            uint32_t word = isAnd ? (x.literal() & y.literal()) : (x.literal() | y.literal());
+            res._appendLiteral(word);
+            x.skip(1), y.skip(1);
+        }
+    }
+    if (!isAnd) {
+        // 或运算时较长的一方剩下的部分原样保留
+        Reader &rest = x.hasMore() ? x : y;
+        while (rest.hasMore()) {
+            if (rest.isFill())
+                res._appendFill(rest.fillValue(), rest.left);
+            else
+                res._appendLiteral(rest.literal());
+            rest.skip(rest.left);
+        }
+    }
+    return res;
+}
+
+
+/**
+ * @brief 在原表上建立位图索引
+ * 逐块扫描原表，(索引字段值, 行号)在内存中排好序后，按取值依次生成位图并写出，最后写出目录
+ * 
+ * @param table 被索引的原表
+ * @param keyType 索引字段
+ * @return bitmap_index_t 建立的位图索引
+ */
+bitmap_index_t buildBitmapIndex(const table_t &table, INDEX_KEY keyType) {
+    key_extractor_t keyOf = keyExtractorOf(keyType);
+    int rowsPerBlk = numOfRowInRowIdBlk();
+    std::vector<index_t> entries;
+    addr_t next = table.start;
+    block_t readBlk;
+    std::vector<row_t> R(numOfRowInBlk);
+    while (next != END_OF_FILE) {
+        addr_t curAddr = next;
+        readBlk.loadFromDisk(curAddr);
+        int readRows = readBlk.decodeAll(R.data(), numOfRowInBlk);
+        for (int slot = 0; slot < readRows && R[slot].isFilled; ++slot) {
+            index_t entry;
+            entry.isFilled = true;
+            entry.A = keyOf(R[slot]), entry.B = makeRowId(curAddr, slot);
+            entries.push_back(entry);
+        }
+        next = readBlk.readNextAddr();
+        readBlk.freeBlock();
+    }
+    pdqSort(entries.data(), entries.data() + entries.size(), [](const index_t &x, const index_t &y) {
+        return (x.A != y.A) ? x.A < y.A : x.B < y.B;
+    });
+
+    bitmap_index_t index;
+    index.start = blkAllocator.allocate(1);
+    std::vector<index_t> dirItems;  // 每个取值的(取值, 位图首行的位置)
+    block_t resBlk;
+    resBlk.writeInit(index.start, rowsPerBlk, BLK_FORMAT_BINARY);
+    addr_t lastAddr = END_OF_FILE;
+    int rowsInBlk = 0;
+    // 写入一行，并返回该行的位置
+    auto writeRow = [&](int first, int second) {
+        index_t row;
+        row.isFilled = true;
+        row.A = first, row.B = second;
+        addr_t curAddr = resBlk.writeRow(row);
+        if (curAddr != lastAddr)
+            lastAddr = curAddr, rowsInBlk = 0;
+        return (int)curAddr * rowsPerBlk + rowsInBlk++;
+    };
+    for (size_t i = 0, j; i < entries.size(); i = j) {
+        WahBitmap bitmap;
+        for (j = i; j < entries.size() && entries[j].A == entries[i].A; ++j)
+            bitmap.append(entries[j].B);
+        const std::vector<uint32_t> &words = bitmap.words();
+        index_t dirItem;
+        dirItem.isFilled = true;
+        dirItem.A = entries[i].A, dirItem.B = writeRow(entries[i].A, words.size());
+        dirItems.push_back(dirItem);
+        for (size_t k = 0; k < words.size(); k += 2)
+            writeRow((int)words[k], (k + 1 < words.size()) ? (int)words[k + 1] : 0);
+    }
+    resBlk.writeLastBlock(false);    // 位图并入索引文件，随目录一起落盘
+    index.numOfValues = dirItems.size();
+    if (dirItems.empty()) {
+        index.start = END_OF_FILE;  // 被索引的表为空，索引文件也是空的
+    } else {
+        index.directory = blkAllocator.allocate(ceil(1.0 * dirItems.size() / rowsPerBlk), index.start);
+        resBlk.writeInit(index.directory, rowsPerBlk, BLK_FORMAT_BINARY);
+        for (const index_t &dirItem : dirItems)
+            resBlk.writeRow(dirItem);
+        resBlk.writeLastBlock();
+    }
+    bitmapIndexMap[std::make_pair(table.start, (int)keyType)] = index;
+    return index;
+}
+
+
+/**
+ * @brief 读出一组取值的位图并做或运算，即索引字段值在values中的记录
+ * 先在目录中折半查找各个取值的位图首行，再逐个读出位图，位图只读涉及的块
+ * 
+ * @param index 位图索引
+ * @param values 索引字段的取值
+ * @return WahBitmap 各取值位图的或
+ */
+WahBitmap bitmapIndexLookup(const bitmap_index_t &index, const std::vector<int> &values) {
+    WahBitmap res;
+    if (index.start == END_OF_FILE)
+        return res;
+    int rowsPerBlk = numOfRowInRowIdBlk();
+    int numOfDirBlk = ceil(1.0 * index.numOfValues / rowsPerBlk);
+    std::vector<int> rowPos;
+    std::vector<row_t> R(numOfRowInBlk);
+    block_t readBlk;
+    for (int value : values) {
+        int left = 0, right = numOfDirBlk - 1;
+        while (left <= right) {
+            int mid = (left + right) / 2, numOfItems = 0;
+            readBlk.loadFromDisk(index.directory + mid);
+            readBlk.decodeAll(R.data(), rowsPerBlk);
+            readBlk.freeBlock();
+            while (numOfItems < rowsPerBlk && R[numOfItems].isFilled)
+                numOfItems += 1;
+            if (value < R[0].A) {
+                right = mid - 1;
+            } else if (value > R[numOfItems - 1].A) {
+                left = mid + 1;
+            } else {
+                for (int i = 0; i < numOfItems; ++i) {
+                    if (R[i].A == value)
+                        rowPos.push_back(R[i].B);
+                }
+                break;
+            }
+        }
+    }
+    for (int pos : rowPos) {
+        // 从位图首行开始读，位图跨块时沿下一块地址读完
+        addr_t addr = pos / rowsPerBlk;
+        int offset = pos % rowsPerBlk, numOfWords = -1;
+        std::vector<uint32_t> words;
+        while ((int)words.size() < numOfWords || numOfWords < 0) {
+            readBlk.loadFromDisk(addr);
+            int readRows = readBlk.decodeAll(R.data(), rowsPerBlk);
+            addr = readBlk.readNextAddr();
+            readBlk.freeBlock();
+            for (int i = offset; i < readRows && R[i].isFilled && (numOfWords < 0 || (int)words.size() < numOfWords); ++i) {
+                if (numOfWords < 0) {
+                    numOfWords = R[i].B;
+                    continue;
+                }
+                words.push_back((uint32_t)R[i].A);
+                words.push_back((uint32_t)R[i].B);
+            }
+            offset = 0;
+        }
+        words.resize(numOfWords);
+        res = res | WahBitmap::fromWords(words);
+    }
+    return res;
+}
+
+
+/**
+ * @brief 位图索引管理——使用位图索引前的准备工作
+ * 位图索引直接建在原表上，不需要先聚簇
+ * 
+ * @param table 被索引的原表
+ * @param keyType 索引字段
+ * @return bitmap_index_t table在该字段上的位图索引
+ */
+bitmap_index_t useBitmapIndex(const table_t &table, INDEX_KEY keyType) {
+    auto findIndex = bitmapIndexMap.find(std::make_pair(table.start, (int)keyType));
+    if (findIndex != bitmapIndexMap.end())
+        return findIndex->second;
+    printf("当前查找表在该字段上仍未建立位图索引，现建立索引...\n");
+    unsigned long prior_IO = buff.numIO;
+    bitmap_index_t index = buildBitmapIndex(table, keyType);
+    printf("\n完成！索引文件始于磁盘块%d，共%d个取值\n", index.start, index.numOfValues);
+    printf("建立索引所用IO: %lu\n\n", buff.numIO - prior_IO);
+    return index;
+}
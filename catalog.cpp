@@ -0,0 +1,335 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "utils.cpp"
+#include "index.cpp"
+#include "hashIndex.cpp"
+#include "bitmapIndex.cpp"
+#include "zoneMap.cpp"
+#pragma once
+
+
+/**
+ * @brief 持久化的目录(catalog)
+ * 聚簇地址映射表和索引地址映射表原本只在内存中，每次启动都要重新聚簇、重新建立索引
+ * 目录文件把它们连同R、S表、聚簇文件和索引文件所占的区段一起记录下来
+ * 重启时读入目录，即可直接使用上次留下的聚簇文件和索引，地址分配器也不必沿块链登记R、S表
+ * 
+ * 目录为文本文件，每行一项：
+ *   catalog <目录格式的版本号>
+ *   block_size <块的大小> <每块的记录数>
+ *   table <表的首地址> <记录数> <块数>
+ *   file <文件的首地址> <区段数> <区段1的首地址> <区段1的末地址> ...
+ *   cluster <原表的首地址> <聚簇文件的首地址> <聚簇文件的末地址>
+ *   index <原表的首地址> <索引文件的首地址> <B+树根结点的块地址> <B+树的树高>
+ *   secondary <原表的首地址> <索引字段> <索引文件的首地址> <B+树根结点的块地址> <B+树的树高>
+ *   hash <原表的首地址> <索引字段> <散列索引目录的首地址> <全局深度>
+ *   bitmap <原表的首地址> <索引字段> <位图索引文件的首地址> <目录的块地址> <取值个数>
+ *   zonemap <文件的首地址> <zone map文件的首地址>
+ */
+
+typedef std::vector<std::pair<addr_t, addr_t>> extent_list_t;
+
+const char *catalogFile = "data/catalog.txt";
+const int catalogVersion = 6;
+
+/**
+ * @brief 从目录文件中读出的内容
+ */
+typedef struct Catalog {
+    int version = 0;
+    int blkSize = 0, rowsInBlk = 0;
+    std::map<addr_t, index_t> tables;           // 表首地址 -> (记录数, 块数)
+    std::map<addr_t, extent_list_t> files;      // 文件首地址 -> 文件的区段
+    table_map_t clusters;
+    index_map_t indexes;
+    secondary_map_t secondaryIndexes;
+    hash_map_t hashIndexes;
+    bitmap_map_t bitmapIndexes;
+    std::map<addr_t, addr_t> zoneMaps;          // 文件首地址 -> zone map文件的首地址
+    bool isBroken = false;                      // 目录中有无法解析的行
+} catalog_t;
+
+
+/**
+ * @brief 统计一组区段的总块数
+ * 
+ * @param extents 区段列表
+ * @return int 总块数
+ */
+int numOfBlkInExtents(const extent_list_t &extents) {
+    int count = 0;
+    for (auto &extent : extents)
+        count += extent.second - extent.first + 1;
+    return count;
+}
+
+
+/**
+ * @brief 读取目录文件
+ * 
+ * @param cat 读出的目录内容
+ * @return bool 目录文件是否存在
+ */
+bool readCatalog(catalog_t &cat) {
+    std::ifstream fin(catalogFile);
+    if (!fin)
+        return false;
+    std::string line, item;
+    while (std::getline(fin, line)) {
+        std::istringstream sin(line);
+        if (!(sin >> item))
+            continue;
+        bool isParsed;
+        if (item == "catalog") {
+            isParsed = (bool)(sin >> cat.version);
+        } else if (item == "block_size") {
+            isParsed = (bool)(sin >> cat.blkSize >> cat.rowsInBlk);
+        } else if (item == "table") {
+            addr_t tableStart;
+            index_t stats;
+            isParsed = (bool)(sin >> tableStart >> stats.A >> stats.B);
+            cat.tables[tableStart] = stats;
+        } else if (item == "file") {
+            addr_t fileStart;
+            int numOfExtents;
+            isParsed = (bool)(sin >> fileStart >> numOfExtents);
+            extent_list_t &extents = cat.files[fileStart];
+            for (int i = 0; isParsed && i < numOfExtents; ++i) {
+                addr_t first, last;
+                isParsed = (bool)(sin >> first >> last) && first <= last;
+                extents.push_back(std::make_pair(first, last));
+            }
+        } else if (item == "cluster") {
+            addr_t tableStart;
+            index_t addrItem;
+            isParsed = (bool)(sin >> tableStart >> addrItem.A >> addrItem.B);
+            cat.clusters.insert(pair_t(tableStart, addrItem));
+        } else if (item == "index") {
+            addr_t tableStart;
+            disk_index_t tree;
+            isParsed = (bool)(sin >> tableStart >> tree.start >> tree.root >> tree.height);
+            cat.indexes.insert(std::make_pair(tableStart, tree));
+        } else if (item == "secondary") {
+            addr_t tableStart;
+            int keyType;
+            disk_index_t tree;
+            isParsed = (bool)(sin >> tableStart >> keyType >> tree.start >> tree.root >> tree.height)
+                && keyType >= KEY_A && keyType <= KEY_AB;
+            cat.secondaryIndexes.insert(std::make_pair(std::make_pair(tableStart, keyType), tree));
+        } else if (item == "hash") {
+            addr_t tableStart;
+            int keyType;
+            hash_index_t index;
+            isParsed = (bool)(sin >> tableStart >> keyType >> index.directory >> index.globalDepth)
+                && keyType >= KEY_A && keyType <= KEY_AB && index.globalDepth <= MAX_GLOBAL_DEPTH;
+            cat.hashIndexes.insert(std::make_pair(std::make_pair(tableStart, keyType), index));
+        } else if (item == "bitmap") {
+            addr_t tableStart;
+            int keyType;
+            bitmap_index_t index;
+            isParsed = (bool)(sin >> tableStart >> keyType >> index.start >> index.directory >> index.numOfValues)
+                && keyType >= KEY_A && keyType <= KEY_AB;
+            cat.bitmapIndexes.insert(std::make_pair(std::make_pair(tableStart, keyType), index));
+        } else if (item == "zonemap") {
+            addr_t fileStart, zoneStart;
+            isParsed = (bool)(sin >> fileStart >> zoneStart);
+            cat.zoneMaps[fileStart] = zoneStart;
+        } else {
+            isParsed = false;
+        }
+        if (!isParsed)
+            cat.isBroken = true;
+    }
+    return true;
+}
+
+
+/**
+ * @brief 检查目录是否与当前的配置和R、S表一致
+ * 
+ * @param cat 目录内容
+ * @return bool 目录是否可以使用
+ */
+bool isCatalogUsable(const catalog_t &cat) {
+    if (cat.isBroken || cat.version != catalogVersion)
+        return false;
+    if (cat.blkSize != sizeOfBlock || cat.rowsInBlk != numOfRowInBlk)
+        return false;
+    const table_t baseTables[2] = {table_R, table_S};
+    for (const table_t &base : baseTables) {
+        auto stats = cat.tables.find(base.start);
+        if (stats == cat.tables.end() || stats->second.A != base.size)
+            return false;
+        auto file = cat.files.find(base.start);
+        if (file == cat.files.end() || numOfBlkInExtents(file->second) != stats->second.B)
+            return false;
+    }
+    // 每个聚簇文件和索引文件都要有对应的区段
+    for (auto iter = cat.clusters.begin(); iter != cat.clusters.end(); ++iter) {
+        if (cat.files.find(iter->second.A) == cat.files.end())
+            return false;
+    }
+    for (auto iter = cat.indexes.begin(); iter != cat.indexes.end(); ++iter) {
+        if (cat.files.find(iter->second.start) == cat.files.end())
+            return false;
+    }
+    for (auto iter = cat.secondaryIndexes.begin(); iter != cat.secondaryIndexes.end(); ++iter) {
+        if (cat.files.find(iter->second.start) == cat.files.end())
+            return false;
+    }
+    for (auto iter = cat.hashIndexes.begin(); iter != cat.hashIndexes.end(); ++iter) {
+        if (cat.files.find(iter->second.directory) == cat.files.end())
+            return false;
+    }
+    for (auto iter = cat.bitmapIndexes.begin(); iter != cat.bitmapIndexes.end(); ++iter) {
+        if (iter->second.start != END_OF_FILE && cat.files.find(iter->second.start) == cat.files.end())
+            return false;
+    }
+    for (auto iter = cat.zoneMaps.begin(); iter != cat.zoneMaps.end(); ++iter) {
+        if (cat.files.find(iter->second) == cat.files.end())
+            return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief 在地址分配器中登记目录中记录的文件
+ * 
+ * @param cat 目录内容
+ * @param includeBaseTables 是否同时登记R、S表
+ */
+void claimCatalogFiles(const catalog_t &cat, bool includeBaseTables) {
+    for (auto iter = cat.files.begin(); iter != cat.files.end(); ++iter) {
+        addr_t fileStart = iter->first;
+        if (!includeBaseTables && (fileStart == table_R.start || fileStart == table_S.start))
+            continue;
+        for (auto &extent : iter->second) {
+            for (addr_t addr = extent.first; addr <= extent.second; ++addr)
+                blkAllocator.claim(addr, fileStart);
+        }
+    }
+}
+
+
+/**
+ * @brief 删除目录中记录的聚簇文件和索引文件，再删除目录文件本身
+ * R、S表被重新生成或转换格式之后，原来的聚簇和索引都已失效，需调用此函数
+ * 目录无法解析时其中的区段不可信，只删除目录文件
+ */
+void dropCatalog() {
+    catalog_t cat;
+    if (!readCatalog(cat))
+        return;
+    if (!cat.isBroken) {
+        claimCatalogFiles(cat, false);
+        for (auto iter = cat.files.begin(); iter != cat.files.end(); ++iter) {
+            addr_t fileStart = iter->first;
+            if (fileStart != table_R.start && fileStart != table_S.start)
+                DropFiles(fileStart);
+        }
+    }
+    remove(catalogFile);
+}
+
+
+/**
+ * @brief 读入目录，恢复聚簇、索引地址映射表并在地址分配器中登记目录中的文件
+ * 目录与当前的配置或R、S表不一致时，删除目录及其中记录的聚簇和索引文件
+ * 
+ * @return bool 是否成功读入了目录，为false时调用者需自行登记R、S表
+ */
+bool loadCatalog() {
+    catalog_t cat;
+    if (!readCatalog(cat))
+        return false;
+    if (!isCatalogUsable(cat)) {
+        printf("目录与当前的配置或数据不一致，删除其中记录的聚簇和索引文件...\n");
+        dropCatalog();
+        return false;
+    }
+    claimCatalogFiles(cat, true);
+    clusterTableMap = cat.clusters;
+    indexTableMap = cat.indexes;
+    secondaryIndexMap = cat.secondaryIndexes;
+    hashIndexMap = cat.hashIndexes;
+    bitmapIndexMap = cat.bitmapIndexes;
+    zoneMapFiles = cat.zoneMaps;
+    return true;
+}
+
+
+/**
+ * @brief 将R、S表以及当前的聚簇、索引地址映射表写入目录文件
+ * 先写入临时文件再改名，避免写到一半中断时留下不完整的目录
+ */
+void saveCatalog() {
+    std::string tmpFile = std::string(catalogFile) + ".tmp";
+    std::ofstream fout(tmpFile);
+    if (!fout) {
+        printf("警告：无法写入目录文件%s！\n", tmpFile.c_str());
+        return;
+    }
+    std::vector<addr_t> fileStarts;
+    fout << "catalog " << catalogVersion << "\n";
+    fout << "block_size " << sizeOfBlock << " " << numOfRowInBlk << "\n";
+    const table_t baseTables[2] = {table_R, table_S};
+    for (const table_t &base : baseTables) {
+        int numOfBlk = numOfBlkInExtents(blkAllocator.extentsOf(base.start));
+        fout << "table " << base.start << " " << base.size << " " << numOfBlk << "\n";
+        fileStarts.push_back(base.start);
+    }
+    for (auto iter = clusterTableMap.begin(); iter != clusterTableMap.end(); ++iter) {
+        index_t addrItem = iter->second;
+        fout << "cluster " << iter->first << " " << addrItem.A << " " << addrItem.B << "\n";
+        fileStarts.push_back(addrItem.A);
+    }
+    for (auto iter = indexTableMap.begin(); iter != indexTableMap.end(); ++iter) {
+        disk_index_t tree = iter->second;
+        fout << "index " << iter->first << " " << tree.start << " " << tree.root << " " << tree.height << "\n";
+        fileStarts.push_back(tree.start);
+    }
+    for (auto iter = secondaryIndexMap.begin(); iter != secondaryIndexMap.end(); ++iter) {
+        disk_index_t tree = iter->second;
+        fout << "secondary " << iter->first.first << " " << iter->first.second << " "
+            << tree.start << " " << tree.root << " " << tree.height << "\n";
+        fileStarts.push_back(tree.start);
+    }
+    for (auto iter = hashIndexMap.begin(); iter != hashIndexMap.end(); ++iter) {
+        hash_index_t index = iter->second;
+        fout << "hash " << iter->first.first << " " << iter->first.second << " "
+            << index.directory << " " << index.globalDepth << "\n";
+        fileStarts.push_back(index.directory);
+    }
+    for (auto iter = bitmapIndexMap.begin(); iter != bitmapIndexMap.end(); ++iter) {
+        bitmap_index_t index = iter->second;
+        fout << "bitmap " << iter->first.first << " " << iter->first.second << " "
+            << index.start << " " << index.directory << " " << index.numOfValues << "\n";
+        if (index.start != END_OF_FILE)
+            fileStarts.push_back(index.start);
+    }
+    for (auto iter = zoneMapFiles.begin(); iter != zoneMapFiles.end(); ++iter) {
+        fout << "zonemap " << iter->first << " " << iter->second << "\n";
+        fileStarts.push_back(iter->second);
+    }
+    for (addr_t fileStart : fileStarts) {
+        extent_list_t extents = blkAllocator.extentsOf(fileStart);
+        fout << "file " << fileStart << " " << extents.size();
+        for (auto &extent : extents)
+            fout << " " << extent.first << " " << extent.second;
+        fout << "\n";
+    }
+    fout.close();
+    bool isSaved = (bool)fout;
+    // POSIX上rename直接原子地替换原来的目录，中途出错时原来的目录仍然完好
+    // 有的平台上目标文件已存在时无法改名，只有这时才先删除原来的目录再改名
+    if (isSaved && rename(tmpFile.c_str(), catalogFile) != 0) {
+        remove(catalogFile);
+        isSaved = (rename(tmpFile.c_str(), catalogFile) == 0);
+    }
+    if (!isSaved) {
+        printf("警告：无法写入目录文件%s！\n", catalogFile);
+        remove(tmpFile.c_str());
+    }
+}
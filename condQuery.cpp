@@ -1,22 +1,23 @@
 #include "utils.cpp"
 #include "index.cpp"
+#include "hashIndex.cpp"
+#include "bitmapIndex.cpp"
 #pragma once
 
 
 /**
- * @brief 㷨
- * R.A = 40    S.C = 60
+ * @brief 条件检索算法
+ * 条件：R.A = 40  或  S.C = 60
  */
 
-const addr_t condQueryStart = 1000; //ʵŵַ
 
 
 /**
- * @brief ȽϺ
+ * @brief 比较函数
  * 
- * @param R Ƚϵļ¼
- * @param val Ƚֵ
- * @return int ¼Rvalλ
+ * @param R 待比较的记录
+ * @param val 比较值
+ * @return int 记录R相对val的位置
  */
 int cmp(row_t R, int val) {
     if (R.A == val)
@@ -29,102 +30,102 @@ int cmp(row_t R, int val) {
 
 
 /**
- * @brief 
- * ¼еAȽֵvalȽϣǷж
+ * @brief 相等条件函数
+ * 将记录中的A属性与比较值val比较，返回是否相等判断
  * 
- * @param R Ƚϵļ¼
- * @param val Ƚֵ
- * @return true ¼Aֶεֵval
- * @return false ¼Aֶεֵval
+ * @param A 待比较记录的A属性
+ * @param val 比较值
+ * @return true 记录中A字段的值与val相等
+ * @return false 记录中A字段的值与val不等
  */
-bool EQ_cond(row_t R, int val) { return (R.A == val); }
+bool EQ_cond(int A, int val) { return (A == val); }
 
 
 /**
- * @brief Լ
- * ԴıռcondͼֵvalԼ
+ * @brief 表的线性检索
+ * 对待检索的表按照检索条件cond和检索值val进行线性检索
+ * 逐块只解析记录的A属性进行筛选，符合条件的记录才解析出整条记录写入结果
  * 
- * @param table ıϢ
- * @param resTable Ϣ
- * @param val ֵ
- * @param cond 
+ * @param table 待检索的表信息
+ * @param resTable 检索结果表信息
+ * @param val 检索值
+ * @param cond 检索条件函数，作用于记录的A属性
  */
-void linearQuery(const table_t &table, table_t &resTable, int val, bool (*cond)(row_t, int)) {
-    int numOfUsedBlock = numOfBufBlock - 1;
-    int numOfRows = numOfRowInBlk * numOfUsedBlock;
-    addr_t curAddr = 0, readAddr = table.start;
-
-    block_t blk[numOfUsedBlock], resBlk;
+void linearQuery(const table_t &table, table_t &resTable, int val, bool (*cond)(int, int)) {
+    addr_t curAddr = 0;
+    block_t readBlk, resBlk;
+    std::vector<int> A(numOfRowInBlk);
     resBlk.writeInit(resTable.start);
-    for (int i = 0; i < numOfUsedBlock; ++i)
-        blk[i].loadFromDisk(readAddr++);
-    row_t t[numOfRows];
+    readBlk.loadFromDisk(table.start);
 
     int readRows;
-    while(1) {
-        readRows = read_N_Rows_From_M_Block(blk, t, numOfRows, numOfUsedBlock);
-        // printRows(t, readRows, val);
-        bool isLastBlock = (readRows < numOfRows);
+    while((readRows = readBlk.decodeColumnA(A.data(), numOfRowInBlk)) > 0) {
         for (int i = 0; i < readRows; ++i) {
-            if (cond(t[i], val))  {
-                curAddr = resBlk.writeRow(t[i]);
+            if (cond(A[i], val)) {
+                curAddr = resBlk.writeRow(readBlk.decodedRow(i));
                 resTable.size += 1;
             }
         }
-        if (isLastBlock) {
-            addr_t endAddr = resBlk.writeLastBlock();
-            if (endAddr != END_OF_FILE)
-                curAddr = endAddr;
-            resTable.end = curAddr;
-            break;
-        }
     }
-    // ս
+    readBlk.freeBlock();
+    addr_t endAddr = resBlk.writeLastBlock();
+    if (endAddr != END_OF_FILE)
+        curAddr = endAddr;
+    resTable.end = curAddr;
+    // 处理空结果表
     if (resTable.size == 0)
         resTable.start = resTable.end = 0;
 }
 
 
 /**
- * @brief ּ
- * Դıƥcmpƥֵvalжּ
+ * @brief 二分检索
+ * 对待检索的表按照匹配条件cmp和匹配值val进行二分检索
  * 
- * @param table ıϢ
- * @param resTable Ϣ
- * @param val ƥֵ
- * @param cmp ȽϺܹӳĿ¼뵱ǰ¼λϢ
+ * @param table 待检索的表信息
+ * @param resTable 检索结果表信息
+ * @param val 匹配值
+ * @param cmp 检索条件比较函数，能够反映出目标记录与当前检索记录的位置信息
  */
 void binaryQuery(const table_t &table, table_t &resTable, int val, int (*cmp)(row_t, int)) {
-    int numOfUsedBlock = numOfBufBlock - 1;     // 7ͬʱ
+    int numOfUsedBlock = numOfBufBlock - 1;     // 留出1块写结果，其余的块同时读入处理
     int numOfRows = numOfRowInBlk * numOfUsedBlock;
     addr_t curAddr = 0, readAddr = table.start;
 
-    printf("----- ÿ%dжּ -----\n", numOfUsedBlock);
-    row_t t[numOfRows], res[numOfRows];
-    int pRes = 0;       // ¼ϼļ¼
-    block_t blk[numOfBufBlock - 1], resBlk;
+    std::vector<block_t> blk(numOfUsedBlock);
+    block_t resBlk;
     resBlk.writeInit(resTable.start);
-    for (int i = 0; i < numOfUsedBlock; ++i)
-        blk[i].loadFromDisk(readAddr++);
+    for (int i = 0; i < numOfUsedBlock; ++i) {
+        blk[i].loadFromDisk(readAddr);
+        readAddr = blk[i].readNextAddr();
+        if (readAddr == END_OF_FILE) {
+            numOfUsedBlock = i + 1;
+            numOfRows = numOfRowInBlk * numOfUsedBlock;
+            break;
+        }
+    }
+    printf("----- 对每%d块进行二分检索 -----\n", numOfUsedBlock);
+    std::vector<row_t> t(numOfRows), res(numOfRows);
+    int pRes = 0;       // 记录符合检索条件的记录个数
 
     int readRows;
     while(1) {
-        readRows = read_N_Rows_From_M_Block(blk, t, numOfRows, numOfUsedBlock);
+        readRows = read_N_Rows_From_M_Block(blk.data(), t.data(), numOfRows, numOfUsedBlock);
         // printRows(t, readRows, val);
-        insertSort<row_t>(t, readRows);
-        // ʼֲ
+        sortRows(t.data(), readRows);
+        // 开始二分查找
         int left = 0, right = readRows - 1;
         while (left <= right) {
             int mid = (right + left) / 2;
             if (cmp(t[mid], val) == EQ) {
                 int forward = mid, back = mid;
                 res[pRes++] = t[mid];
-                // һμ¼ģ˲ҵһļ¼丽ܻͬ¼
-                // ü¼м¼ҷļ¼
-                while(cmp(t[--back], val) == EQ)
-                    res[pRes++] = t[back];
-                while(cmp(t[++forward], val) == EQ)
-                    res[pRes++] = t[forward];
+                // 由于这一段记录是有序的，因此查找到了一条符合条件的记录，其附近可能还有同样符合条件的其他记录
+                // 检索该记录附近的所有记录，查找符合条件的记录
+                while(back > 0 && cmp(t[back - 1], val) == EQ)
+                    res[pRes++] = t[--back];
+                while(forward < readRows - 1 && cmp(t[forward + 1], val) == EQ)
+                    res[pRes++] = t[++forward];
                 break;
             } else if (cmp(t[mid], val) == LT) {
                 left = mid + 1;
@@ -136,11 +137,11 @@ void binaryQuery(const table_t &table, table_t &resTable, int val, int (*cmp)(ro
             break;
     }
     if (pRes == 0) {
-        resBlk.freeBlock();                 // ҪֶͷŽ
-        resTable.start = resTable.end = 0;  // ս
+        resBlk.writeLastBlock();            // 释放结果缓冲区，并归还结果表申请的起始块
+        resTable.start = resTable.end = 0;  // 处理空结果表
         return;
     }
-    insertSort<row_t>(res, pRes);
+    sortRows(res.data(), pRes);
     for (int i = 0; i < pRes; ++i) {
         curAddr = resBlk.writeRow(res[i]);
         resTable.size += 1;
@@ -153,47 +154,43 @@ void binaryQuery(const table_t &table, table_t &resTable, int val, int (*cmp)(ro
 
 
 /**
- * @brief 
- * ԴıvalӦϢضӦĴ̿ٽԼ
- * ñδ۴/ĲȶԸñ۴/
+ * @brief 按索引检索
+ * 对待检索的表，按照val对应的索引信息，加载对应的磁盘块后再进行线性检索
+ * 若该表未做聚簇/建立索引的操作，会先对该表做聚簇/建立索引
  * 
- * @param table ıϢ
- * @param resTable Ϣ
- * @param val ֵ
+ * @param table 待检索的表信息
+ * @param resTable 检索结果表信息
+ * @param val 检索值
  */
 void indexQuery(const table_t &table, table_t &resTable, int val) {
-    addr_t clusterAddr, indexAddr, curAddr = 0;
-    clusterAddr = useCluster(table);
-    indexAddr = useIndex(table);
+    addr_t curAddr = 0;
+    useCluster(table);
+    DiskBPlusTree tree(useIndex(table));
 
-    // ȡӦľ۴شŵַ
+    // 在磁盘上的B+树中查找，读取对应的聚簇存放地址
     unsigned long prior_IO = buff.numIO;
-    loadIndex(indexAddr);
-    if(buff.numIO)
-        printf("IO: %d\n\n", buff.numIO - prior_IO);
-    else
-        printf("ѱصڴУأ\n");
-    vector<tree_data_t> data = BPTR.select(val, EQ);
-    if (data.begin() == data.end()) {
+    addr_t loadAddr = tree.search(val);
+    printf("查找索引所用IO: %d\n\n", buff.numIO - prior_IO);
+    if (loadAddr == END_OF_FILE) {
+        blkAllocator.dropFile(resTable.start);  // 归还结果表申请的起始块
         resTable.start = resTable.end = resTable.size = 0;
         return;
     }
-    addr_t loadAddr = data[0];
 
-    // ָľ۴شŵַвҽ
+    // 从索引指向的聚簇存放地址中查找结果
     block_t readBlk, resBlk;
-    row_t R[numOfRowInBlk];
+    std::vector<row_t> R(numOfRowInBlk);
     resBlk.writeInit(resTable.start);
     readBlk.loadFromDisk(loadAddr);
 
-    // ָĿвѯӦ
+    // 在索引指向的块中查询对应结果
     int readRows, cursor = 0;
     while(1) {
-        readRows = read_N_Rows_From_1_Block(readBlk, R, numOfRowInBlk);
+        readRows = read_N_Rows_From_1_Block(readBlk, R.data(), numOfRowInBlk);
         cursor = 0;
         if (readRows > 0) {
             if (R[cursor].A > val)  {
-                // ҵһֵֶʱ
+                // 找到第一个大于索引字段值时结束检索
                 readBlk.freeBlock();
                 break;
             }
@@ -206,7 +203,7 @@ void indexQuery(const table_t &table, table_t &resTable, int val) {
                     break;
             }
         } else {
-            // Ѿļĩβ
+            // 已经读到文件的末尾了
             break;
         }
     }
@@ -217,58 +214,246 @@ void indexQuery(const table_t &table, table_t &resTable, int val) {
 }
 
 /**
- * @brief ֪ʲô
+ * @brief 看函数名就知道这玩意儿是用来干什么的了
  * 
- * еĴζֻΪ˴indexQuery
- * Բݾ͸indexQueryȫͬͲ׸
- * ϸindexQueryĲ
+ * 由于这里所有的传参都只是为了传给里面的indexQuery
+ * 所以参数内容就跟indexQuery完全相同，这里就不赘述了
+ * 详细参数内容请参阅indexQuery的参数部分
  */
 void searchByIndex_and_Show(const table_t &table, table_t &resTable, int val) {
     clear_Buff_IO_Count();
     indexQuery(table, resTable, val);
     showResult(resTable.start);
-    printf("\nעд̿飺%d-%d\n", resTable.start, resTable.end);
-    printf("ι%ldI/O\n\n", buff.numIO);
+    printf("\n注：结果写入磁盘块：%d-%d\n", resTable.start, resTable.end);
+    printf("本次共发生%ld次I/O\n\n", buff.numIO);
+}
+
+
+/**
+ * @brief 按行号从原表中取出记录写入结果表
+ * 行号按块地址递增排列，每个涉及的块只读一次，结果也按记录在原表中的顺序写出
+ * 
+ * @param rowIds 待取出记录的行号，不能为空
+ * @param resTable 检索结果表信息
+ */
+void fetchRowsById(std::vector<int> rowIds, table_t &resTable) {
+    sortInts(rowIds);
+    addr_t curAddr = 0, loadedAddr = END_OF_FILE;
+    block_t readBlk, resBlk;
+    std::vector<row_t> R(numOfRowInBlk);
+    resBlk.writeInit(resTable.start);
+    for (int rowId : rowIds) {
+        if (rowIdAddr(rowId) != loadedAddr) {
+            // 行号指向了新的一块，读入该块的所有记录
+            loadedAddr = rowIdAddr(rowId);
+            readBlk.loadFromDisk(loadedAddr);
+            readBlk.decodeAll(R.data(), numOfRowInBlk);
+            readBlk.freeBlock();
+        }
+        curAddr = resBlk.writeRow(R[rowIdSlot(rowId)]);
+        resTable.size += 1;
+    }
+    addr_t endAddr = resBlk.writeLastBlock();
+    if (endAddr != END_OF_FILE)
+        curAddr = endAddr;
+    resTable.end = curAddr;
+}
+
+
+/**
+ * @brief 按二级索引检索
+ * 在table的二级索引上查找索引字段值在[lowKey, highKey]内的所有行号，再按行号从原表中取出对应的记录
+ * 若该表在该字段上未建立二级索引，会先建立索引
+ * 
+ * @param table 待检索的表信息
+ * @param resTable 检索结果表信息
+ * @param keyType 索引字段，KEY_AB的字段值由compositeKey算出
+ * @param lowKey 索引字段值的下界
+ * @param highKey 索引字段值的上界
+ */
+void secondaryIndexQuery(const table_t &table, table_t &resTable, INDEX_KEY keyType, int lowKey, int highKey) {
+    DiskBPlusTree tree(useSecondaryIndex(table, keyType));
+    std::vector<index_t> entries;
+    unsigned long prior_IO = buff.numIO;
+    int numOfRowIds = tree.scan(lowKey, highKey, entries);
+    printf("查找索引所用IO: %lu\n\n", buff.numIO - prior_IO);
+    if (numOfRowIds == 0) {
+        blkAllocator.dropFile(resTable.start);  // 归还结果表申请的起始块
+        resTable.start = resTable.end = resTable.size = 0;
+        return;
+    }
+    std::vector<int> rowIds;
+    for (const index_t &entry : entries)
+        rowIds.push_back(entry.B);
+    fetchRowsById(rowIds, resTable);
 }
 
+/**
+ * @brief 按二级索引检索并输出结果，参数同secondaryIndexQuery
+ */
+void searchBySecondaryIndex_and_Show(const table_t &table, table_t &resTable, INDEX_KEY keyType, int lowKey, int highKey) {
+    clear_Buff_IO_Count();
+    secondaryIndexQuery(table, resTable, keyType, lowKey, highKey);
+    showResult(resTable.start);
+    printf("\n注：结果写入磁盘块：%d-%d\n", resTable.start, resTable.end);
+    printf("本次共发生%ld次I/O\n\n", buff.numIO);
+}
+
+
+/**
+ * @brief 按散列索引检索
+ * 在table的A属性上的散列索引中查找val，读目录中的一块和val所在的桶即可得到所有行号，再按行号取出记录
+ * 若该表未建立散列索引，会先建立索引
+ * 
+ * @param table 待检索的表信息
+ * @param resTable 检索结果表信息
+ * @param val 检索值
+ */
+void hashIndexQuery(const table_t &table, table_t &resTable, int val) {
+    hash_index_t index = useHashIndex(table, KEY_A);
+    std::vector<int> rowIds;
+    unsigned long prior_IO = buff.numIO;
+    int numOfRowIds = hashIndexLookup(index, val, rowIds);
+    printf("查找索引所用IO: %lu\n\n", buff.numIO - prior_IO);
+    if (numOfRowIds == 0) {
+        blkAllocator.dropFile(resTable.start);  // 归还结果表申请的起始块
+        resTable.start = resTable.end = resTable.size = 0;
+        return;
+    }
+    fetchRowsById(rowIds, resTable);
+}
+
+/**
+ * @brief 按位图索引检索：A IN valuesA，valuesB不为空时再加上 AND B IN valuesB
+ * 同一属性的多个取值对各自的位图做或运算，两个属性之间做与运算
+ * 符合条件的记录数由结果位图直接算出，不读任何数据块；之后只读含有符合条件记录的块
+ * 若该表未建立位图索引，会先建立索引
+ * 
+ * @param table 待检索的表信息
+ * @param resTable 检索结果表信息
+ * @param valuesA 属性A的取值列表
+ * @param valuesB 属性B的取值列表，为空时不对B做限制
+ */
+void bitmapIndexQuery(const table_t &table, table_t &resTable, const std::vector<int> &valuesA, const std::vector<int> &valuesB) {
+    bitmap_index_t indexA = useBitmapIndex(table, KEY_A);
+    bitmap_index_t indexB;
+    if (!valuesB.empty())
+        indexB = useBitmapIndex(table, KEY_B);
+    unsigned long prior_IO = buff.numIO;
+    WahBitmap bitmap = bitmapIndexLookup(indexA, valuesA);
+    if (!valuesB.empty())
+        bitmap = bitmap & bitmapIndexLookup(indexB, valuesB);
+    printf("查找索引所用IO: %lu\n", buff.numIO - prior_IO);
+    printf("符合条件的记录数(由位图算出)：%d\n\n", bitmap.count());
+    std::vector<int> rowIds;
+    bitmap.positions(rowIds);
+    if (rowIds.empty()) {
+        blkAllocator.dropFile(resTable.start);  // 归还结果表申请的起始块
+        resTable.start = resTable.end = resTable.size = 0;
+        return;
+    }
+    fetchRowsById(rowIds, resTable);
+}
+
+/**
+ * @brief 借助zone map的范围检索：low <= A <= high
+ * 在table的聚簇文件上检索，只读入[minA, maxA]与[low, high]有交集的块
+ * 聚簇文件还没有zone map时(例如由旧目录恢复)，逐块完整扫描一遍，顺带记下zone map并写入磁盘
+ * 
+ * @param table 待检索的表信息
+ * @param resTable 检索结果表信息
+ * @param low 检索值的下界
+ * @param high 检索值的上界
+ */
+void zoneMapQuery(const table_t &table, table_t &resTable, int low, int high) {
+    addr_t clusterAddr = useCluster(table);
+    zone_map_t zones;
+    unsigned long prior_IO = buff.numIO;
+    bool hasZoneMap = loadZoneMap(clusterAddr, zones);
+    printf("读取zone map所用IO: %lu\n", buff.numIO - prior_IO);
+
+    addr_t curAddr = 0;
+    block_t readBlk, resBlk;
+    std::vector<int> A(numOfRowInBlk);
+    resBlk.writeInit(resTable.start);
+    int numOfSkipped = 0, numOfBlk = 0;
+    zone_map_t newZones;
+    addr_t next = clusterAddr;
+    for (size_t i = 0; hasZoneMap ? i < zones.size() : next != END_OF_FILE; ++i) {
+        addr_t readAddr = next;
+        if (hasZoneMap) {
+            numOfBlk += 1;
+            if (zones[i].maxA < low || zones[i].minA > high) {
+                numOfSkipped += 1;  // 这一块中不可能有符合条件的记录
+                continue;
+            }
+            readAddr = zones[i].addr;
+        }
+        readBlk.loadFromDisk(readAddr);
+        int readRows = readBlk.decodeColumnA(A.data(), numOfRowInBlk);
+        for (int j = 0; j < readRows; ++j) {
+            if (!hasZoneMap)
+                addToZoneMap(newZones, readAddr, A[j]);
+            if (A[j] >= low && A[j] <= high) {
+                curAddr = resBlk.writeRow(readBlk.decodedRow(j));
+                resTable.size += 1;
+            }
+        }
+        next = readBlk.readNextAddr();
+        readBlk.freeBlock();
+    }
+    addr_t endAddr = resBlk.writeLastBlock();
+    if (endAddr != END_OF_FILE)
+        curAddr = endAddr;
+    resTable.end = curAddr;
+    if (hasZoneMap) {
+        printf("共%d块，借助zone map跳过了%d块\n\n", numOfBlk, numOfSkipped);
+    } else {
+        printf("聚簇文件没有zone map，已完整扫描一遍并建立zone map\n\n");
+        saveZoneMap(clusterAddr, newZones);
+    }
+    // 处理空结果表
+    if (resTable.size == 0)
+        resTable.start = resTable.end = 0;
+}
 
 /**************************** main ****************************/
 // int main() {
 //     bufferInit();
 //     table_t Result_table_R(condQueryStart);
-//     printf("===================== ʼR ====================\n");
+//     printf("===================== 开始检索R表 ====================\n");
 //     clear_Buff_IO_Count();
-//     /********* ԼּԲ *********/
+//     /********* 线性检索与二分检索测试部分 *********/
 //     // linearQuery(table_R, Result_table_R, 40, EQ_cond);
 //     // binaryQuery(table_R, Result_table_R, 40, cmp);
 //     // showResult(Result_table_R.start);
-//     // printf("\nעд̿飺%d-%d\n", Result_table_R.start, Result_table_R.end);
-//     // printf("ι%ldI/O\n\n", buff.numIO);
+//     // printf("\n注：结果写入磁盘块：%d-%d\n", Result_table_R.start, Result_table_R.end);
+//     // printf("本次共发生%ld次I/O\n\n", buff.numIO);
 
-//     /********* Բ *********/
-//     printf("----- δʱм -----\n");
+//     /********* 索引检索测试部分 *********/
+//     printf("----- 未建立索引时进行检索 -----\n");
 //     searchByIndex_and_Show(table_R, Result_table_R, 40);
-//     printf("----- ѽʱм -----\n");
+//     printf("----- 已建立索引时进行检索 -----\n");
 //     searchByIndex_and_Show(table_R, Result_table_R, 40);
 
-//     printf("===================== ʼS ====================\n");
+//     printf("===================== 开始检索S表 ====================\n");
 //     clear_Buff_IO_Count();
 //     addr_t newStartAddr = Result_table_R.end + 1;
-//     /********* ԼּԲ *********/
+//     /********* 线性检索与二分检索测试部分 *********/
 //     // table_t Result_table_S(newStartAddr);
 //     // linearQuery(table_S, Result_table_S, 60, EQ_cond);
 //     // binaryQuery(table_S, Result_table_S, 60, cmp);
 //     // showResult(Result_table_S.start);
-//     // printf("\nעд̿飺%d-%d\n", Result_table_S.start, Result_table_S.end);
-//     // printf("ι%ldI/O\n\n", buff.numIO);
+//     // printf("\n注：结果写入磁盘块：%d-%d\n", Result_table_S.start, Result_table_S.end);
+//     // printf("本次共发生%ld次I/O\n\n", buff.numIO);
 
-//     /********* Բ *********/
+//     /********* 索引检索测试部分 *********/
 //     table_t Result_table_S(newStartAddr);
-//     printf("----- δʱм -----\n");
+//     printf("----- 未建立索引时进行检索 -----\n");
 //     searchByIndex_and_Show(table_S, Result_table_S, 60);
-//     printf("----- ѽʱм -----\n");
+//     printf("----- 已建立索引时进行检索 -----\n");
 //     searchByIndex_and_Show(table_S, Result_table_S, 60);
-//     printf("=================== RǷ ==================\n");
+//     printf("=================== 看看R是否有索引 ==================\n");
 //     searchByIndex_and_Show(table_R, Result_table_R, 40);
 
 //     system("pause");
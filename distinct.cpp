@@ -2,23 +2,21 @@
 #pragma once
 
 
-const addr_t distinctTableStart = 500;
-
-
 /**
  * @brief 去重操作
  * 
  * @param table 待去重的表
- * @param resStartAddr 去重结果存放的起始位置，默认值为distinctTableStart
+ * @param resStartAddr 去重结果存放的起始位置，为默认值DEFAULT_ADDR时由地址分配器分配
  */
-void tableDistinct(table_t table, addr_t resStartAddr = distinctTableStart) {
+void tableDistinct(table_t table, addr_t resStartAddr = DEFAULT_ADDR) {
     int numOfUsedBlock = numOfBufBlock - 1;
     int numOfRows = numOfRowInBlk * numOfUsedBlock;
-    addr_t resAddr = resStartAddr;
+    addr_t resAddr = (resStartAddr == DEFAULT_ADDR) ? blkAllocator.allocate(1) : resStartAddr;
 
     // 想去重，先聚簇
     addr_t readAddr = useCluster(table);
-    block_t readBlk[numOfUsedBlock], resBlk;
+    std::vector<block_t> readBlk(numOfUsedBlock);
+    block_t resBlk;
     resBlk.writeInit(resAddr);
     addr_t nextStart = readAddr;
     for (int i = 0; i < numOfUsedBlock; ++i) {
@@ -29,12 +27,13 @@ void tableDistinct(table_t table, addr_t resStartAddr = distinctTableStart) {
             break;
         }
     }
-    row_t t[numOfRows], prior;
+    std::vector<row_t> t(numOfRows);
+    row_t prior;
 
     int readRows;
     while(1) {
-        readRows = read_N_Rows_From_M_Block(readBlk, t, numOfRows, numOfUsedBlock);
-        insertSort<row_t>(t, readRows);
+        readRows = read_N_Rows_From_M_Block(readBlk.data(), t.data(), numOfRows, numOfUsedBlock);
+        sortRows(t.data(), readRows);
         // printRows(t, readRows, val);
         for (int i = 0; i < readRows; ++i) {
             if (t[i] == prior) {
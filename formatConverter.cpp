@@ -0,0 +1,160 @@
+#include <vector>
+#include "utils.cpp"
+#include "catalog.cpp"
+
+
+/**
+ * @brief 块格式转换工具
+ * 将R、S两张表的所有块在v1(ASCII文本)、v2(二进制)、v3(二进制PAX)与v4(压缩)四种格式之间转换
+ * 块中记录的格式可以逐块识别，因此转换后的表可以直接被其他程序读取
+ * 用法：formatConverter [1|2|3|4] [--from-block-size=N] [--block-size=M]
+ * 第一个参数为目标格式的版本号，默认转换为v2
+ * v1、v2、v3格式之间每块的记录数相同，原地逐块转换，每块的地址和后继地址都不变
+ * v4格式的块按压缩后的容量存放记录，每块的记录数与其他格式不同
+ * 因此转换为v4或从v4转换回来时总是重新分块：读出全部记录后按新的容量写入新的块链
+ * 指定--from-block-size时，先将按N字节分块存储的R、S表重新分块为当前配置的块大小M
+ */
+
+
+/**
+ * @brief 读出一个文件中的所有记录
+ * 
+ * @param fileStartAddr 文件的起始地址块
+ * @return std::vector<row_t> 文件中的所有记录
+ */
+std::vector<row_t> readAllRows(addr_t fileStartAddr) {
+    std::vector<row_t> rows;
+    block_t readBlk;
+    readBlk.loadFromDisk(fileStartAddr);
+    for (row_t R = readBlk.getNewRow(); R.isFilled; R = readBlk.getNewRow())
+        rows.push_back(R);
+    if (rows.size() % numOfRowInBlk != 0)
+        readBlk.freeBlock();    // 最后一块未写满时不会被自动释放
+    return rows;
+}
+
+
+/**
+ * @brief 将记录按当前的块大小连续写入到从fileStartAddr开始的块中
+ * 
+ * @param fileStartAddr 文件的起始地址块
+ * @param rows 写入的记录
+ * @param format 写入的块格式
+ * @return addr_t 文件的最后一块地址
+ */
+addr_t writeAllRows(addr_t fileStartAddr, const std::vector<row_t> &rows, blkFormat_t format) {
+    block_t writeBlk;
+    addr_t curAddr = fileStartAddr;
+    writeBlk.writeInit(fileStartAddr, numOfRowInBlk, format);
+    for (size_t i = 0; i < rows.size(); ++i)
+        curAddr = writeBlk.writeRow(rows[i]);
+    addr_t endAddr = writeBlk.writeLastBlock();
+    return (endAddr != END_OF_FILE) ? endAddr : curAddr;
+}
+
+
+/**
+ * @brief 判断按capacity条记录分块后，每一块的记录都能压缩进一个v4格式的块中
+ * 
+ * @param rows 表中的所有记录
+ * @param capacity 每块的记录数
+ * @return bool 是否都能放下
+ */
+bool allBlocksFit(const std::vector<row_t> &rows, int capacity) {
+    for (size_t i = 0; i < rows.size(); i += capacity) {
+        if (!fitsInPackedBlock(rows.data() + i, std::min((size_t)capacity, rows.size() - i)))
+            return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief 选出R、S表压缩成v4格式时每块的记录数
+ * 
+ * @param rows_R R表的所有记录
+ * @param rows_S S表的所有记录
+ * @return int 两表的每一块都能放下时的最大记录数，至少为按块大小算出的记录数
+ */
+int choosePackedCapacity(const std::vector<row_t> &rows_R, const std::vector<row_t> &rows_S) {
+    // 容量超过表的记录数没有意义，反而会让各操作按块开辟的记录数组过大
+    int maxCapacity = std::min(maxPackedCapacity, (sizeOfBlock - sizeOfPackedHeader) * 8);
+    maxCapacity = std::min(maxCapacity, (int)std::max(rows_R.size(), rows_S.size()));
+    for (int capacity = maxCapacity; capacity > numOfRowInBlk; --capacity) {
+        if (allBlocksFit(rows_R, capacity) && allBlocksFit(rows_S, capacity))
+            return capacity;
+    }
+    return numOfRowInBlk;
+}
+
+
+/**
+ * @brief 将按fromBlkSize字节分块存储的R、S表重新分块为当前配置的块大小
+ * 
+ * @param fromBlkSize 原来的块大小
+ * @param format 重新分块后的块格式
+ */
+void reblockTables(int fromBlkSize, blkFormat_t format) {
+    int toBlkSize = sizeOfBlock;
+    if (isSegmentStoreOpen())
+        error("错误：段文件中的块无法重新分块，请在打包之前调整块的大小！");
+    // 按原来的块大小读出R、S表的所有记录
+    bufferStop();
+    if (!setBlockSize(fromBlkSize))
+        error("错误：原来的块大小不合法！");
+    bufferStart();
+    std::vector<row_t> rows_R = readAllRows(table_R.start);
+    std::vector<row_t> rows_S = readAllRows(table_S.start);
+    DropFiles(table_R.start);
+    DropFiles(table_S.start);
+    // 再按新的块大小写回
+    bufferStop();
+    setBlockSize(toBlkSize);
+    bufferStart();
+    if (format == BLK_FORMAT_PACKED) {
+        setPackedCapacity(choosePackedCapacity(rows_R, rows_S));
+        printf("压缩后每块容纳%d条记录\n", numOfRowInBlk);
+    }
+    // 先写S表占住它的起始块，R表写到S表的块时会由地址分配器另找空闲区段接着写
+    addr_t end_S = writeAllRows(table_S.start, rows_S, format);
+    addr_t end_R = writeAllRows(table_R.start, rows_R, format);
+    printf("重新分块完成！R表写入磁盘块：%d-%d，S表写入磁盘块：%d-%d\n",
+        table_R.start, end_R, table_S.start, end_S);
+}
+
+
+/**************************** main ****************************/
+int main(int argc, char *argv[]) {
+    int version = BLK_FORMAT_BINARY;
+    int fromBlkSize = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--from-block-size=", 18) == 0)
+            fromBlkSize = atoi(argv[i] + 18);
+        else if (argv[i][0] != '-')
+            version = atoi(argv[i]);
+    }
+    if (version < BLK_FORMAT_ASCII || version > BLK_FORMAT_PACKED) {
+        printf("错误：不支持的块格式v%d！\n", version);
+        system("pause");
+        exit(FAIL);
+    }
+    blkFormat_t format = version;
+    bufferInit(argc, argv);
+    dropCatalog();  // 转换后原来的聚簇和索引都已失效
+    if (fromBlkSize == 0)
+        fromBlkSize = sizeOfBlock;
+    bool fromPacked = (detectFileFormat(table_R.start) == BLK_FORMAT_PACKED);
+    if (fromBlkSize != sizeOfBlock || fromPacked || format == BLK_FORMAT_PACKED) {
+        printf("开始将R、S表从%d字节的块重新分块为%d字节的v%d格式的块...\n", fromBlkSize, sizeOfBlock, format);
+        reblockTables(fromBlkSize, format);
+        system("pause");
+        return OK;
+    }
+    reserveBaseTables();    // 原地转换后要按文件同步R、S表的所有块
+    printf("开始将R、S表转换为v%d格式...\n", format);
+    int numOfConverted = convertFileFormat(table_R.start, format);
+    numOfConverted += convertFileFormat(table_S.start, format);
+    printf("转换完成！共转换%d个磁盘块\n", numOfConverted);
+    system("pause");
+    return OK;
+}
@@ -0,0 +1,206 @@
+#include <cstdint>
+#include <map>
+#include "utils.cpp"
+#include "index.cpp"
+#pragma once
+
+/**
+ * @brief 磁盘上的可扩展散列索引
+ * 
+ * 索引文件由目录和桶两部分组成，都按v2格式写出：
+ * 目录占索引文件开头一段连续的块，第i项为(第i个槽位指向的桶的局部深度, 桶的首块地址)，空桶的首块地址为END_OF_FILE
+ * 目录共有2^globalDepth项，索引字段值的散列值取低globalDepth位即为槽位号，由槽位号可以直接算出它在目录中的块地址
+ * 每个桶是一串由下一块地址串起来的块，每项为(索引字段值, 行号)，行号的含义同二级索引
+ * 同一字段值的记录太多、一块放不下时无法靠分裂分开，这时桶占用多块
+ * 
+ * 查找一个值只需读目录中的一块和桶的首块，与表的大小无关
+ * 分裂时按散列值(hashKey)的低位依次把桶一分为二，因此要求散列值的低位也分布均匀
+ * 散列索引只在建立时一次写出，表本身不会插入新记录，因此桶的分裂与目录的倍增都在内存中完成
+ */
+
+typedef struct DiskHashIndex {
+    addr_t directory = END_OF_FILE;     // 目录的首地址，即索引文件的首地址
+    int globalDepth = 0;                // 全局深度，目录共有2^globalDepth项
+} hash_index_t;
+
+typedef std::map<std::pair<addr_t, int>, hash_index_t> hash_map_t;
+
+hash_map_t hashIndexMap;    // 散列索引映射表，格式为<(原表首地址, 索引字段), 该表的散列索引>
+
+const int MAX_GLOBAL_DEPTH = 16;    // 全局深度的上限，防止目录无限倍增
+
+
+/**
+ * @brief 建立过程中内存里的一个桶
+ */
+typedef struct HashBucket {
+    int localDepth = 0;                 // 局部深度，桶中所有项散列值的低localDepth位都相同
+    std::vector<index_t> entries;       // 桶中的(索引字段值, 行号)
+} hash_bucket_t;
+
+
+/**
+ * @brief 向可扩展散列表中插入一项，桶满时分裂，桶的局部深度等于全局深度时先将目录倍增
+ * 
+ * @param directory 目录，每项为桶的编号
+ * @param buckets 所有的桶
+ * @param globalDepth 全局深度
+ * @param entry 插入的(索引字段值, 行号)
+ * @param bucketSize 一个桶在不占用多块时能容纳的项数
+ * @param numOfEntries 连同entry在内已插入的项数，目录的项数不超过它
+ */
+void hashBucketInsert(std::vector<int> &directory, std::vector<hash_bucket_t> &buckets, int &globalDepth,
+    const index_t &entry, int bucketSize, int numOfEntries)
+{
+    uint32_t h = hashKey(entry.A);
+    while (1) {
+        int id = directory[h & ((1U << globalDepth) - 1)];
+        bool isSameKey = true;  // 桶中的项与插入的项字段值都相同时分裂不开，只能让桶占用多块
+        for (const index_t &other : buckets[id].entries)
+            isSameKey = isSameKey && other.A == entry.A;
+        // 字段值重复较多时，几个字段值的散列值可能要到很高的位才分得开
+        // 为此倍增目录得不偿失，这时也让桶占用多块
+        bool isDirFull = buckets[id].localDepth == globalDepth &&
+            (globalDepth == MAX_GLOBAL_DEPTH || 2 * (int)directory.size() > numOfEntries);
+        if ((int)buckets[id].entries.size() < bucketSize || isSameKey || isDirFull) {
+            buckets[id].entries.push_back(entry);
+            return;
+        }
+        if (buckets[id].localDepth == globalDepth) {
+            // 目录倍增，新的一半与原来的一半指向相同的桶
+            directory.insert(directory.end(), directory.begin(), directory.end());
+            globalDepth += 1;
+        }
+        // 按第localDepth位把桶一分为二，该位为1的项移到新桶
+        int bit = buckets[id].localDepth, newId = buckets.size();
+        buckets.push_back(hash_bucket_t());
+        std::vector<index_t> oldEntries;
+        oldEntries.swap(buckets[id].entries);
+        buckets[id].localDepth = buckets[newId].localDepth = bit + 1;
+        for (const index_t &other : oldEntries)
+            buckets[(hashKey(other.A) >> bit) & 1 ? newId : id].entries.push_back(other);
+        for (size_t slot = 0; slot < directory.size(); ++slot) {
+            if (directory[slot] == id && ((slot >> bit) & 1))
+                directory[slot] = newId;
+        }
+    }
+}
+
+
+/**
+ * @brief 在原表上建立散列索引
+ * 逐块扫描原表，把每条记录的(索引字段值, 行号)插入内存中的可扩展散列表，再依次写出目录和各个桶
+ * 
+ * @param table 被索引的原表
+ * @param keyType 索引字段
+ * @return hash_index_t 建立的散列索引
+ */
+hash_index_t buildHashIndex(const table_t &table, INDEX_KEY keyType) {
+    key_extractor_t keyOf = keyExtractorOf(keyType);
+    int rowsPerBlk = numOfRowInRowIdBlk();
+    std::vector<int> directory(1, 0);
+    std::vector<hash_bucket_t> buckets(1);
+    hash_index_t index;
+
+    addr_t next = table.start;
+    block_t readBlk;
+    std::vector<row_t> R(numOfRowInBlk);
+    int numOfEntries = 0;
+    while (next != END_OF_FILE) {
+        addr_t curAddr = next;
+        readBlk.loadFromDisk(curAddr);
+        int readRows = readBlk.decodeAll(R.data(), numOfRowInBlk);
+        for (int slot = 0; slot < readRows && R[slot].isFilled; ++slot) {
+            index_t entry;
+            entry.isFilled = true;
+            entry.A = keyOf(R[slot]), entry.B = makeRowId(curAddr, slot);
+            hashBucketInsert(directory, buckets, index.globalDepth, entry, rowsPerBlk, ++numOfEntries);
+        }
+        next = readBlk.readNextAddr();
+        readBlk.freeBlock();
+    }
+
+    // 目录须占一段连续的块，才能由槽位号直接算出块地址，因此先于各个桶一次申请
+    int numOfDirBlk = ceil(1.0 * directory.size() / rowsPerBlk);
+    index.directory = blkAllocator.allocate(numOfDirBlk);
+    std::vector<addr_t> bucketAddrs(buckets.size(), END_OF_FILE);
+    for (size_t id = 0; id < buckets.size(); ++id) {
+        int numOfEntries = buckets[id].entries.size();
+        if (numOfEntries == 0)
+            continue;
+        // 每个桶单独申请一段恰好够用的区段，并入索引文件
+        bucketAddrs[id] = blkAllocator.allocate(ceil(1.0 * numOfEntries / rowsPerBlk), index.directory);
+        block_t bucketBlk;
+        bucketBlk.writeInit(bucketAddrs[id], rowsPerBlk, BLK_FORMAT_BINARY);
+        for (const index_t &entry : buckets[id].entries)
+            bucketBlk.writeRow(entry);
+        bucketBlk.writeLastBlock(false); // 桶并入索引文件，随目录一起落盘
+    }
+    block_t dirBlk;
+    dirBlk.writeInit(index.directory, rowsPerBlk, BLK_FORMAT_BINARY);
+    for (int id : directory) {
+        index_t dirItem;
+        dirItem.isFilled = true;
+        dirItem.A = buckets[id].localDepth, dirItem.B = bucketAddrs[id];
+        dirBlk.writeRow(dirItem);
+    }
+    dirBlk.writeLastBlock();
+    hashIndexMap[std::make_pair(table.start, (int)keyType)] = index;
+    return index;
+}
+
+
+/**
+ * @brief 在散列索引中查找key
+ * 先读目录中槽位所在的一块取得桶的地址，再读入桶，桶占用多块时沿下一块地址读完
+ * 
+ * @param index 散列索引
+ * @param key 索引字段值
+ * @param rowIds 查找到的行号
+ * @return int 查找到的行号个数
+ */
+int hashIndexLookup(const hash_index_t &index, int key, std::vector<int> &rowIds) {
+    rowIds.clear();
+    if (index.directory == END_OF_FILE)
+        return 0;
+    int rowsPerBlk = numOfRowInRowIdBlk();
+    int slot = hashKey(key) & ((1U << index.globalDepth) - 1);
+    std::vector<row_t> R(numOfRowInBlk);
+    block_t readBlk;
+    readBlk.loadFromDisk(index.directory + slot / rowsPerBlk);
+    readBlk.decodeAll(R.data(), slot % rowsPerBlk + 1);
+    readBlk.freeBlock();
+    addr_t next = R[slot % rowsPerBlk].B;
+    while (next != END_OF_FILE) {
+        readBlk.loadFromDisk(next);
+        int readRows = readBlk.decodeAll(R.data(), rowsPerBlk);
+        for (int i = 0; i < readRows && R[i].isFilled; ++i) {
+            if (R[i].A == key)
+                rowIds.push_back(R[i].B);
+        }
+        next = readBlk.readNextAddr();
+        readBlk.freeBlock();
+    }
+    return rowIds.size();
+}
+
+
+/**
+ * @brief 散列索引管理——使用散列索引前的准备工作
+ * 散列索引直接建在原表上，不需要先聚簇
+ * 
+ * @param table 被索引的原表
+ * @param keyType 索引字段
+ * @return hash_index_t table在该字段上的散列索引
+ */
+hash_index_t useHashIndex(const table_t &table, INDEX_KEY keyType) {
+    auto findIndex = hashIndexMap.find(std::make_pair(table.start, (int)keyType));
+    if (findIndex != hashIndexMap.end())
+        return findIndex->second;
+    printf("当前查找表在该字段上仍未建立散列索引，现建立索引...\n");
+    unsigned long prior_IO = buff.numIO;
+    hash_index_t index = buildHashIndex(table, keyType);
+    printf("\n完成！目录始于磁盘块%d，全局深度%d\n", index.directory, index.globalDepth);
+    printf("建立索引所用IO: %lu\n\n", buff.numIO - prior_IO);
+    return index;
+}
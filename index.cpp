@@ -1,149 +1,519 @@
 #include <map>
 #include "utils.cpp"
+#include "zoneMap.cpp"
 #include "BplusTree/BplusTree.h"
 #pragma once
 
 /**
- * @brief ز
+ * @brief 索引相关操作
  * 
- * ڴһŲmapʵֵĵַӳ
- * ۴صַӳ(clusterTableMap)ڱԭ۴رĴ̵ַӳϵ
- * ַӳ(indexTableMap)ڱԭĴ̵ַӳϵ
+ * 内存中一共有两张采用map实现的地址映射表：
+ * 聚簇地址映射表(clusterTableMap)——用于保存原表到聚簇表的磁盘地址映射关系
+ * 索引地址映射表(indexTableMap)——用于保存原表到索引(磁盘上的B+树)的映射关系
+ * 另有一张二级索引映射表(secondaryIndexMap)，保存建立在原表上、不要求原表有序的二级索引
  * 
- * ¶
- * table_map_t: ӳϵʽΪ<ԭ׵ַ, (Ŀ׵ַ, Ŀĩβַ)>
- * pair_t: ӳϵԣmapinsert
+ * 新定义的几种类型
+ * table_map_t: 表的映射关系，格式为<原表首地址, (目标表首地址, 目标表末尾地址)>
+ * pair_t: 表的映射关系对，方便map的insert操作
+ * disk_index_t: 磁盘上的一棵B+树，index_map_t: 格式为<原表首地址, 该表的B+树>
+ * secondary_map_t: 格式为<(原表首地址, 索引字段), 该二级索引的B+树>
  */
 typedef std::map<addr_t, index_t> table_map_t;
 typedef std::pair<addr_t, index_t> pair_t;
 
-const addr_t index_start = 10000;   // indexʼ洢λ
 const index_t invalid_index;
 
-table_map_t clusterTableMap, indexTableMap; // ȫֵַӳ
-BPlusTree BPTR;
+/**
+ * @brief 磁盘上的B+树索引
+ * 叶结点就是索引文件本身：每块按索引字段值有序地存放(索引字段值, 第一次出现该值的聚簇块地址)，块末尾的下一块地址即右兄弟
+ * 内部结点在建立索引时自底向上逐层写出，每项为(子结点中最小的索引字段值, 子结点的块地址)，同一层的结点同样由下一块地址串起来
+ * 内部结点所在的区段都并入索引文件，随索引文件一起登记和删除
+ */
+typedef struct DiskIndex {
+    addr_t start = END_OF_FILE;     // 索引文件的首地址，即最左边的叶结点
+    addr_t root = END_OF_FILE;      // 根结点的块地址
+    int height = 0;                 // 树高，只有一个叶结点时为1，索引为空时为0
+} disk_index_t;
+
+typedef std::map<addr_t, disk_index_t> index_map_t;
+
+/**
+ * @brief 索引字段
+ * 聚簇索引只建在属性A上；二级索引可以建在A、B或(A, B)组合上，组合字段值由compositeKey算出
+ */
+enum INDEX_KEY {KEY_A, KEY_B, KEY_AB};
+typedef int (*key_extractor_t)(const row_t &R);     // 从记录中取出索引字段值
+typedef std::map<std::pair<addr_t, int>, disk_index_t> secondary_map_t;
+
+table_map_t clusterTableMap;    // 两张全局地址映射表
+index_map_t indexTableMap;
+secondary_map_t secondaryIndexMap;
+
+
+/**
+ * @brief 判断(A, B)能否合成组合字段值：两个属性都须在[0, MAX_ATTR_VAL)内
+ * 超出范围时不同的(A, B)会得到相同的字段值，A很大时乘积还会超出int的范围
+ * 
+ * @param A 属性A的值
+ * @param B 属性B的值
+ * @return bool 能否合成
+ */
+bool isCompositeKeyValid(int A, int B) { return A >= 0 && A < MAX_ATTR_VAL && B >= 0 && B < MAX_ATTR_VAL; }
+
+/**
+ * @brief (A, B)组合的索引字段值，先按A、再按B比较时的顺序与字段值的大小顺序一致
+ * 字段值要存进索引项的int中，因此(A, B)超出取值范围时直接报错
+ * 
+ * @param A 属性A的值
+ * @param B 属性B的值
+ * @return int 组合字段值
+ */
+int compositeKey(int A, int B) {
+    if (!isCompositeKeyValid(A, B)) {
+        printf("错误：(%d, %d)超出了组合索引字段的取值范围[0, %d)！\n", A, B, MAX_ATTR_VAL);
+        system("pause");
+        exit(FAIL);
+    }
+    return A * MAX_ATTR_VAL + B;
+}
+
+int keyOfA(const row_t &R) { return R.A; }
+int keyOfB(const row_t &R) { return R.B; }
+int keyOfAB(const row_t &R) { return compositeKey(R.A, R.B); }
+
+/**
+ * @brief 取索引字段对应的字段值提取函数
+ * 
+ * @param keyType 索引字段
+ * @return key_extractor_t 字段值提取函数
+ */
+key_extractor_t keyExtractorOf(INDEX_KEY keyType) {
+    if (keyType == KEY_B)
+        return keyOfB;
+    if (keyType == KEY_AB)
+        return keyOfAB;
+    return keyOfA;
+}
+
+
+/**
+ * @brief 行号(row id)：记录所在的块地址和它在块中的序号合成的一个整数
+ * 二级索引指向的是未排序的原表，同一字段值的记录散落在各处，因此要精确到每条记录
+ */
+int makeRowId(addr_t addr, int slot) { return addr * numOfRowInBlk + slot; }
+addr_t rowIdAddr(int rowId) { return rowId / numOfRowInBlk; }
+int rowIdSlot(int rowId) { return rowId % numOfRowInBlk; }
+
+/**
+ * @brief 打开的一棵磁盘B+树
+ * 结点都经缓冲区按需读入，查找一个值只需读树高那么多块，不必先把整个索引装进内存
+ * 每个对象只记录自己的树和最近读入的叶结点，因此可以同时打开多个索引
+ */
+class DiskBPlusTree {
+public:
+    DiskBPlusTree(const disk_index_t &index) : index(index) {}
+    addr_t search(int key);
+    addr_t searchAscending(int key);
+    int scan(int lowKey, int highKey, std::vector<index_t> &entries);
+
+private:
+    /**
+     * @brief 读入内存的一个结点
+     * 索引字段值与块地址分开存放，结点内查找时用countLess顺序比较一段连续的整数
+     */
+    typedef struct DiskNode {
+        std::vector<int> keys;          // 各索引项的索引字段值
+        std::vector<addr_t> addrs;      // 各索引项的块地址
+        addr_t next = END_OF_FILE;      // 同一层中的下一个结点
+    } disk_node_t;
+
+    disk_index_t index;
+    disk_node_t leaf;                   // 最近读入的叶结点
+    bool isLeafLoaded = false;
+    addr_t _findLeaf(int key, bool isFirstOccurrence);
+    addr_t _findInLeaf(int key);
+    static void _readNode(addr_t addr, disk_node_t &node);
+};
+
+
+/**
+ * @brief 从根结点逐层向下查找key
+ * 
+ * @param key 索引字段值
+ * @return addr_t 第一次出现key的聚簇块地址，索引中没有key时为END_OF_FILE
+ */
+addr_t DiskBPlusTree::search(int key) {
+    if (index.height == 0)
+        return END_OF_FILE;
+    _readNode(_findLeaf(key, false), leaf);
+    isLeafLoaded = true;
+    return _findInLeaf(key);
+}
+
+
+/**
+ * @brief 按递增的顺序依次查找时使用的search
+ * 先在最近读入的叶结点中查找，超出该叶结点时读入其右兄弟，仍超出时才从根结点重新查找
+ * 驱动表有序时，这样每个叶结点至多读入一次
+ * 
+ * @param key 索引字段值，不得小于上一次查找的值
+ * @return addr_t 第一次出现key的聚簇块地址，索引中没有key时为END_OF_FILE
+ */
+addr_t DiskBPlusTree::searchAscending(int key) {
+    if (isLeafLoaded) {
+        if (key <= leaf.keys.back())
+            return _findInLeaf(key);
+        if (leaf.next == END_OF_FILE)
+            return END_OF_FILE;     // key比索引中的所有值都大
+        _readNode(leaf.next, leaf);
+        if (key <= leaf.keys.back() || leaf.next == END_OF_FILE)
+            return _findInLeaf(key);
+    }
+    return search(key);
+}
 
 
 /**
- * @brief ľ۴زtableо۴أ۴ؽ
- * ۴ʵϾʹűһΪֱӦ˹鲢
- * һ򣬶Ӧscan_1_PartialSort
- * ڶ鲢򣬶Ӧscan_2_SortMerge
+ * @brief 范围查找：按索引字段值的顺序取出所有lowKey <= 字段值 <= highKey的索引项
+ * 二级索引中同一字段值可能跨越多个叶结点，因此先找到可能含有lowKey第一次出现的叶结点，再沿右兄弟依次读下去
  * 
- * @param table ǰ۴رϢ
- * @param clusterAddr ۴ؽʼ洢λ
+ * @param lowKey 范围的下界
+ * @param highKey 范围的上界
+ * @param entries 查找到的索引项(索引字段值, 块地址或行号)
+ * @return int 查找到的索引项个数
  */
-void tableClustering(table_t table, addr_t clusterAddr) {
-    addr_t scan_1_Index = addrOfScan_1; // һɨʼַ
+int DiskBPlusTree::scan(int lowKey, int highKey, std::vector<index_t> &entries) {
+    entries.clear();
+    if (index.height == 0 || lowKey > highKey)
+        return 0;
+    addr_t addr = _findLeaf(lowKey, true);
+    while (addr != END_OF_FILE) {
+        _readNode(addr, leaf);
+        isLeafLoaded = true;
+        int numOfKeys = leaf.keys.size();
+        int pos = countLess<int>(leaf.keys.data(), numOfKeys, lowKey);
+        for (; pos < numOfKeys && leaf.keys[pos] <= highKey; ++pos) {
+            index_t entry;
+            entry.isFilled = true;
+            entry.A = leaf.keys[pos], entry.B = leaf.addrs[pos];
+            entries.push_back(entry);
+        }
+        if (pos < numOfKeys)
+            break;      // 已读到大于highKey的字段值
+        addr = leaf.next;
+    }
+    return entries.size();
+}
+
+
+/**
+ * @brief 从根结点逐层向下，找到key所在的叶结点
+ * 
+ * @param key 索引字段值
+ * @param isFirstOccurrence 为false时取最后一个最小值不大于key的子结点，适用于字段值不重复的索引
+ *  为true时取最后一个最小值小于key的子结点，key有重复时它第一次出现在该叶结点或其右兄弟中
+ * @return addr_t 叶结点的块地址
+ */
+addr_t DiskBPlusTree::_findLeaf(int key, bool isFirstOccurrence) {
+    addr_t addr = index.root;
+    disk_node_t node;
+    for (int level = index.height; level > 1; --level) {
+        _readNode(addr, node);
+        // key比索引中的所有值都小时取最左边的子结点
+        int numOfKeys = node.keys.size();
+        int child = countLess<int>(node.keys.data(), numOfKeys, key);
+        if (!isFirstOccurrence && child < numOfKeys && node.keys[child] == key)
+            child += 1;
+        addr = node.addrs[(child > 0) ? child - 1 : 0];
+    }
+    return addr;
+}
+
+
+/**
+ * @brief 在最近读入的叶结点中查找key
+ * 
+ * @param key 索引字段值
+ * @return addr_t 第一次出现key的聚簇块地址，叶结点中没有key时为END_OF_FILE
+ */
+addr_t DiskBPlusTree::_findInLeaf(int key) {
+    int numOfKeys = leaf.keys.size();
+    int pos = countLess<int>(leaf.keys.data(), numOfKeys, key);
+    if (pos == numOfKeys || leaf.keys[pos] != key)
+        return END_OF_FILE;
+    return leaf.addrs[pos];
+}
+
+
+/**
+ * @brief 读入一个结点的所有索引项，读完即释放所占的缓冲区
+ * 
+ * @param addr 结点的块地址
+ * @param node 读出的结点
+ */
+void DiskBPlusTree::_readNode(addr_t addr, disk_node_t &node) {
+    block_t blk;
+    blk.loadFromDisk(addr);
+    int capacity = blk.getCapacity();
+    node.keys.resize(capacity);
+    int numOfEntries = blk.decodeColumnA(node.keys.data(), capacity);
+    node.keys.resize(numOfEntries);
+    node.addrs.resize(numOfEntries);
+    for (int i = 0; i < numOfEntries; ++i)
+        node.addrs[i] = blk.decodedRow(i).B;
+    node.next = blk.readNextAddr();
+    blk.freeBlock();
+}
+
+
+/**
+ * @brief 表的聚簇操作：对table进行聚簇，并将聚簇结果存入磁盘中
+ * 聚簇实际上就是使整张表有序，一共分为两步，分别对应两趟归并排序
+ * 第一步：表的组内排序，对应scan_1_PartialSort
+ * 第二步：表的组间归并排序，对应scan_2_SortMerge
+ * 聚簇表存放在一段恰好够用的连续区段中，buildIndex可以直接由记录的序号算出其所在块的地址
+ * 归并时顺带记下聚簇文件每块的zone map并写入磁盘
+ * 
+ * @param table 当前待聚簇表信息
+ * @param clusterAddr 聚簇结果的起始存储位置，为默认值DEFAULT_ADDR时由地址分配器分配
+ * @return addr_t 聚簇结果的起始存储位置
+ */
+addr_t tableClustering(table_t table, addr_t clusterAddr = DEFAULT_ADDR) {
     int rowTimes2Standard = table.rowSize / sizeOfRow;
-    int numOfRows = rowTimes2Standard * (numOfRowInBlk / rowTimes2Standard);    // һж׼Сļ¼
-    int sizeOfSubTable = numOfRows * numOfBufBlock;      // ɻֳӱСλУ
+    int numOfRows = rowTimes2Standard * (numOfRowInBlk / rowTimes2Standard);    // 一块中有多少条标准大小的记录
+    int sizeOfSubTable = numOfRows * numOfBufBlock;      // 由缓冲区划分出的子表大小（单位：行）
     if (sizeOfSubTable == 0)
-        error("tableϢȫtableĲ");
-    int numOfSubTables = ceil(1.0 * rowTimes2Standard * table.size / sizeOfSubTable);   // ֳӱ
-
-    // ۴ز˹鲢
-    scan_1_PartialSort(numOfSubTables, scan_1_Index, table.start, sizeOfSubTable);
-    addr_t endAddr = scan_2_SortMerge(numOfSubTables, scan_1_Index, clusterAddr);
-    // ɾ۴عвʱļ
-    for (int i = 0; i < numOfSubTables; ++i) {
-        addr_t next = scan_1_Index + i * 8;
-        DropFiles(next);
-    }
+        error("table信息不全：请检查table的参数！");
+    int numOfSubTables = ceil(1.0 * rowTimes2Standard * table.size / sizeOfSubTable);   // 划分出的子表数量
+    if (numOfSubTables >= numOfBufBlock)
+        error("错误：缓冲区太小，无法通过两趟扫描完成聚簇！");
+    std::vector<addr_t> scan_1_Index(numOfSubTables);    // 一趟扫描每个子表的起始地址
+    if (clusterAddr == DEFAULT_ADDR)
+        clusterAddr = blkAllocator.allocate(ceil(1.0 * rowTimes2Standard * table.size / numOfRowInBlk));
+
+    // 聚簇操作：两趟归并排序
+    scan_1_PartialSort(numOfSubTables, scan_1_Index.data(), table.start, sizeOfSubTable);
+    zone_map_t zones;   // 归并写出时顺带记下聚簇文件的zone map
+    addr_t endAddr = scan_2_SortMerge(numOfSubTables, scan_1_Index.data(), clusterAddr, &zones);
+    // 删除聚簇过程中产生的临时文件
+    for (int i = 0; i < numOfSubTables; ++i)
+        DropFiles(scan_1_Index[i]);
     if (endAddr == ADDR_NOT_EXISTS)
-        error("ɨִ");
+        error("二趟扫描出现错误！");
 
-    // µľ۴Ŀ
+    // 创建新的聚簇条目
     index_t clusterIndex;
     clusterIndex.A = clusterAddr, clusterIndex.B = endAddr;
     clusterTableMap.insert(pair_t(table.start, clusterIndex));
+    saveZoneMap(clusterAddr, zones);
+    return clusterAddr;
 }
 
 
 /**
- * @brief ļ
- * ʽ(ֵֶ, һγֵַָ)
- * ǰ᣺ı辭۴زclusterTableMapжӦӳ
+ * @brief 自底向上写出B+树的内部结点
+ * 每一层写满一块就是一个结点，直到某一层只有一个结点，即根结点
  * 
- * @param clusteredTableStart ľ۴رʼַ
- * @param indexStart ļʼַ
- * @return addr_t ļڴ洢һ̿ĵַ
+ * @param indexStart 索引文件的首地址，内部结点所在的区段都并入索引文件
+ * @param children 叶结点层各结点的(最小索引字段值, 块地址)
+ * @param rowsPerBlk 每个结点的索引项数
+ * @param format 结点所用的块格式
+ * @return disk_index_t 写好的B+树
  */
-addr_t buildIndex(addr_t clusteredTableStart, addr_t indexStart) {
-    addr_t next = clusteredTableStart, indexAddr = 0;
+disk_index_t buildInnerNodes(addr_t indexStart, std::vector<index_t> children,
+    int rowsPerBlk, blkFormat_t format)
+{
+    disk_index_t tree;
+    tree.start = indexStart, tree.height = 1;
+    while (children.size() > 1) {
+        std::vector<index_t> parents;
+        addr_t levelStart = blkAllocator.allocate(1, indexStart), nodeAddr = END_OF_FILE;
+        block_t resBlk;
+        resBlk.writeInit(levelStart, rowsPerBlk, format);
+        for (const index_t &child : children) {
+            addr_t curAddr = resBlk.writeRow(child);
+            if (curAddr != nodeAddr) {
+                // 写入了新的一块，即上一层的一个新结点
+                index_t parent;
+                parent.isFilled = true;
+                parent.A = child.A, parent.B = curAddr;
+                parents.push_back(parent);
+                nodeAddr = curAddr;
+            }
+        }
+        resBlk.writeLastBlock(false);
+        children.swap(parents);
+        tree.height += 1;
+    }
+    if (children.empty())
+        tree.height = 0;    // 被索引的表为空，索引文件也是空的
+    else
+        tree.root = children[0].B;
+    syncFile(indexStart);   // 叶结点和各层内部结点都写完后，整个索引文件一次落盘
+    return tree;
+}
+
+
+/**
+ * @brief 建立索引文件，并在其上建立B+树的内部结点
+ * 索引格式：(索引字段值, 第一次出现该值的索引块地址)，按索引字段值有序，作为B+树的叶结点
+ * 与二级索引一样，叶结点和内部结点都按v2格式写出，不受表所用格式的限制
+ * 前提：被索引的表需经过聚簇操作，在clusterTableMap中有对应的映射项
+ * 
+ * @param clusteredTableStart 被索引的聚簇表的起始地址
+ * @param indexStart 索引文件的起始地址
+ * @return disk_index_t 建立的B+树
+ */
+disk_index_t buildIndex(addr_t clusteredTableStart, addr_t indexStart) {
+    addr_t next = clusteredTableStart, indexAddr = END_OF_FILE;
+    std::vector<index_t> leaves;    // 每个叶结点的(最小索引字段值, 块地址)
     int numOfReadBlocks = numOfBufBlock - 1;
     int numOfIndices = numOfRowInBlk * numOfReadBlocks;
 
-    // Ҿ۴صַӳǷжӦ
+    // 查找聚簇地址映射表中是否有对应的项
     addr_t tableAddr;
     auto findOrigin = std::find_if(clusterTableMap.begin(), clusterTableMap.end(),
         [clusteredTableStart](const table_map_t::value_type item)
-    {   // Ҿ۴ر׵ַӦԭ׵ַ
+    {   // 查找聚簇表首地址对应的原表首地址
         index_t clusterIndex = item.second;
         return (clusterIndex.A == clusteredTableStart);
     });
     if (findOrigin == clusterTableMap.end()) {
-        // ĬbuildIndex֮ǰñ۴(tableClustering)
-        // ûҵӦ׵ַ֤þ۴رϢʧ
-        printf("ش󣺾۴Ϣʧ\n");
+        // 这里默认了buildIndex之前该表已做过聚簇(tableClustering)
+        // 所以如果没有找到对应的首地址，证明该聚簇表的信息丢失了
+        printf("严重错误：聚簇信息丢失！\n");
         system("pause");
         exit(0);
     }
-    tableAddr = findOrigin->first;  // ȡӦԭ׵ַ
+    tableAddr = findOrigin->first;  // 获取对应的原表首地址
 
-    row_t R[numOfIndices], R_prior;
-    block_t blk[numOfReadBlocks], resBlk;
-    resBlk.writeInit(indexStart);
-    for (int i = 0; i < numOfReadBlocks; ++i)
-        blk[i].loadFromDisk(next++);
+    std::vector<block_t> blk(numOfReadBlocks);
+    block_t resBlk;
+    resBlk.writeInit(indexStart, numOfRowInRowIdBlk(), BLK_FORMAT_BINARY);
+    for (int i = 0; i < numOfReadBlocks; ++i) {
+        blk[i].loadFromDisk(next);
+        next = blk[i].readNextAddr();
+        if (next == END_OF_FILE) {
+            numOfReadBlocks = i + 1;
+            numOfIndices = numOfRowInBlk * numOfReadBlocks;
+            break;
+        }
+    }
+    std::vector<row_t> R(numOfIndices);
+    row_t R_prior;
     int readRows, count = 0;
     while(1) {
-        // ˳ѰÿֵֶһγֵĿַд
-        readRows = read_N_Rows_From_M_Block(blk, R, numOfIndices, numOfReadBlocks);
-        insertSort<row_t>(R, readRows);
+        // 顺序遍历，寻找每个索引字段值第一次出现的块地址，将其写入结果中
+        readRows = read_N_Rows_From_M_Block(blk.data(), R.data(), numOfIndices, numOfReadBlocks);
+        sortRows(R.data(), readRows);
         // printRows(R, readRows);
         for (int i = 0; i < readRows; ++i, ++count) {
             if (R_prior.isFilled == false || R_prior.A < R[i].A) {
-                // µֵֶһֵֵֶͬһγ
+                // 新的索引字段值与上一个索引字段值不同，即该值第一次出现
                 index_t indexItem;
+                indexItem.isFilled = true;
                 indexItem.A = R[i].A;
                 indexItem.B = clusteredTableStart + count / numOfRowInBlk;
-                indexAddr = resBlk.writeRow(indexItem);
+                addr_t curAddr = resBlk.writeRow(indexItem);
+                if (curAddr != indexAddr) {
+                    // 写入了新的一块，即一个新的叶结点
+                    index_t leaf;
+                    leaf.isFilled = true;
+                    leaf.A = indexItem.A, leaf.B = curAddr;
+                    leaves.push_back(leaf);
+                    indexAddr = curAddr;
+                }
             }
             R_prior = R[i];
         }
         if (readRows < numOfIndices) {
-            // ۴رѶ
-            addr_t endAddr = resBlk.writeLastBlock();
-            if (endAddr != END_OF_FILE)
-                indexAddr = endAddr;
+            // 聚簇表已读完
+            resBlk.writeLastBlock(false);
             break;
         }
     }
-    // дַӳ
-    table_map_t::iterator findIndex;
+    disk_index_t tree = buildInnerNodes(indexStart, leaves, numOfRowInRowIdBlk(), BLK_FORMAT_BINARY);
+    // 写索引地址映射表
+    index_map_t::iterator findIndex;
     findIndex = indexTableMap.find(tableAddr);
     if (findIndex != indexTableMap.end()) {
-        printf("ô׼...\n");
+        printf("该处已有索引项，准备覆盖...\n");
         indexTableMap.erase(findIndex);
     }
-    index_t addrItem;
-    addrItem.A = indexStart, addrItem.B = indexAddr;
-    indexTableMap.insert(pair_t(tableAddr, addrItem));
-    return indexAddr;
+    indexTableMap.insert(std::make_pair(tableAddr, tree));
+    return tree;
 }
 
 
 /**
- * @brief Ӵмļ
- * ʽ(ֵֶ, һγֵַ)
+ * @brief 在原表上建立二级索引
+ * 原表不必有序，索引文件本身是按(索引字段值, 行号)排序的行号列表，同一字段值的每条记录各占一项，作为B+树的叶结点
+ * 逐块扫描原表，由keyExtractorOf取出每条记录的索引字段值，连同行号在内存中排好序后写出，再在其上建立内部结点
  * 
- * @param indexStart ļʼַ
+ * @param table 被索引的原表
+ * @param keyType 索引字段
+ * @param indexStart 索引文件的起始地址
+ * @return disk_index_t 建立的B+树
  */
-void loadIndex(addr_t indexStart) {
+disk_index_t buildSecondaryIndex(const table_t &table, INDEX_KEY keyType, addr_t indexStart) {
+    key_extractor_t keyOf = keyExtractorOf(keyType);
+    std::vector<index_t> entries;
+    addr_t next = table.start;
+    block_t readBlk;
+    std::vector<row_t> R(numOfRowInBlk);
+    while (next != END_OF_FILE) {
+        addr_t curAddr = next;
+        readBlk.loadFromDisk(curAddr);
+        int readRows = readBlk.decodeAll(R.data(), numOfRowInBlk);
+        for (int slot = 0; slot < readRows && R[slot].isFilled; ++slot) {
+            index_t entry;
+            entry.isFilled = true;
+            entry.A = keyOf(R[slot]), entry.B = makeRowId(curAddr, slot);
+            entries.push_back(entry);
+        }
+        next = readBlk.readNextAddr();
+        readBlk.freeBlock();
+    }
+    // 同一字段值的行号也按递增顺序排列，按索引取记录时依次读块即可
+    pdqSort(entries.data(), entries.data() + entries.size(), [](const index_t &x, const index_t &y) {
+        return (x.A != y.A) ? x.A < y.A : x.B < y.B;
+    });
+
+    std::vector<index_t> leaves;    // 每个叶结点的(最小索引字段值, 块地址)
+    addr_t indexAddr = END_OF_FILE;
+    block_t resBlk;
+    resBlk.writeInit(indexStart, numOfRowInRowIdBlk(), BLK_FORMAT_BINARY);
+    for (const index_t &entry : entries) {
+        addr_t curAddr = resBlk.writeRow(entry);
+        if (curAddr != indexAddr) {
+            index_t leaf;
+            leaf.isFilled = true;
+            leaf.A = entry.A, leaf.B = curAddr;
+            leaves.push_back(leaf);
+            indexAddr = curAddr;
+        }
+    }
+    resBlk.writeLastBlock(false);
+    disk_index_t tree = buildInnerNodes(indexStart, leaves, numOfRowInRowIdBlk(), BLK_FORMAT_BINARY);
+    secondaryIndexMap[std::make_pair(table.start, (int)keyType)] = tree;
+    return tree;
+}
+
+
+/**
+ * @brief 从磁盘中把索引文件加载到内存中的B+树
+ * 索引格式：(索引字段值, 第一次出现的索引块地址)
+ * 按索引查询不再需要这一步，DiskBPlusTree直接在磁盘上查找
+ * 索引文件本身就是有序的，读完后由bulkLoad自底向上一次建成B+树，不必逐个插入
+ * 
+ * @param indexStart 索引文件的起始地址
+ * @param tree 加载到的B+树，原有的内容会被清空
+ * @param fillFactor B+树结点的填充率
+ */
+void loadIndex(addr_t indexStart, BPlusTree<int> &tree, double fillFactor = 1.0) {
     addr_t next = indexStart;
     int numOfReadBlocks = numOfBufBlock;
-    block_t blk[numOfReadBlocks];
+    std::vector<block_t> blk(numOfReadBlocks);
     for (int i = 0; i < numOfReadBlocks; ++i) {
         blk[i].loadFromDisk(next);
         next = blk[i].readNextAddr();
@@ -152,115 +522,113 @@ void loadIndex(addr_t indexStart) {
             break;
         }
     }
-    int numOfIndices = numOfRowInBlk * numOfReadBlocks;
-    index_t index[numOfIndices];
-    BPTR.clear();
+    int rowsPerBlk = numOfRowInRowIdBlk();
+    int numOfIndices = rowsPerBlk * numOfReadBlocks;
+    std::vector<index_t> index(numOfIndices);
+    vector<BPlusTree<int>::item_t> items;
 
     int readRows, numOfUsedBlocks;
     while(1) {
-        readRows = read_N_Rows_From_M_Block(blk, index, numOfIndices, numOfReadBlocks);
-        numOfUsedBlocks = ceil(1.0 * readRows / numOfRowInBlk);
-        insertSort<row_t>(index, readRows);
+        readRows = read_N_Rows_From_M_Block(blk.data(), index.data(), numOfIndices, numOfReadBlocks);
+        numOfUsedBlocks = ceil(1.0 * readRows / rowsPerBlk);
+        sortRows(index.data(), readRows);
         // printRows(R, readRows);
-        for (int i = 0; i < readRows; ++i) {
-            BPTR.insert(index[i].A, index[i].B);
-        }
+        for (int i = 0; i < readRows; ++i)
+            items.push_back(BPlusTree<int>::item_t(index[i].A, index[i].B));
         if (numOfUsedBlocks < numOfReadBlocks) {
             for (int i = 0; i < numOfUsedBlocks; ++i)
                 blk[i].freeBlock();
             break;
         }
     }
-    // BPTR.printData();
+    tree.bulkLoad(items, fillFactor);
+    // tree.printData();
 }
 
 
 /**
- * @brief ۴عʹþ۴ļǰ׼
- * tableо۴ļ۴ĿȽṹɺ͹
- * ṩ۴صĽӿ
+ * @brief 聚簇管理——使用聚簇文件前的准备工作
+ * 对table进行聚簇文件、聚簇条目等结构的生成和管理
+ * 用作对外提供聚簇的接口
  * 
- * @param table ۴عı
- * @param clusterAddr ۴ļʼַΪĬֵDEFAULT_ADDRʹеľ۴ļ
- *  øòclusterTableMapжӦĿ
+ * @param table 待做聚簇管理的表
+ * @param clusterAddr 聚簇文件的起始地址，若为默认值DEFAULT_ADDR则使用现有的聚簇文件
+ *  否则将用该参数覆盖clusterTableMap中对应的条目
  * @return addr_t 
  */
 addr_t useCluster(table_t table, addr_t clusterAddr = DEFAULT_ADDR) {
     if (clusterAddr == DEFAULT_ADDR) {
-        // ʹõĬϾ۴صַ鵱ǰǷжӦľ۴Ŀ
+        // 若使用的是默认聚簇地址，则检查当前表是否有对应的聚簇条目
         table_map_t::iterator findCluster = clusterTableMap.find(table.start);
         if (findCluster == clusterTableMap.end()) {
-            // ޶Ӧľ۴Ŀ򴴽֮о۴ز
-            printf("ǰұδδ۴أֽо۴ز...\n");
-            if (clusterTableMap.size() == 0) {
-                // clusterTableMapûо۴Ŀ
-                // ָĵַaddrOfScan_2ʼ۴ļ
-                clusterAddr = addrOfScan_2;
-            } else {
-                // һ۴Ŀһַʼ۴ļ
-                table_map_t::iterator iter = clusterTableMap.end();
-                --iter;
-                clusterAddr = (iter->second).B + 1;
-            }
+            // 若无对应的聚簇条目，则创建之并进行聚簇操作
+            // 聚簇文件的地址由tableClustering向地址分配器申请
+            printf("当前查找表未仍未聚簇，现进行聚簇操作...\n");
         } else {
             index_t addrItem = findCluster->second;
             clusterAddr = addrItem.A;
             return clusterAddr;
         }
     } else {
-        // ʹõԶ۴صַȲ鿴ǷжӦľ۴ĿҪ
+        // 若使用的是自定义聚簇地址，则先查看是否有对应的聚簇条目需要覆盖
         for (auto iter = clusterTableMap.begin(); iter != clusterTableMap.end(); ++iter) {
             index_t clusterIndex = iter->second;
             if (clusterIndex.A == clusterAddr) {
-                printf("˴о۴Ŀ׼...\n");
-                clusterTableMap.erase(iter);    // ԭľ۴Ŀ
+                printf("此处已有聚簇条目，准备覆盖...\n");
+                clusterTableMap.erase(iter);    // 清除原来的聚簇条目
                 break;
             }
         }
     }
-    tableClustering(table, clusterAddr);
-    printf("\n۴ɣ\n");
-    printf("۴IO: %d\n\n", buff.numIO);
+    clusterAddr = tableClustering(table, clusterAddr);
+    printf("\n聚簇完成！\n");
+    printf("聚簇所用IO: %d\n\n", buff.numIO);
     return clusterAddr;
 }
 
 
 /**
- * @brief ʹļǰ׼
- * tableļĿȽṹɺ͹
- * ṩĽӿ
+ * @brief 索引管理——使用索引文件前的准备工作
+ * 对table进行索引文件、索引条目等结构的生成和管理
+ * 用作对外提供索引的接口
  * 
- * @param table ۴عı
- * @return addr_t tableӦļʼַ
+ * @param table 待做聚簇管理的表
+ * @return disk_index_t table对应的B+树
  */
-addr_t useIndex(table_t table) {
-    addr_t indexAddr;
-    table_map_t::iterator findIndex = indexTableMap.find(table.start);
-    // tableǷѽ
-    if (findIndex == indexTableMap.end()) {
-        printf("ǰұδδֽ...\n");
-        addr_t indexStartAddr;
-        if (indexTableMap.size() == 0) {
-            // indexTableMapûĿ
-            // ָĵַindex_startʼ
-            indexStartAddr = index_start;
-        } else {
-            // һĿһַʼ
-            table_map_t::iterator iter = indexTableMap.end();
-            --iter;
-            indexStartAddr = (iter->second).B + 1;
-        }
-        unsigned long prior_IO = buff.numIO;
-        addr_t clusterAddr = clusterTableMap.at(table.start).A;
-        addr_t indexEndAddr = buildIndex(clusterAddr, indexStartAddr);
-        if (indexEndAddr != END_OF_FILE)
-            printf("\nɣд̿飺%d-%d\n", indexStartAddr, indexEndAddr);
-        indexAddr = indexStartAddr;
-        printf("IO: %d\n\n", buff.numIO - prior_IO);
-    } else {
-        // жӦĿֱĿ
-        index_t addrItem = indexTableMap.at(table.start);
-        indexAddr = addrItem.A;
-    }
-    return indexAddr;
+disk_index_t useIndex(table_t table) {
+    index_map_t::iterator findIndex = indexTableMap.find(table.start);
+    // 检查table的索引是否已建立
+    if (findIndex != indexTableMap.end())
+        return findIndex->second;   // 若有对应的索引条目，则直接引用索引条目即可
+    printf("当前查找表未仍未建立索引，现建立索引...\n");
+    // 索引文件的大小事先未知，先申请一块，写满后再向后扩展
+    addr_t indexStartAddr = blkAllocator.allocate(1);
+    unsigned long prior_IO = buff.numIO;
+    addr_t clusterAddr = clusterTableMap.at(table.start).A;
+    disk_index_t tree = buildIndex(clusterAddr, indexStartAddr);
+    printf("\n完成！索引文件始于磁盘块%d，根结点位于磁盘块%d，树高%d\n", tree.start, tree.root, tree.height);
+    printf("建立索引所用IO: %d\n\n", buff.numIO - prior_IO);
+    return tree;
+}
+
+
+/**
+ * @brief 二级索引管理——使用二级索引前的准备工作
+ * 二级索引直接建在原表上，不需要先聚簇
+ * 
+ * @param table 被索引的原表
+ * @param keyType 索引字段
+ * @return disk_index_t table在该字段上的二级索引
+ */
+disk_index_t useSecondaryIndex(const table_t &table, INDEX_KEY keyType) {
+    auto findIndex = secondaryIndexMap.find(std::make_pair(table.start, (int)keyType));
+    if (findIndex != secondaryIndexMap.end())
+        return findIndex->second;
+    printf("当前查找表在该字段上仍未建立二级索引，现建立索引...\n");
+    addr_t indexStartAddr = blkAllocator.allocate(1);
+    unsigned long prior_IO = buff.numIO;
+    disk_index_t tree = buildSecondaryIndex(table, keyType, indexStartAddr);
+    printf("\n完成！索引文件始于磁盘块%d，根结点位于磁盘块%d，树高%d\n", tree.start, tree.root, tree.height);
+    printf("建立索引所用IO: %lu\n\n", buff.numIO - prior_IO);
+    return tree;
 }
@@ -3,27 +3,28 @@
 #pragma once
 
 /**
- * 㷨
- * R.A  S.C
+ * 连接算法
+ * 条件：R.A 连接 S.C
 */
 
-const addr_t joinResultStart = 3000;    // ӽʼŵַ
 
 // -----------------------------------------------------------
 //                       Nest Loop Join                       
 // -----------------------------------------------------------
 
 /**
- * @brief Ƕѭķб
+ * @brief 采用嵌套循环的方法进行表的连接
+ * 小表每读入一批记录，就由这批记录的A值建立Bloom过滤器
+ * 大表的记录先经过滤器筛选，一定连接不上的记录不再与这批记录逐一比较
  * 
- * @param table1 ӵĵһϢ
- * @param table2 ӵĵڶϢ
- * @return table_t ӽĴ洢Ϣ
+ * @param table1 待连接的第一个表的相关信息
+ * @param table2 待连接的第二个表的相关信息
+ * @return table_t 连接结果的存储信息表
  */
 table_t NEST_LOOP_JOIN(table_t table1, table_t table2) {
-    table_t resTable(joinResultStart), bigTable, smallTable;
+    table_t resTable(blkAllocator.allocate(1)), bigTable, smallTable;
     resTable.rowSize = 2 * sizeOfRow;
-    // С
+    // 决定大小表
     if (table1.size > table2.size) {
         bigTable = table1;
         smallTable = table2;
@@ -32,15 +33,16 @@ table_t NEST_LOOP_JOIN(table_t table1, table_t table2) {
         smallTable = table1;
     }
     addr_t bigTableAddr = bigTable.start, smallTableAddr = smallTable.start;
-    int numOfSeriesBlock = 6;                           // СʹõĻ
-    int numOfRows_1 = numOfRowInBlk * numOfSeriesBlock; // Сһζļ¼
-    int numOfRows_2 = numOfRowInBlk;                    // һζļ¼
-    int numOfRows_res = numOfRowInBlk - 1;              // еı׼¼
+    int numOfSeriesBlock = numOfBufBlock - 2;           // 小表使用的缓冲区块数，留出读大表和写结果的2块
+    int numOfRows_1 = numOfRowInBlk * numOfSeriesBlock; // 小表一次读入的记录数量
+    int numOfRows_2 = numOfRowInBlk;                    // 大表一次读入的记录数量
+    int numOfRows_res = numOfRowInBlk / 2 * 2;          // 结果表中的标准记录数量，每条结果占2条记录，不能跨块存放
     addr_t curAddr = 0;
     
-    // ʼ
-    block_t seriesBlk[numOfSeriesBlock], singleBlk, resBlk;
-    resBlk.writeInit(joinResultStart, numOfRows_res);
+    // 初始化缓冲区
+    std::vector<block_t> seriesBlk(numOfSeriesBlock);
+    block_t singleBlk, resBlk;
+    resBlk.writeInit(resTable.start, numOfRows_res);
     for (int i = 0; i < numOfSeriesBlock; ++i) {
         seriesBlk[i].loadFromDisk(smallTableAddr);
         smallTableAddr = seriesBlk[i].readNextAddr();
@@ -51,32 +53,45 @@ table_t NEST_LOOP_JOIN(table_t table1, table_t table2) {
         }
     }
 
-    row_t tSeries[numOfRows_1], tSingle[numOfRows_2];
-    int readRows_1, readRows_2;
+    std::vector<row_t> tSeries(numOfRows_1);
+    std::vector<int> A_single(numOfRows_2), candidates(numOfRows_2);
+    int readRows_1, readRows_2, numOfDropped = 0;
     while(1) {
-        // ѭǶСѭԼIO
-        // ѭСһδӴ϶ȡnumOfSeriesBlock
-        readRows_1 = read_N_Rows_From_M_Block(seriesBlk, tSeries, numOfRows_1, numOfSeriesBlock);
+        // 大表循环嵌入小表循环，可以减少IO次数
+        // 外层循环：小表一次从磁盘上读取numOfSeriesBlock块的内容
+        readRows_1 = read_N_Rows_From_M_Block(seriesBlk.data(), tSeries.data(), numOfRows_1, numOfSeriesBlock);
+        BloomFilter filter(readRows_1);
+        for (int i = 0; i < readRows_1; ++i)
+            filter.insert(tSeries[i].A);
         singleBlk.loadFromDisk(bigTableAddr);
         while(1) {
-            // ڲѭһδӴ϶ȡ1
-            readRows_2 = read_N_Rows_From_1_Block(singleBlk, tSingle, numOfRows_2);
+            // 内层循环：大表一次从磁盘上读取1块的内容
+            // 大表只解析A属性用于比较，能连接上的记录才解析出整条记录
+            readRows_2 = singleBlk.decodeColumnA(A_single.data(), numOfRows_2);
+            int numOfCandidates = 0;
+            for (int j = 0; j < readRows_2; ++j) {
+                if (filter.mayContain(A_single[j]))
+                    candidates[numOfCandidates++] = j;
+            }
+            numOfDropped += readRows_2 - numOfCandidates;
             for (int i = 0; i < readRows_1; ++i) {
-                for (int j = 0; j < readRows_2; ++j) {
-                    if (tSeries[i].join_A(tSingle[j])) {
+                int joinVal = tSeries[i].A;
+                for (int c = 0; c < numOfCandidates; ++c) {
+                    int j = candidates[c];
+                    if (A_single[j] == joinVal) {
                         curAddr = resBlk.writeRow(tSeries[i]);
-                        curAddr = resBlk.writeRow(tSingle[j]);
+                        curAddr = resBlk.writeRow(singleBlk.decodedRow(j));
                         resTable.size += 1;
                     }
                 }
             }
             if (readRows_2 < numOfRows_2) {
-                // 
+                // 大表读完了
                 break;
             }
         }
         if (readRows_1 < numOfRows_1) {
-            // С
+            // 小表读完了
             addr_t endAddr = resBlk.writeLastBlock();
             if (endAddr != END_OF_FILE)
                 curAddr = endAddr;
@@ -84,7 +99,8 @@ table_t NEST_LOOP_JOIN(table_t table1, table_t table2) {
             break;
         }
     }
-    // ս
+    printf("Bloom过滤器在内层循环前丢弃了大表中的%d条记录\n", numOfDropped);
+    // 处理空结果表
     if (resTable.size == 0)
         resTable.start = resTable.end = 0;
     return resTable;
@@ -95,16 +111,16 @@ table_t NEST_LOOP_JOIN(table_t table1, table_t table2) {
 // -----------------------------------------------------------
 
 /**
- * @brief ö·鲢ķб
+ * @brief 采用多路归并排序的方法进行表的连接
  * 
- * @param table1 ӵĵһϢ
- * @param table2 ӵĵڶϢ
- * @return table_t ӽĴ洢Ϣ
+ * @param table1 待连接的第一个表的相关信息
+ * @param table2 待连接的第二个表的相关信息
+ * @return table_t 连接结果的存储信息表
  */
 table_t SORT_MERGE_JOIN(table_t table1, table_t table2) {
-    table_t bigTable, smallTable, resTable(joinResultStart);
+    table_t bigTable, smallTable, resTable;
     resTable.rowSize = 2 * sizeOfRow;
-    // С
+    // 决定大小表
     if (table1.size > table2.size) {
         bigTable = table1;
         smallTable = table2;
@@ -112,76 +128,76 @@ table_t SORT_MERGE_JOIN(table_t table1, table_t table2) {
         bigTable = table2;
         smallTable = table1;
     }
-    // ȶһ۴
+    // 先对两表都做一遍聚簇
     useCluster(bigTable);
     addr_t smallTableAddr = useCluster(smallTable);
-    // Դ
-    addr_t indexAddr = useIndex(bigTable);
-    loadIndex(indexAddr);
+    // 对大表做索引
+    DiskBPlusTree tree(useIndex(bigTable));
 
     block_t blk1, blk2, resBlk;
-    resBlk.writeInit(resTable.start, numOfRowInBlk - 1);
+    resTable.start = blkAllocator.allocate(1);
+    resBlk.writeInit(resTable.start, numOfRowInBlk / 2 * 2);
     blk1.loadFromDisk(smallTableAddr);
 
     addr_t curAddr = 0, loadAddr;
-    row_t t1[numOfRowInBlk], t2[numOfRowInBlk], t2_copy[numOfRowInBlk];
+    std::vector<row_t> t1(numOfRowInBlk), t2(numOfRowInBlk), t2_copy(numOfRowInBlk);
     int readRows_1, readRows_2, readRows_2_copy;
     int prior_1 = MAX_ATTR_VAL;
     bool earlyDie = false;
     cursor_t cursor_2;
     while(1) {
-        readRows_1 = read_N_Rows_From_1_Block(blk1, t1, numOfRowInBlk);
+        readRows_1 = read_N_Rows_From_1_Block(blk1, t1.data(), numOfRowInBlk);
         // printRows(t1, readRows_1);
         for (int k = 0; k < readRows_1; ++k) {
             bool isSametoPrior = (t1[k].A == prior_1);
             if (!isSametoPrior) {
-                // һ¼AֵͬʱżأظشIO
-                vector<addr_t> addrList = BPTR.select(t1[k].A, EQ);
-                if (addrList.empty()) {
-                    // ûƥֱֵ¼ĺƥ乤
+                // 与上一条记录的A值不同时才加载，避免重复加载带来的IO开销
+                // 小表已聚簇，A值递增，沿B+树的叶结点向右查找即可
+                loadAddr = tree.searchAscending(t1[k].A);
+                if (loadAddr == END_OF_FILE) {
+                    // 没有匹配的值，直接跳过该条记录的后续匹配工作
                     continue;
                 }
-                loadAddr = addrList[0];
                 blk2.loadFromDisk(loadAddr);
-                earlyDie = false;   // ˲ͬȻû
+                earlyDie = false;   // 加载了不同的索引必然没有早死现象
             }
             prior_1 = t1[k].A;
             if (earlyDie) {
-                // ƥг
-                // Ҫ´Ӹü¼ĵһָĴ̿鿪ʼ
+                // 在匹配过程中出现了早死的情况
+                // 需要重新从该记录的第一条索引指向的磁盘块开始加载
                 blk2.loadFromDisk(loadAddr);
             }
             int loadBlocks = 0;
             while(1) {
-                // ؿмֵ
-                readRows_2 = read_N_Rows_From_1_Block(blk2, t2, numOfRowInBlk);
+                // 在索引加载块中检索连接值
+                readRows_2 = read_N_Rows_From_1_Block(blk2, t2.data(), numOfRowInBlk);
                 loadBlocks += 1;
                 bool joinFinish = (readRows_2 < numOfRowInBlk);
                 cursor_2 = 0;
                 if (loadBlocks > 1 && t2[0].join_A(t1[k])) {
-                    // 󲶻񣺵ش1ʱ¼ؿĵһ¼ǰļ¼(t1[k])
-                    // ˵һ鲻ȫпӵļ¼
-                    // Ҳ˵ļʱڼ֮ע⣡
+                    // 早死现象捕获：当加载次数超过1次时，若新加载块的第一条记录驱动表当前的记录(t1[k])可以连接
+                    // 说明上一块不完全包含所有可以连接的记录，即早死
+                    // 这也说明了早死的检测时序在加载之后，这点请务必注意！
                     earlyDie = true;
                 }
                 if (earlyDie || (isSametoPrior == false && loadBlocks == 1)) {
                     readRows_2_copy = readRows_2;
                     for (int i = 0; i < readRows_2_copy; ++i)
                         t2_copy[i] = t2[i];
-                    // ųһֲҪһ飨ıһεĶȡt2_copy
-                    // С()һжͬAֵļ¼ͬʱ()û
+                    // 这里排除了一种不需要加载下一块（不改变上一次的读取副本t2_copy）的特殊情况：
+                    // 小表(驱动表)在一块内有多条相同A值的记录，同时大表(被驱动表，索引表)中没有早死现象
                     // printRows(t2_copy, readRows_2_copy);
                 }
-                row_t *cmpRow = (loadBlocks == 1) ? t2_copy : t2;
+                row_t *cmpRow = (loadBlocks == 1) ? t2_copy.data() : t2.data();
                 cursor_t cmpCursor = (loadBlocks == 1) ? readRows_2_copy : readRows_2;
-                // ƶеָ뵽һƥֵλ
-                while(cmpRow[cursor_2].A != t1[k].A && cursor_2 < cmpCursor)
+                // 移动索引块中的指针到第一个匹配上连接值的位置
+                while(cursor_2 < cmpCursor && cmpRow[cursor_2].A != t1[k].A)
                     cursor_2 += 1;
                 if (cursor_2 == cmpCursor) {
                     if (joinFinish == false)
                         blk2.freeBlock();
-                    // ߽һûзļ¼
-                    cursor_2 = readRows_2_copy; // Ӳ
+                    // 边界条件，这一块中没有符合连接条件的记录
+                    cursor_2 = readRows_2_copy; // 跳过连接操作
                     joinFinish = true;
                 }
                 for (; cursor_2 < readRows_2_copy; ++cursor_2) {
@@ -207,7 +223,7 @@ table_t SORT_MERGE_JOIN(table_t table1, table_t table2) {
             break;
         }
     }
-    // ս
+    // 处理空结果表
     if (resTable.size == 0)
         resTable.start = resTable.end = 0;
     return resTable;
@@ -218,32 +234,36 @@ table_t SORT_MERGE_JOIN(table_t table1, table_t table2) {
 // -----------------------------------------------------------
 
 /**
- * @brief ɨм䲽衪Ͱ
- * ӵļ¼һͬɢֵֻӦͬͰем¼
+ * @brief 两趟扫描的中间步骤——按桶连接
+ * 可连接的记录一定具有相同的散列值，因而只需遍历两表对应编号相同的桶中的所有记录即可
  * 
- * @param numOfBuckets ɢеͰ
- * @param scan_1_index_R һÿɢͰʼַ
- * @param scan_1_index_S ڶÿɢͰʼַ
- * @param resTable ӽĴ洢Ϣ
+ * @param numOfBuckets 散列的桶的数量
+ * @param scan_1_index_R 第一个表每个散列桶的起始地址
+ * @param scan_1_index_S 第二个表每个散列桶的起始地址
+ * @param resTable 连接结果的存储信息表
  */
 void scan_2_HashJoin(int numOfBuckets, addr_t scan_1_index_R[], addr_t scan_1_index_S[], table_t &resTable) {
     addr_t curAddr = 0;
     int numOfRows = numOfRowInBlk * (numOfBuckets / 2);
-    row_t R_data[numOfRows], S_data[numOfRows];
+    std::vector<row_t> R_data(numOfRows), S_data(numOfRows);
     block_t blk1, blk2, resBlk;
-    resBlk.writeInit(resTable.start, numOfRowInBlk - 1);
+    resBlk.writeInit(resTable.start, numOfRowInBlk / 2 * 2);
 
     for (int k = 0; k < numOfBuckets; ++k) {
+        if (scan_1_index_R[k] == END_OF_FILE || scan_1_index_S[k] == END_OF_FILE) {
+            // 有一方的桶为空，这个桶中的记录都连接不上
+            continue;
+        }
         blk1.loadFromDisk(scan_1_index_R[k]);
         int readRows_R, readRows_S;
         while(1) {
-            readRows_R = read_N_Rows_From_1_Block(blk1, R_data, numOfRows);
-            insertSort<row_t>(R_data, readRows_R);
+            readRows_R = read_N_Rows_From_1_Block(blk1, R_data.data(), numOfRows);
+            sortRows(R_data.data(), readRows_R);
             blk2.loadFromDisk(scan_1_index_S[k]);
             // printRows(R_data, readRows_R);
             while(1) {
-                readRows_S = read_N_Rows_From_1_Block(blk2, S_data, numOfRows);
-                insertSort<row_t>(S_data, readRows_S);
+                readRows_S = read_N_Rows_From_1_Block(blk2, S_data.data(), numOfRows);
+                sortRows(S_data.data(), readRows_S);
                 // printRows(S_data, readRows_S);
                 for (int i = 0; i < readRows_R; ++i) {
                     for (int j = 0; j < readRows_S; ++j) {
@@ -265,45 +285,59 @@ void scan_2_HashJoin(int numOfBuckets, addr_t scan_1_index_R[], addr_t scan_1_in
                 break;
         }
         blk1.freeBlock();
-        if (k == numOfBuckets - 1) {
-            addr_t endAddr = resBlk.writeLastBlock();
-            if (endAddr != END_OF_FILE)
-                curAddr = endAddr;
-            resTable.end = curAddr;
-        }
     }
-    // ս
+    addr_t endAddr = resBlk.writeLastBlock();
+    if (endAddr != END_OF_FILE)
+        curAddr = endAddr;
+    resTable.end = curAddr;
+    // 处理空结果表
     if (resTable.size == 0)
         resTable.start = resTable.end = 0;
 }
 
 
 /**
- * @brief ɢеķб
+ * @brief 采用散列的方法进行表的连接
+ * 先散列小表，同时由小表的A值建立Bloom过滤器；再散列大表，A值不在过滤器中的记录不写入任何桶
  * 
- * @param table1 ӵĵһϢ
- * @param table2 ӵĵڶϢ
- * @return table_t ӽĴ洢Ϣ
+ * @param table1 待连接的第一个表的相关信息
+ * @param table2 待连接的第二个表的相关信息
+ * @return table_t 连接结果的存储信息表
  */
 table_t HASH_JOIN(table_t table1, table_t table2) {
-    /******************* һɨ *******************/
-    int numOfBuckets = 6;   // ɢͰ֤ȡǰֵʱIOС
-    addr_t scan_1_Index_R[7] = {5300, 5400, 5500, 5600, 5700, 5800, 5900};
-    addr_t scan_1_Index_S[7] = {6300, 6400, 6500, 6600, 6700, 6800, 6900};
-    // ԱRзɢ
-    scan_1_HashToBucket(numOfBuckets, table1.start, scan_1_Index_R);
-    // ԱSзɢ
-    scan_1_HashToBucket(numOfBuckets, table2.start, scan_1_Index_S);
+    /******************* 一趟扫描 *******************/
+    // 散列桶的数量，在试验中证明留出2块用于读表时IO数量最小
+    // 每个桶按平均分到的记录数申请区段，数据倾斜时写满后自动扩展
+    int numOfBuckets = numOfBufBlock - 2;
+    std::vector<addr_t> scan_1_Index_R(numOfBuckets), scan_1_Index_S(numOfBuckets);
+    for (int i = 0; i < numOfBuckets; ++i) {
+        scan_1_Index_R[i] = blkAllocator.allocate(ceil(1.0 * table1.size / numOfBuckets / numOfRowInBlk));
+        scan_1_Index_S[i] = blkAllocator.allocate(ceil(1.0 * table2.size / numOfBuckets / numOfRowInBlk));
+    }
+    // 先对小表进行分组散列并建立过滤器，再用过滤器筛选大表
+    bool isTable1Small = table1.size <= table2.size;
+    BloomFilter filter(isTable1Small ? table1.size : table2.size);
+    int numOfDropped;
+    if (isTable1Small) {
+        scan_1_HashToBucket(numOfBuckets, table1.start, scan_1_Index_R.data(), &filter);
+        numOfDropped = scan_1_HashToBucket(numOfBuckets, table2.start, scan_1_Index_S.data(), NULL, &filter);
+    } else {
+        scan_1_HashToBucket(numOfBuckets, table2.start, scan_1_Index_S.data(), &filter);
+        numOfDropped = scan_1_HashToBucket(numOfBuckets, table1.start, scan_1_Index_R.data(), NULL, &filter);
+    }
+    printf("Bloom过滤器在写入散列桶前丢弃了大表中的%d条记录\n", numOfDropped);
 
-    /******************* ɨ *******************/
-    table_t resTable(joinResultStart);
+    /******************* 二趟扫描 *******************/
+    table_t resTable(blkAllocator.allocate(1));
     resTable.rowSize = 2 * sizeOfRow;
-    scan_2_HashJoin(numOfBuckets, scan_1_Index_R, scan_1_Index_S, resTable);
+    scan_2_HashJoin(numOfBuckets, scan_1_Index_R.data(), scan_1_Index_S.data(), resTable);
     for (int i = 0; i < numOfBuckets; ++i) {
-        DropFiles(scan_1_Index_R[i]);
-        DropFiles(scan_1_Index_S[i]);
+        if (scan_1_Index_R[i] != END_OF_FILE)
+            DropFiles(scan_1_Index_R[i]);
+        if (scan_1_Index_S[i] != END_OF_FILE)
+            DropFiles(scan_1_Index_S[i]);
     }
-    // ս
+    // 处理空结果表
     if (resTable.size == 0)
         resTable.start = resTable.end = 0;
     return resTable;
@@ -322,8 +356,8 @@ table_t HASH_JOIN(table_t table1, table_t table2) {
 //     }
 //     showResult(joinResultStart, 2 * sizeOfRow);
 //     int numOfUsedBlocks = ceil(1.0 * res.size / (numOfRowInBlk / 2));
-//     printf("\nעд̿ţ3000-%d\n", res.start + numOfUsedBlocks - 1);
-//     printf("\nι%ldI/O\n", buff.numIO);
+//     printf("\n注：结果写入磁盘块序号：3000-%d\n", res.start + numOfUsedBlocks - 1);
+//     printf("\n本次共发生%ld次I/O\n", buff.numIO);
 //     system("pause");
 //     return OK;
 // }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "utils.cpp"
 #include "index.cpp"
+#include "catalog.cpp"
 #include "distinct.cpp"
 #include "condQuery.cpp"
 #include "project.cpp"
@@ -8,57 +9,68 @@
 
 
 /**
- * @brief ڱζдеϢ
+ * @brief 输出操作结果表在本次读写中的相关信息
  * 
- * @param table Ϣ
+ * @param table 操作结果表的信息
  */
 void print_IO_Info(table_t table) {
     if (table.start)
-        printf("\nעд̿飺%d-%d\n", table.start, table.end);
-    printf("ι%ldI/O\n\n", buff.numIO);
+        printf("\n注：结果写入磁盘块：%d-%d\n", table.start, table.end);
+    printf("本次共发生%ld次I/O\n", buff.numIO);
+    printf("(其中缓冲池命中%ld次，实际读写磁盘%ld次)\n\n", buff.numHit, buff.numPhysIO);
     system("pause");
 }
 
 
 /**
- * @brief ɾresָļ
+ * @brief 删除res表指向的文件
+ * 申请了起始块却没有写入结果时，只需把起始块归还给地址分配器
  * 
- * @param res ɾıϢ
+ * @param res 待删除的表的信息
  */
-void dropResultTable(table_t res) {
+void dropResultTable(table_t &res) {
     if (res.start && res.size)
         DropFiles(res.start);
-    res.size = 0;
+    else if (res.start)
+        blkAllocator.dropFile(res.start);
+    res.start = res.end = res.size = 0;
 }
 
 
-int main() {
-    bufferInit();
+int main(int argc, char *argv[]) {
+    bufferInit(argc, argv);
+    useFileFormat(table_R.start);   // 中间结果和结果表沿用R表的块格式
+    if (!loadCatalog())
+        reserveBaseTables();        // 结果表和中间结果不能占用R、S表的块
+    clear_Buff_IO_Count();
+    // 目录中已有聚簇文件时直接使用，不再重新聚簇
     useCluster(table_R);
     useCluster(table_S);
+    saveCatalog();
     int select;
-    table_t condQueryTable(condQueryStart);
-    table_t projectTable(projStart);
+    // 结果表的起始块在每次操作前向地址分配器申请
+    table_t condQueryTable;
+    table_t projectTable;
     projectTable.rowSize = sizeOfRow / 2;
-    table_t joinTable(joinResultStart);
+    table_t joinTable;
     joinTable.rowSize = 2 * sizeOfRow;
-    table_t setOperationTable(setOperationResultStart);
+    table_t setOperationTable;
 
     while(1) {
         system("cls");
-        printf("뿴ĸʾأ\n\n");
+        printf("您想看哪个功能演示呢？\n\n");
         printf("====================================\n");
-        printf("0. ˳\n");
-        printf("1. \n");
-        printf("2. ͶӰ\n");
-        printf("3. \n");
-        printf("4. ϲ\n");
+        printf("0. 退出\n");
+        printf("1. 检索\n");
+        printf("2. 投影\n");
+        printf("3. 连接\n");
+        printf("4. 集合操作\n");
         printf("====================================\n\n");
-        printf("ѡ");
+        printf("请给出您的选择：");
         cin >> select;
 
         if (select == 0) {
-            printf("\n˳ʾ...\n\n");
+            printf("\n退出演示...\n\n");
             break;
         }
         switch(select) {
@@ -70,33 +82,45 @@ int main() {
                     char tableName;
                     table_t table;
                     int val;
-                    printf("뿴ּʽʾأ\n\n");
+                    printf("您想看哪种检索方式的演示呢？\n\n");
                     printf("====================================\n");
-                    printf("0. صһ\n");
-                    printf("1. Լ\n");
-                    printf("2. ּ\n");
-                    printf("3. \n");
+                    printf("0. 回到上一级\n");
+                    printf("1. 线性检索\n");
+                    printf("2. 二分检索\n");
+                    printf("3. 索引检索\n");
+                    printf("4. 二级索引检索(按第二个属性或两个属性的组合)\n");
+                    printf("5. 散列索引检索\n");
+                    printf("6. 位图索引检索(A IN (...) AND B IN (...))\n");
+                    printf("7. 借助zone map的范围检索(low <= A <= high)\n");
                     printf("====================================\n\n");
-                    printf("ѡ");
+                    printf("请给出您的选择：");
                     cin >> select;
 
                     if (select == 0)
                         break;
-                    else if (select < 0 || select > 3){
-                        printf("0-3ѡŶ~\n");
+                    else if (select < 0 || select > 7){
+                        printf("不可以做出0-7以外的选择哦~\n");
                         system("pause");
                         continue;
                     }
 
                     system("cls");
                     if (select == 1)
-                        printf("1. Լ\n");
+                        printf("1. 线性检索\n");
                     else if (select == 2)
-                        printf("2. ּ\n");
+                        printf("2. 二分检索\n");
                     else if (select == 3)
-                        printf("3. \n");
+                        printf("3. 索引检索\n");
+                    else if (select == 4)
+                        printf("4. 二级索引检索\n");
+                    else if (select == 5)
+                        printf("5. 散列索引检索\n");
+                    else if (select == 6)
+                        printf("6. 位图索引检索\n");
+                    else if (select == 7)
+                        printf("7. 借助zone map的范围检索\n");
                     
-                    printf("\n뿴RS(RS)\n");
+                    printf("\n您想看R表还是S表？(输入R或S)\n");
                     cin >> tableName;
                     if (tableName == 'R') {
                         table = table_R;
@@ -105,16 +129,58 @@ int main() {
                         table = table_S;
                         // val = 60;
                     } else {
-                        printf("RSκζ~\n");
+                        printf("不可以输入R或S以外的任何东西噢~\n");
                         system("pause");
                         continue;
                     }
-                    printf("ֵ");
-                    cin >> val;
+                    INDEX_KEY keyType = KEY_B;
+                    int high;
+                    std::vector<int> valuesA, valuesB;
+                    if (select == 6) {
+                        // 先输入取值个数，再依次输入各个取值，B的取值个数为0时不对B做限制
+                        int numOfValues;
+                        printf("请输入A的取值个数及各个取值(用空格隔开)：");
+                        cin >> numOfValues;
+                        valuesA.resize(std::max(numOfValues, 0));
+                        for (int &value : valuesA)
+                            cin >> value;
+                        printf("请输入B的取值个数及各个取值(个数为0时不限制B)：");
+                        cin >> numOfValues;
+                        valuesB.resize(std::max(numOfValues, 0));
+                        for (int &value : valuesB)
+                            cin >> value;
+                    } else if (select == 4) {
+                        int keySelect, valB;
+                        printf("按哪个字段检索？(1. 第二个属性  2. 两个属性的组合)\n");
+                        cin >> keySelect;
+                        if (keySelect == 1) {
+                            printf("请输入第二个属性的查找值：");
+                            cin >> val;
+                        } else if (keySelect == 2) {
+                            keyType = KEY_AB;
+                            printf("请输入两个属性的查找值(用空格隔开)：");
+                            cin >> val >> valB;
+                            if (!isCompositeKeyValid(val, valB)) {
+                                printf("两个属性的查找值都要在0-%d之间哦~\n", MAX_ATTR_VAL - 1);
+                                system("pause");
+                                continue;
+                            }
+                            val = compositeKey(val, valB);
+                        } else {
+                            printf("不可以做出1-2以外的选择哦~\n");
+                            system("pause");
+                            continue;
+                        }
+                    } else if (select == 7) {
+                        printf("请输入A的下界和上界(用空格隔开)：");
+                        cin >> val >> high;
+                    } else {
+                        printf("请输入查找值：");
+                        cin >> val;
+                    }
 
                     dropResultTable(condQueryTable);
-                    condQueryTable.start = condQueryStart;
-                    condQueryTable.size = 0;
+                    condQueryTable.start = blkAllocator.allocate(1);
                     clear_Buff_IO_Count();
                     if (select == 1) {
                         linearQuery(table, condQueryTable, val, EQ_cond);
@@ -127,29 +193,45 @@ int main() {
                     } else if (select == 3) {
                         searchByIndex_and_Show(table, condQueryTable, val);
                         system("pause");
+                    } else if (select == 4) {
+                        searchBySecondaryIndex_and_Show(table, condQueryTable, keyType, val, val);
+                        system("pause");
+                    } else if (select == 5) {
+                        hashIndexQuery(table, condQueryTable, val);
+                        showResult(condQueryTable);
+                        print_IO_Info(condQueryTable);
+                    } else if (select == 6) {
+                        bitmapIndexQuery(table, condQueryTable, valuesA, valuesB);
+                        showResult(condQueryTable);
+                        print_IO_Info(condQueryTable);
+                    } else if (select == 7) {
+                        zoneMapQuery(table, condQueryTable, val, high);
+                        showResult(condQueryTable);
+                        print_IO_Info(condQueryTable);
                     }
                 };
                 break;
             } case 2: {
                 char tableName;
                 system("cls");
-                printf("ڹƣֻΪͶӰĵһ\n\n");
+                printf("由于功能限制，我们只能为您投影表的第一个属性\n\n");
                 do {
-                    printf("ͶӰĸĵһأ(RS)\n");
+                    printf("您想投影哪个表的第一个属性呢？(R或S)\n");
                     cin >> tableName;
                     dropResultTable(projectTable);
+                    projectTable.start = blkAllocator.allocate(1);
                     if (tableName == 'R') {
-                        printf("ΪͶӰRĵһԣ\n");
+                        printf("将为您投影R的第一个属性：\n");
                         project(table_R, projectTable);
                         showResult(projectTable);
                         print_IO_Info(projectTable);
                     } else if (tableName == 'S') {
-                        printf("ΪͶӰSĵһԣ\n");
+                        printf("将为您投影S的第一个属性：\n");
                         project(table_S, projectTable);
                         showResult(projectTable);
                         print_IO_Info(projectTable);
                     } else {
-                        printf("RSѡŶ~\n");
+                        printf("不可以有R表或S表以外的选择哦~\n");
                         system("pause");
                     }
                     system("cls");
@@ -158,14 +240,14 @@ int main() {
             } case 3: {
                 while(1) {
                     system("cls");
-                    printf("뿴ӷʽʾأ\n\n");
+                    printf("您想看哪种连接方式的演示呢？\n\n");
                     printf("====================================\n");
-                    printf("0. صһ\n");
-                    printf("1. Ƕѭ(NEST-LOOP JOIN)\n");
-                    printf("2. 鲢(SORT-MERGE JOIN)\n");
-                    printf("3. ɢ(HASH JOIN)\n");
+                    printf("0. 回到上一级\n");
+                    printf("1. 嵌套循环连接(NEST-LOOP JOIN)\n");
+                    printf("2. 排序归并连接(SORT-MERGE JOIN)\n");
+                    printf("3. 散列连接(HASH JOIN)\n");
                     printf("====================================\n\n");
-                    printf("ѡ");
+                    printf("请给出您的选择：");
                     cin >> select;
 
                     system("cls");
@@ -173,20 +255,18 @@ int main() {
                     if (select == 0)
                         break;
 
-                    dropResultTable(joinTable);
-                    joinTable.start = joinResultStart;
-                    joinTable.size = 0;
+                    dropResultTable(joinTable);  // 连接结果表的起始块由连接操作自行申请
                     if (select == 1) {
-                        printf("鿴Ƕѭ(NEST-LOOP JOIN)Ľ\n");
+                        printf("查看嵌套循环连接(NEST-LOOP JOIN)的结果：\n");
                         joinTable = NEST_LOOP_JOIN(table_R, table_S);
                     } else if (select == 2) {
-                        printf("鿴鲢(SORT-MERGE JOIN)Ľ\n");
+                        printf("查看排序归并连接(SORT-MERGE JOIN)的结果：\n");
                         joinTable = SORT_MERGE_JOIN(table_R, table_S);
                     } else if (select == 3) {
-                        printf("鿴ɢ(HASH JOIN)Ľ\n");
+                        printf("查看散列连接(HASH JOIN)的结果：\n");
                         joinTable = HASH_JOIN(table_R, table_S);
                     } else {
-                        printf("0-3ѡŶ~\n");
+                        printf("不可以做出0-3以外的选择哦~\n");
                         system("pause");
                         continue;
                     }
@@ -197,14 +277,14 @@ int main() {
             } case 4: {
                 while(1) {
                     system("cls");
-                    printf("뿴ּϲʾأ\n\n");
+                    printf("您想看哪种集合操作的演示呢？\n\n");
                     printf("====================================\n");
-                    printf("0. صһ\n");
-                    printf("1. \n");
-                    printf("2. \n");
-                    printf("3. \n");
+                    printf("0. 回到上一级\n");
+                    printf("1. 并\n");
+                    printf("2. 交\n");
+                    printf("3. 差\n");
                     printf("====================================\n\n");
-                    printf("ѡ");
+                    printf("请给出您的选择：");
                     cin >> select;
 
                     system("cls");
@@ -213,33 +293,32 @@ int main() {
                         break;
 
                     dropResultTable(setOperationTable);
-                    setOperationTable.start = setOperationResultStart;
-                    setOperationTable.size = 0;
+                    setOperationTable.start = blkAllocator.allocate(1);
                     if (select == 1) {
-                        printf("鿴RSĽ\n");
+                        printf("查看R∪S的结果：\n");
                         tablesUnion(table_R, table_S, setOperationTable);
                     } else if (select == 2) {
-                        printf("鿴RSĽ\n");
+                        printf("查看R∩S的结果：\n");
                         tablesIntersect(table_R, table_S, setOperationTable);
                     } else if (select == 3) {
                         char diffedTable, diffTable;
                         table_t table1, table2;
-                        printf("ĸĸĲأ(R SS R)\n");
+                        printf("您想做哪个表对哪个表的差呢？(输入R S或S R)\n");
                         cin >> diffedTable >> diffTable;
                         if (diffedTable == 'R' && diffTable == 'S') {
-                            printf("鿴R-SĽ\n");
+                            printf("查看R-S的结果：\n");
                             table1 = table_R, table2 = table_S;
                         } else if (diffedTable == 'S' && diffTable == 'R') {
-                            printf("鿴S-RĽ\n");
+                            printf("查看S-R的结果：\n");
                             table1 = table_S, table2 = table_R;
                         } else {
-                            printf("\"R S\"Լ\"S R\"붼ǲŶ~\n");
+                            printf("\"R S\"以及\"S R\"以外的输入都是不允许的哦~\n");
                             system("pause");
                             continue;
                         }
                         tablesDiff(table1, table2, setOperationTable);
                     } else {
-                        printf("0-3ѡŶ~\n");
+                        printf("不可以做出0-3以外的选择哦~\n");
                         system("pause");
                         continue;
                     }
@@ -248,7 +327,7 @@ int main() {
                 }
                 break;
             } default: {
-                printf("0-4ѡŶ~\n");
+                printf("不可以做出0-4以外的选择哦~\n");
                 system("pause");
                 break;
             }
@@ -258,18 +337,8 @@ int main() {
     dropResultTable(projectTable);
     dropResultTable(joinTable);
     dropResultTable(setOperationTable);
-    // ۴
-    for (auto iter = clusterTableMap.begin(); iter != clusterTableMap.end(); ++iter) {
-        index_t addrItem = iter->second;
-        addr_t clusterAddr = addrItem.A;
-        DropFiles(clusterAddr);
-    }
-    // 
-    for (auto iter = indexTableMap.begin(); iter != indexTableMap.end(); ++iter) {
-        index_t addrItem = iter->second;
-        addr_t indexAddr = addrItem.A;
-        DropFiles(indexAddr);
-    }
+    // 聚簇文件和索引文件保留在磁盘上，记入目录供下次启动时使用
+    saveCatalog();
     system("pause");
     return OK;
 }
\ No newline at end of file
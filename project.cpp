@@ -3,43 +3,46 @@
 
 
 /**
- * @brief ͶӰ
- * ͶӰRеķA
+ * @brief 投影操作
+ * 投影R表中的非主码A属性
  */
 
-const addr_t projStart = 2000;  // ͶӰʵŵַ
 
 
 /**
- * @brief ͶӰ
- * Ӷȡıгȡÿһ¼Aд
+ * @brief 投影
+ * 从读取的表中抽取每一条记录的A属性写入结果
+ * 投影只用到A属性，因此读表时只解析A属性
  * 
- * @param projTable ͶӰϢ
- * @param resTable ͶӰϢ
+ * @param projTable 待投影表的信息
+ * @param resTable 投影结果表的信息
  */
 void project(table_t projTable, table_t &resTable) {
     block_t blk, resBlk;
-    row_t t_read, t_write;
+    row_t t_write;
     addr_t curAddr = 0;
+    std::vector<int> A(numOfRowInBlk);
+    int readRows;
+    bool isHalfFilled = false;  // 结果记录是否只写入了一个A属性
     blk.loadFromDisk(projTable.start);
     resBlk.writeInit(resTable.start);
-    bool isLastRow = false;
-    while(1) {
-        t_read = blk.getNewRow();
-        if(t_read.isFilled == false) {
-            addr_t endAddr = resBlk.writeLastBlock();
-            if (endAddr != END_OF_FILE)
-                curAddr = endAddr;
-            break;
-        }
-        t_write.A = t_read.A;
-        t_read = blk.getNewRow();
-        if(t_read.isFilled == false) {
-            t_write.B = MAX_ATTR_VAL;
-            isLastRow = true;
-        } else {
-            t_write.B = t_read.A;
+    while((readRows = blk.decodeColumnA(A.data(), numOfRowInBlk)) > 0) {
+        // 每两个A属性拼成一条结果记录
+        for (int i = 0; i < readRows; ++i) {
+            if (!isHalfFilled) {
+                t_write.A = A[i];
+                isHalfFilled = true;
+            } else {
+                t_write.B = A[i];
+                resBlk.writeRow(t_write);
+                resTable.size += 1;
+                isHalfFilled = false;
+            }
         }
+    }
+    blk.freeBlock();
+    if (isHalfFilled) {
+        t_write.B = MAX_ATTR_VAL;
         resBlk.writeRow(t_write);
         resTable.size += 1;
     }
@@ -56,8 +59,8 @@ void project(table_t projTable, table_t &resTable) {
 //     table_t projRes(projStart);
 //     project(table_R, projStart);
 //     showResult(projStart, sizeOfRow / 2);
-//     printf("\nעд̿飺%d-%d\n", projRes.start, projRes.end);
-//     printf("ι%ldI/O\n", buff.numIO);
+//     printf("\n注：结果写入磁盘块：%d-%d\n", projRes.start, projRes.end);
+//     printf("本次共发生%ld次I/O\n", buff.numIO);
 //     system("pause");
 //     return OK;
 // }
\ No newline at end of file
@@ -3,9 +3,10 @@
 #include <numeric>
 #include <vector>
 #include "utils.cpp"
+#include "catalog.cpp"
 
 
-// A, B, C, DĸֶεȡֵΧ
+// A, B, C, D四个字段的取值范围
 const int A_LOW = 1,  A_HIGH = 40;
 const int B_LOW = 1,  B_HIGH = 1000;
 const int C_LOW = 20, C_HIGH = 60;
@@ -16,10 +17,10 @@ std::vector<row_t> overlaps;
 
 
 /**
- * @brief һд뵽
+ * @brief 随机生成一个表的数据写入到磁盘中
  * 
- * @param table ϢʼַַԼ¼ͳȵ
- * @param range ÿԵɷΧȡֵ
+ * @param table 表的信息，包括起始地址、结束地址以及记录数量和长度等
+ * @param range 每个属性的生成范围取值
  */
 void generateANDwrite(table_t table, int range[][2]) {
     Block blk;
@@ -27,7 +28,7 @@ void generateANDwrite(table_t table, int range[][2]) {
     row_t r, emptyRow;
     addr_t curAddr = 0;
     for (int i = 0, count = 0; i < table.size;) {
-        // 7¼blk
+        // 生成7条记录，存入blk中
         for (int j = 0; j < numOfRowInBlk && i < table.size; ++i, ++j) {
             int prob = rand() % 101;
             if (prob < threshold && count <= maxOverlaps) {
@@ -40,19 +41,20 @@ void generateANDwrite(table_t table, int range[][2]) {
             if (i == table.size - 1) {
                 if (count == 101)
                     count -= 1;
-                printf("ʹظ¼м¼%d\n", count);
+                printf("使用了重复记录集中记录的数量：%d\n", count);
             }
         }
     }
     curAddr = blk.writeLastBlock();
     table.end = curAddr;
-    printf("дɣд̿飺%d-%d\n\n", table.start, table.end);
+    printf("写入完成！结果写入磁盘块：%d-%d\n\n", table.start, table.end);
 }
 
 /**************************** main ****************************/
-int main() {
-    bufferInit();
-    // ظ¼
+int main(int argc, char *argv[]) {
+    bufferInit(argc, argv);
+    dropCatalog();  // 重新生成R、S表后，原来的聚簇和索引都已失效
+    // 生成重复记录集
     row_t t;
     srand(time(NULL));
     for (int i = 0; i < maxOverlaps; ++i) {
@@ -60,13 +62,13 @@ int main() {
         t.B = rand() % (B_HIGH - B_LOW) + B_LOW;
         overlaps.push_back(t);
     }
-    // ɲͬļ¼
+    // 生成不同表的记录
     srand(time(NULL));
     int R_range[2][2] = {{A_LOW, A_HIGH}, {B_LOW, B_HIGH}};
     int S_range[2][2] = {{C_LOW, C_HIGH}, {D_LOW, D_HIGH}};
-    printf("\n=================== Rļ¼ ===================\n");
+    printf("\n=================== 生成R表的记录 ===================\n");
     generateANDwrite(table_R, R_range);
-    printf("\n=================== Sļ¼ ===================\n");
+    printf("\n=================== 生成S表的记录 ===================\n");
     generateANDwrite(table_S, S_range);
     system("pause");
     return OK;
@@ -0,0 +1,33 @@
+#include "utils.cpp"
+
+
+/**
+ * @brief 段文件打包工具
+ * 将data目录下一块一个文件的data/%d.blk打包进段文件data/segment_%d.dat中
+ * 每个块存放在段文件中 (addr % SEGMENT_NUM_BLK) * blkSize 的偏移处
+ * 打包完成后，bufferInit会自动改用段文件进行读写，原有的.blk文件不再被使用
+ */
+
+const addr_t maxPackAddr = SEGMENT_NUM_BLK * MAX_NUM_SEGMENT - 1;   // 打包的最大块地址
+
+
+/**************************** main ****************************/
+int main(int argc, char *argv[]) {
+    bufferInit(argc, argv);
+    if (isSegmentStoreOpen()) {
+        printf("段文件已存在，无需重复打包！\n");
+        system("pause");
+        return OK;
+    }
+    printf("开始将data/*.blk打包进段文件...\n");
+    int numOfPacked = packBlocksToSegment(maxPackAddr, buff.blkSize);
+    if (numOfPacked < 0) {
+        printf("打包失败！\n");
+        system("pause");
+        return FAIL;
+    }
+    closeSegmentStore();
+    printf("打包完成！共打包%d个磁盘块\n", numOfPacked);
+    system("pause");
+    return OK;
+}
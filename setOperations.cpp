@@ -3,16 +3,15 @@
 #pragma once
 
 
-const addr_t setOperationResultStart = 4000;    // ϲʼŵַ
 
 
 /**
- * @brief Ľ
- * Ƕѭķļ¼
+ * @brief 表的交操作
+ * 采用嵌套循环的方法检索符合条件的记录
  * 
- * @param table1 һϢ
- * @param table2 ڶϢ
- * @param resTable Ϣ
+ * @param table1 第一个表的相关信息
+ * @param table2 第二个表的相关信息
+ * @param resTable 交操作结果存放区域的信息表
  */
 void tablesIntersect(table_t table1, table_t table2, table_t &resTable) {
     table_t bigTable, smallTable;
@@ -23,26 +22,34 @@ void tablesIntersect(table_t table1, table_t table2, table_t &resTable) {
         bigTable = table2;
         smallTable = table1;
     }
-    int numOfSeriesBlk = 6;
+    int numOfSeriesBlk = numOfBufBlock - 2;     // 留出读大表和写结果的2块
     int numOfRows_1 = numOfRowInBlk * numOfSeriesBlk, numOfRows_2 = numOfRowInBlk;
     addr_t readAddr_1 = smallTable.start, readAddr_2 = bigTable.start;
     addr_t curAddr = 0, resAddr = resTable.start;
     
-    block_t seriesBlk[numOfSeriesBlk], singleBlk, resBlk;
-    for (int i = 0; i < numOfSeriesBlk; ++i)
-        seriesBlk[i].loadFromDisk(readAddr_1++);
+    std::vector<block_t> seriesBlk(numOfSeriesBlk);
+    block_t singleBlk, resBlk;
+    for (int i = 0; i < numOfSeriesBlk; ++i) {
+        seriesBlk[i].loadFromDisk(readAddr_1);
+        readAddr_1 = seriesBlk[i].readNextAddr();
+        if (readAddr_1 == END_OF_FILE) {
+            numOfSeriesBlk = i + 1;
+            numOfRows_1 = numOfRowInBlk * numOfSeriesBlk;
+            break;
+        }
+    }
     resBlk.writeInit(resAddr);
-    row_t t1[numOfRows_1], t2[numOfRows_2];
+    std::vector<row_t> t1(numOfRows_1), t2(numOfRows_2);
 
     int readRows_1, readRows_2;
     while(1) {
-        // ÿδСж6
-        readRows_1 = read_N_Rows_From_M_Block(seriesBlk, t1, numOfRows_1, numOfSeriesBlk);
+        // 每次从小表中读入numOfSeriesBlk块
+        readRows_1 = read_N_Rows_From_M_Block(seriesBlk.data(), t1.data(), numOfRows_1, numOfSeriesBlk);
         // printRows(t, readRows, val);
         singleBlk.loadFromDisk(readAddr_2);
         while(1) {
-            // ÿδӴж1бȽ
-            readRows_2 = read_N_Rows_From_1_Block(singleBlk, t2, numOfRows_2);
+            // 每次从大表中读入1块进行比较
+            readRows_2 = read_N_Rows_From_1_Block(singleBlk, t2.data(), numOfRows_2);
             for (int i = 0; i < readRows_1; ++i) {
                 for (int j = 0; j < readRows_2; ++j) {
                     if (t1[i] == t2[j]) {
@@ -62,44 +69,52 @@ void tablesIntersect(table_t table1, table_t table2, table_t &resTable) {
             break;
         }
     }
-    // ս
+    // 处理空结果表
     if (resTable.size == 0)
         resTable.start = resTable.end = 0;
 }
 
 
 /**
- * @brief Ĳ
- * Ƕѭķļ¼
+ * @brief 表的差操作
+ * 采用嵌套循环的方法检索符合条件的记录
  * 
- * @param diffedTable Ϣ
- * @param diffTable Ϣ
- * @param resTable Ϣ
+ * @param diffedTable 被差表的相关信息
+ * @param diffTable 差表的相关信息
+ * @param resTable 差操作结果存放区域的信息表
  */
 void tablesDiff(table_t diffedTable, table_t diffTable, table_t &resTable) {
-    int numOfSeriesBlock = 6;
+    int numOfSeriesBlock = numOfBufBlock - 2;   // 留出读差表和写结果的2块
     int numOfRows_1 = numOfRowInBlk * numOfSeriesBlock, numOfRows_2 = numOfRowInBlk;
     addr_t diffedTableAddr = diffedTable.start, diffTableAddr = diffTable.start;
     addr_t curAddr = 0;
     
-    block_t seriesBlk[numOfSeriesBlock], singleBlk, resBlk;
+    std::vector<block_t> seriesBlk(numOfSeriesBlock);
+    block_t singleBlk, resBlk;
     resBlk.writeInit(resTable.start);
-    for (int i = 0; i < numOfSeriesBlock; ++i)
-        seriesBlk[i].loadFromDisk(diffedTableAddr++);
-    row_t tDiffed[numOfRows_1], tDiff[numOfRows_2];
+    for (int i = 0; i < numOfSeriesBlock; ++i) {
+        seriesBlk[i].loadFromDisk(diffedTableAddr);
+        diffedTableAddr = seriesBlk[i].readNextAddr();
+        if (diffedTableAddr == END_OF_FILE) {
+            numOfSeriesBlock = i + 1;
+            numOfRows_1 = numOfRowInBlk * numOfSeriesBlock;
+            break;
+        }
+    }
+    std::vector<row_t> tDiffed(numOfRows_1), tDiff(numOfRows_2);
 
     int readRows_1, readRows_2;
     while(1) {
-        // ÿδӴж6
-        readRows_1 = read_N_Rows_From_M_Block(seriesBlk, tDiffed, numOfRows_1, numOfSeriesBlock);
-        // insertSort<row_t>(tDiffed, readRows_1);
+        // 每次从大表中读入numOfSeriesBlock块
+        readRows_1 = read_N_Rows_From_M_Block(seriesBlk.data(), tDiffed.data(), numOfRows_1, numOfSeriesBlock);
+        // sortRows(tDiffed, readRows_1);
         // printRows(tDiffed, readRows_1);
         for (int i = 0; i < readRows_1; ++i) {
             bool isAppeared = false;
             singleBlk.loadFromDisk(diffTableAddr);
             while(1) {
-                // ÿδСж1бȽ
-                readRows_2 = read_N_Rows_From_1_Block(singleBlk, tDiff, numOfRows_2);
+                // 每次从小表中读入1块进行比较
+                readRows_2 = read_N_Rows_From_1_Block(singleBlk, tDiff.data(), numOfRows_2);
                 for (int j = 0; j < readRows_2; ++j) {
                     if (tDiff[j] == tDiffed[i]) {
                         isAppeared = true;
@@ -107,20 +122,20 @@ void tablesDiff(table_t diffedTable, table_t diffTable, table_t &resTable) {
                     }
                 }
                 if (readRows_2 < numOfRows_2 || isAppeared) {
-                    // ˻ڱһļ¼ֹͣ
+                    // 被差表读完了或者在被差表中遇到了一样的记录，就停止遍历
                     if (isAppeared)
                         singleBlk.freeBlock();
                     break;
                 }
             }
-            // ڲûзָñеļ¼˵ü¼ǲĽ
+            // 如果在差表中没有发现该被差表中的记录，则说明该记录是差操作的结果
             if (!isAppeared) {
                 curAddr = resBlk.writeRow(tDiffed[i]);
                 resTable.size += 1;
             }
         }
         if (readRows_1 < numOfRows_1) {
-            // 
+            // 大表读完了
             addr_t endAddr = resBlk.writeLastBlock();
             if (endAddr != END_OF_FILE)
                 curAddr = endAddr;
@@ -128,22 +143,22 @@ void tablesDiff(table_t diffedTable, table_t diffTable, table_t &resTable) {
             break;
         }
     }
-    // ս
+    // 处理空结果表
     if (resTable.size == 0)
         resTable.start = resTable.end = 0;
 }
 
 
 /**
- * @brief Ĳ
+ * @brief 表的并操作
  * 
- * @param table1 һϢ
- * @param table2 ڶϢ
- * @param resTable Ϣ
+ * @param table1 第一个表的相关信息
+ * @param table2 第二个表的相关信息
+ * @param resTable 并操作结果存放区域的信息表
  */
 void tablesUnion(table_t table1, table_t table2, table_t &resTable) {
     table_t bigTable, smallTable;
-    table_t diffTable(6000);
+    table_t diffTable(blkAllocator.allocate(1));  // 小表对大表的差，作为临时文件
     if (table1.size > table2.size) {
         bigTable = table1;
         smallTable = table2;
@@ -186,8 +201,8 @@ void tablesUnion(table_t table1, table_t table2, table_t &resTable) {
 //     // table_t res = tablesDiff(table_S, table_R, res);
 //     showResult(res.start);
 //     int numOfUsedBlocks = ceil(1.0 * res.size / (numOfRowInBlk));
-//     printf("\nעдʼ̿飺4000-%d\n", res.start + numOfUsedBlocks - 1);
-//     printf("ι%ldI/O\n\n", buff.numIO);
+//     printf("\n注：结果写入起始磁盘块：4000-%d\n", res.start + numOfUsedBlocks - 1);
+//     printf("本次共发生%ld次I/O\n\n", buff.numIO);
 
 //     system("pause");
 //     return OK;
@@ -0,0 +1,104 @@
+#include <chrono>
+#include <cstdlib>
+#include "utils.cpp"
+
+/**
+ * @brief 内排序核心算法的微基准测试
+ * 对不同批量的随机记录，分别用插入排序、排序网络、pdqSortBy、基数排序、pdqSort和std::sort按A属性排序
+ * 最后一列sortRows是按批量自动选择的结果
+ * 输出每条记录平均耗时(纳秒)，并检查稳定的算法与插入排序的结果是否完全一致
+ * 批量取一块、一个缓冲区以及若干个缓冲区所能容纳的记录数
+ */
+
+typedef void (*sort_kernel_t)(row_t array[], int size);
+
+void kernelInsert(row_t array[], int size) { insertSort<row_t>(array, size); }
+void kernelNetwork(row_t array[], int size) { networkSortBy(array, size, [](const row_t &R) { return R.A; }); }
+void kernelPdqBy(row_t array[], int size) { pdqSortBy(array, size, [](const row_t &R) { return R.A; }); }
+void kernelRadix(row_t array[], int size) { radixSortBy(array, size, [](const row_t &R) { return R.A; }); }
+void kernelPdq(row_t array[], int size) { pdqSort(array, array + size, [](const row_t &x, const row_t &y) { return x.A < y.A; }); }
+void kernelStd(row_t array[], int size) { std::sort(array, array + size, [](const row_t &x, const row_t &y) { return x.A < y.A; }); }
+void kernelRows(row_t array[], int size) { sortRows(array, size); }
+
+
+/**
+ * @brief 生成size条随机记录，A属性取自[0, domain)
+ */
+std::vector<row_t> randomRows(int size, int domain) {
+    std::vector<row_t> rows(size);
+    for (int i = 0; i < size; ++i) {
+        rows[i].isFilled = true;
+        rows[i].A = rand() % domain, rows[i].B = i;
+    }
+    return rows;
+}
+
+
+/**
+ * @brief 用kernel反复排序同一组记录的副本，返回每条记录平均耗时(纳秒)
+ */
+double timeKernel(sort_kernel_t kernel, const std::vector<row_t> &rows, int rounds) {
+    std::vector<row_t> work(rows.size());
+    auto begin = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        std::copy(rows.begin(), rows.end(), work.begin());
+        kernel(work.data(), work.size());
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - begin).count() / rounds / rows.size();
+}
+
+
+/**
+ * @brief 检查kernel的结果是否与插入排序的结果expect一致；stable为false时只检查A属性是否有序
+ */
+bool checkKernel(sort_kernel_t kernel, const std::vector<row_t> &rows, const std::vector<row_t> &expect, bool stable) {
+    std::vector<row_t> result(rows);
+    kernel(result.data(), result.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (result[i].A != expect[i].A || (stable && result[i].B != expect[i].B))
+            return false;
+    }
+    return true;
+}
+
+
+int main() {
+    const char *names[] = {"insertSort", "network", "pdqSortBy", "radix", "pdqSort", "std::sort", "sortRows"};
+    sort_kernel_t kernels[] = {kernelInsert, kernelNetwork, kernelPdqBy, kernelRadix, kernelPdq, kernelStd, kernelRows};
+    const bool stable[] = {true, true, true, true, false, false, true};
+    const int numOfKernels = sizeof(kernels) / sizeof(kernels[0]);
+    const int domains[] = {40, MAX_ATTR_VAL};   // R、S表A属性的取值范围，以及属性的全部取值范围
+    const int sizes[] = {8, 16, numOfRowInBlk * numOfBufBlock, 128, 256, 512, 1024, 4096, 16384};
+    srand(2024);
+
+    for (int domain : domains) {
+        printf("A属性取自[0, %d)，每条记录平均耗时(纳秒)：\n", domain);
+        printf("%8s", "批量");
+        for (int k = 0; k < numOfKernels; ++k)
+            printf("%12s", names[k]);
+        printf("\n");
+        for (int size : sizes) {
+            std::vector<row_t> rows = randomRows(size, domain), expect(rows);
+            insertSort<row_t>(expect.data(), expect.size());
+            int rounds = std::max(1, (1 << 22) / size / (size > 1024 ? 16 : 1));
+            printf("%8d", size);
+            for (int k = 0; k < numOfKernels; ++k) {
+                bool isInsertTooSlow = (kernels[k] == kernelInsert && size > 4096);
+                if ((kernels[k] == kernelNetwork && size > SORT_NETWORK_MAX) || isInsertTooSlow) {
+                    printf("%12s", "-");
+                    continue;
+                }
+                if (!checkKernel(kernels[k], rows, expect, stable[k])) {
+                    printf("\n错误：%s的排序结果不正确！\n", names[k]);
+                    return FAIL;
+                }
+                printf("%12.2f", timeKernel(kernels[k], rows, rounds));
+            }
+            printf("\n");
+        }
+        printf("\n");
+    }
+    system("pause");
+    return OK;
+}
@@ -0,0 +1,410 @@
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Block/Block.h"
+#pragma once
+
+/**
+ * @brief 内排序的核心算法
+ * 
+ * 外排序每趟都要把缓冲区中的一批记录在内存中排好序，原来一律用插入排序，批量一大就成为CPU上的瓶颈
+ * 这里按数据的特点提供三种核心算法：
+ *   networkSortBy - 小批量(不超过SORT_NETWORK_MAX条)用排序网络，比较交换没有分支
+ *   radixSortBy   - 排序字段是有界整数时用LSD基数排序，与批量大小成线性关系
+ *   pdqSort       - 一般的比较函数用pattern-defeating quicksort
+ * 前两种是稳定的，排序字段相同的记录保持原来的先后顺序，与插入排序的结果完全一致
+ * pdqSort本身不稳定，pdqSortBy把原下标拼进排序键后再排序，也是稳定的
+ * 记录按A属性排序时统一调用sortRows，由stableSortBy按批量大小选择核心算法
+ */
+
+const int SORT_NETWORK_MAX = 16;    // 排序网络能处理的最大批量
+const int RADIX_BITS = 8;           // 基数排序每趟处理的位数
+const int RADIX_SIZE = 1 << RADIX_BITS;
+const int RADIX_PASSES = 32 / RADIX_BITS;
+const int RADIX_SORT_MIN = 256;     // 批量不小于该值时基数排序才比比较排序快
+
+
+/**
+ * @brief 32位有符号整数对应的无符号排序码，翻转符号位后按无符号数比较的结果与原数相同
+ */
+inline uint32_t sortCode(int key) { return (uint32_t)key ^ 0x80000000U; }
+
+
+/**
+ * @brief 宽度为width(2的幂)的Batcher奇偶归并排序网络的比较器序列，每项为一对下标
+ * 第一次用到某个宽度时生成，之后直接复用
+ */
+const std::vector<std::pair<int, int>> &sortNetworkOf(int width) {
+    static std::vector<std::pair<int, int>> networks[SORT_NETWORK_MAX + 1];
+    std::vector<std::pair<int, int>> &network = networks[width];
+    if (!network.empty())
+        return network;
+    for (int p = 1; p < width; p <<= 1) {
+        for (int k = p; k >= 1; k >>= 1) {
+            for (int j = k % p; j + k < width; j += 2 * k) {
+                for (int i = 0; i < k && i + j + k < width; ++i) {
+                    if ((i + j) / (2 * p) == (i + j + k) / (2 * p))
+                        network.push_back(std::make_pair(i + j, i + j + k));
+                }
+            }
+        }
+    }
+    return network;
+}
+
+
+/**
+ * @brief 用排序网络对不超过SORT_NETWORK_MAX个64位数升序排序，比较交换没有分支
+ * 
+ * @param keys 待排序的数
+ * @param size 数的个数
+ */
+void sortNetwork(uint64_t keys[], int size) {
+    if (size < 2)
+        return;
+    // 网络的宽度取不小于size的2的幂，多出来的位置用最大值填充，排序后留在末尾
+    int width = 2;
+    while (width < size)
+        width <<= 1;
+    for (int i = size; i < width; ++i)
+        keys[i] = UINT64_MAX;
+    for (const std::pair<int, int> &cmp : sortNetworkOf(width)) {
+        uint64_t x = keys[cmp.first], y = keys[cmp.second];
+        keys[cmp.first] = std::min(x, y);
+        keys[cmp.second] = std::max(x, y);
+    }
+}
+
+
+/**
+ * @brief 元素的排序键：高32位是排序码，低32位是元素的原下标
+ * 拼上原下标后不会有相等的排序键，按排序键排序的结果是稳定的
+ */
+inline uint64_t packedKey(int key, int index) { return (uint64_t)sortCode(key) << 32 | (uint32_t)index; }
+
+
+/**
+ * @brief 按排序字段稳定排序小批量的元素
+ * 把每个元素的排序键用排序网络排序后，再按排序键中的原下标重排元素
+ * 
+ * @tparam T 元素的类型
+ * @tparam KeyOf 取排序字段的函数，返回int
+ * @param array 待排序的数组
+ * @param size 数组的大小，不超过SORT_NETWORK_MAX
+ * @param keyOf 取排序字段的函数
+ */
+template <typename T, typename KeyOf>
+void networkSortBy(T array[], int size, KeyOf keyOf) {
+    if (size < 2)
+        return;
+    uint64_t keys[SORT_NETWORK_MAX];
+    for (int i = 0; i < size; ++i)
+        keys[i] = packedKey(keyOf(array[i]), i);
+    sortNetwork(keys, size);
+    T sorted[SORT_NETWORK_MAX];
+    for (int i = 0; i < size; ++i)
+        sorted[i] = array[(uint32_t)keys[i]];
+    std::copy(sorted, sorted + size, array);
+}
+
+
+/**
+ * @brief 按排序字段对数组做LSD基数排序，结果是稳定的
+ * 一次遍历统计出每一趟各个桶的大小；某一趟所有元素落在同一个桶中时跳过这一趟
+ * 属性值都小于MAX_ATTR_VAL时只有低两个字节需要分配，实际只做两趟
+ * 
+ * @tparam T 元素的类型
+ * @tparam KeyOf 取排序字段的函数，返回int
+ * @param array 待排序的数组
+ * @param size 数组的大小
+ * @param keyOf 取排序字段的函数
+ */
+template <typename T, typename KeyOf>
+void radixSortBy(T array[], int size, KeyOf keyOf) {
+    if (size < 2)
+        return;
+    int count[RADIX_PASSES][RADIX_SIZE] = {};
+    for (int i = 0; i < size; ++i) {
+        uint32_t code = sortCode(keyOf(array[i]));
+        for (int pass = 0; pass < RADIX_PASSES; ++pass)
+            count[pass][(code >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)] += 1;
+    }
+    std::vector<T> buffer(size);
+    T *src = array, *dst = buffer.data();
+    for (int pass = 0; pass < RADIX_PASSES; ++pass) {
+        int *bucket = count[pass];
+        int shift = pass * RADIX_BITS;
+        if (bucket[(sortCode(keyOf(src[0])) >> shift) & (RADIX_SIZE - 1)] == size)
+            continue;   // 所有元素这一趟都落在同一个桶中
+        // 各桶的大小换算为各桶的起始下标
+        int start = 0;
+        for (int d = 0; d < RADIX_SIZE; ++d) {
+            int numInBucket = bucket[d];
+            bucket[d] = start;
+            start += numInBucket;
+        }
+        for (int i = 0; i < size; ++i)
+            dst[bucket[(sortCode(keyOf(src[i])) >> shift) & (RADIX_SIZE - 1)]++] = src[i];
+        std::swap(src, dst);
+    }
+    if (src != array)
+        std::copy(src, src + size, array);
+}
+
+
+const int PDQ_INSERTION_MAX = 24;   // 不超过该大小的区间直接插入排序
+const int PDQ_NINTHER_MIN = 128;    // 超过该大小的区间用九数取中法选主元
+const int PDQ_PARTIAL_LIMIT = 8;    // 区间看起来已有序时，尝试插入排序最多允许移动的元素数
+
+/**
+ * @brief 插入排序[begin, end)，用于pdqSort的小区间
+ */
+template <typename T, typename Compare>
+void pdqInsertionSort(T *begin, T *end, Compare comp) {
+    for (T *cur = begin + 1; cur < end; ++cur) {
+        T tmp = std::move(*cur);
+        T *sift = cur;
+        for (; sift > begin && comp(tmp, *(sift - 1)); --sift)
+            *sift = std::move(*(sift - 1));
+        *sift = std::move(tmp);
+    }
+}
+
+/**
+ * @brief 尝试插入排序[begin, end)，移动的元素超过PDQ_PARTIAL_LIMIT个时放弃
+ * 
+ * @return bool 区间是否已排好序
+ */
+template <typename T, typename Compare>
+bool pdqPartialInsertionSort(T *begin, T *end, Compare comp) {
+    int numOfMoved = 0;
+    for (T *cur = begin + 1; cur < end; ++cur) {
+        if (!comp(*cur, *(cur - 1)))
+            continue;
+        T tmp = std::move(*cur);
+        T *sift = cur;
+        for (; sift > begin && comp(tmp, *(sift - 1)); --sift)
+            *sift = std::move(*(sift - 1));
+        *sift = std::move(tmp);
+        numOfMoved += cur - sift;
+        if (numOfMoved > PDQ_PARTIAL_LIMIT)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 将三个位置上的元素排好序
+ */
+template <typename T, typename Compare>
+void pdqSort3(T *a, T *b, T *c, Compare comp) {
+    if (comp(*b, *a))
+        std::iter_swap(a, b);
+    if (comp(*c, *b))
+        std::iter_swap(b, c);
+    if (comp(*b, *a))
+        std::iter_swap(a, b);
+}
+
+/**
+ * @brief 以*begin为主元划分[begin, end)，小于主元的在左，不小于主元的在右
+ * 调用前须保证区间中有不小于主元的元素作为右侧的哨兵
+ * 
+ * @return std::pair<T *, bool> 主元的最终位置，以及划分前区间是否已经是划分好的
+ */
+template <typename T, typename Compare>
+std::pair<T *, bool> pdqPartitionRight(T *begin, T *end, Compare comp) {
+    T pivot = std::move(*begin);
+    T *first = begin, *last = end;
+    while (comp(*++first, pivot));
+    if (first - 1 == begin) {
+        while (first < last && !comp(*--last, pivot));
+    } else {
+        while (!comp(*--last, pivot));
+    }
+    bool isPartitioned = first >= last;
+    while (first < last) {
+        std::iter_swap(first, last);
+        while (comp(*++first, pivot));
+        while (!comp(*--last, pivot));
+    }
+    T *pivotPos = first - 1;
+    *begin = std::move(*pivotPos);
+    *pivotPos = std::move(pivot);
+    return std::make_pair(pivotPos, isPartitioned);
+}
+
+/**
+ * @brief 以*begin为主元划分[begin, end)，与主元相等的元素都留在左边
+ * 主元与区间左侧的元素相等时调用，之后左边整段都等于主元，不必再排序
+ * 
+ * @return T* 主元的最终位置
+ */
+template <typename T, typename Compare>
+T *pdqPartitionLeft(T *begin, T *end, Compare comp) {
+    T pivot = std::move(*begin);
+    T *first = begin, *last = end;
+    while (comp(pivot, *--last));
+    if (last + 1 == end) {
+        while (first < last && !comp(pivot, *++first));
+    } else {
+        while (!comp(pivot, *++first));
+    }
+    while (first < last) {
+        std::iter_swap(first, last);
+        while (comp(pivot, *--last));
+        while (!comp(pivot, *++first));
+    }
+    T *pivotPos = last;
+    *begin = std::move(*pivotPos);
+    *pivotPos = std::move(pivot);
+    return pivotPos;
+}
+
+/**
+ * @brief pdqSort的主循环，对左半区间递归，对右半区间循环
+ * 
+ * @param badAllowed 还允许出现的严重不均衡划分次数，用完后改用堆排序，保证最坏O(nlogn)
+ * @param isLeftmost 区间是否位于整个数组的最左端，否则区间左侧的元素不大于区间中的所有元素
+ */
+template <typename T, typename Compare>
+void pdqLoop(T *begin, T *end, Compare comp, int badAllowed, bool isLeftmost) {
+    while (1) {
+        int size = end - begin;
+        if (size <= PDQ_INSERTION_MAX) {
+            pdqInsertionSort(begin, end, comp);
+            return;
+        }
+        // 选主元并放到begin处
+        int half = size / 2;
+        if (size > PDQ_NINTHER_MIN) {
+            pdqSort3(begin, begin + half, end - 1, comp);
+            pdqSort3(begin + 1, begin + half - 1, end - 2, comp);
+            pdqSort3(begin + 2, begin + half + 1, end - 3, comp);
+            pdqSort3(begin + half - 1, begin + half, begin + half + 1, comp);
+            std::iter_swap(begin, begin + half);
+        } else {
+            pdqSort3(begin + half, begin, end - 1, comp);
+        }
+        // 主元与左侧的元素相等，说明有大量重复值，把等于主元的元素一次分出去
+        if (!isLeftmost && !comp(*(begin - 1), *begin)) {
+            begin = pdqPartitionLeft(begin, end, comp) + 1;
+            continue;
+        }
+        std::pair<T *, bool> part = pdqPartitionRight(begin, end, comp);
+        T *pivotPos = part.first;
+        int leftSize = pivotPos - begin, rightSize = end - (pivotPos + 1);
+        if (leftSize < size / 8 || rightSize < size / 8) {
+            // 严重不均衡的划分，打乱几个元素破坏可能导致退化的输入模式
+            if (--badAllowed == 0) {
+                std::make_heap(begin, end, comp);
+                std::sort_heap(begin, end, comp);
+                return;
+            }
+            if (leftSize >= PDQ_INSERTION_MAX) {
+                std::iter_swap(begin, begin + leftSize / 4);
+                std::iter_swap(pivotPos - 1, pivotPos - leftSize / 4);
+            }
+            if (rightSize >= PDQ_INSERTION_MAX) {
+                std::iter_swap(pivotPos + 1, pivotPos + 1 + rightSize / 4);
+                std::iter_swap(end - 1, end - rightSize / 4);
+            }
+        } else if (part.second && pdqPartialInsertionSort(begin, pivotPos, comp)
+            && pdqPartialInsertionSort(pivotPos + 1, end, comp)) {
+            // 划分前就已是划分好的，两边也几乎有序，直接结束
+            return;
+        }
+        pdqLoop(begin, pivotPos, comp, badAllowed, isLeftmost);
+        begin = pivotPos + 1;
+        isLeftmost = false;
+    }
+}
+
+/**
+ * @brief 按比较函数对[first, last)排序，结果不稳定
+ * 对有序、逆序和大量重复值的输入都接近线性，最坏情况为O(nlogn)
+ * 
+ * @tparam T 元素的类型
+ * @tparam Compare 比较函数，comp(x, y)表示x应排在y之前
+ * @param first 待排序区间的首元素
+ * @param last 待排序区间的尾后位置
+ * @param comp 比较函数
+ */
+template <typename T, typename Compare>
+void pdqSort(T *first, T *last, Compare comp) {
+    int size = last - first;
+    if (size < 2)
+        return;
+    int log2Size = 0;
+    while (size >>= 1)
+        log2Size += 1;
+    pdqLoop(first, last, comp, log2Size, true);
+}
+
+
+/**
+ * @brief 按排序字段稳定排序，用pdqSort排序每个元素的排序键后再按原下标重排元素
+ * 批量不大时基数排序清零计数、逐个桶换算下标的固定开销占了大头，这时用它
+ * 
+ * @tparam T 元素的类型
+ * @tparam KeyOf 取排序字段的函数，返回int
+ * @param array 待排序的数组
+ * @param size 数组的大小
+ * @param keyOf 取排序字段的函数
+ */
+template <typename T, typename KeyOf>
+void pdqSortBy(T array[], int size, KeyOf keyOf) {
+    if (size < 2)
+        return;
+    std::vector<uint64_t> keys(size);
+    for (int i = 0; i < size; ++i)
+        keys[i] = packedKey(keyOf(array[i]), i);
+    pdqSort(keys.data(), keys.data() + size, [](uint64_t x, uint64_t y) { return x < y; });
+    std::vector<T> sorted(size);
+    for (int i = 0; i < size; ++i)
+        sorted[i] = array[(uint32_t)keys[i]];
+    std::copy(sorted.begin(), sorted.end(), array);
+}
+
+
+/**
+ * @brief 按排序字段稳定排序，按批量大小选择核心算法，阈值由sortBench.cpp测得
+ * 不超过SORT_NETWORK_MAX用排序网络，小于RADIX_SORT_MIN用pdqSortBy，其余用基数排序
+ * 
+ * @tparam T 元素的类型
+ * @tparam KeyOf 取排序字段的函数，返回int
+ * @param array 待排序的数组
+ * @param size 数组的大小
+ * @param keyOf 取排序字段的函数
+ */
+template <typename T, typename KeyOf>
+void stableSortBy(T array[], int size, KeyOf keyOf) {
+    if (size <= SORT_NETWORK_MAX)
+        networkSortBy(array, size, keyOf);
+    else if (size < RADIX_SORT_MIN)
+        pdqSortBy(array, size, keyOf);
+    else
+        radixSortBy(array, size, keyOf);
+}
+
+
+/**
+ * @brief 按A属性稳定排序一组记录，取代原来的insertSort<row_t>，结果与插入排序完全一致
+ * 
+ * @param array 待排序的记录
+ * @param size 记录的数量
+ */
+void sortRows(row_t array[], int size) {
+    stableSortBy(array, size, [](const row_t &R) { return R.A; });
+}
+
+
+/**
+ * @brief 对一组整数(如行号)升序排序
+ * 
+ * @param array 待排序的整数
+ */
+void sortInts(std::vector<int> &array) {
+    stableSortBy(array.data(), array.size(), [](int x) { return x; });
+}
@@ -0,0 +1,44 @@
+#include "utils.cpp"
+
+/**
+ * @brief 检查文件的所有块都登记在该文件名下，且文件的区段恰好覆盖整条块链
+ * 
+ * @param fileStartAddr 文件的起始地址块
+ * @return bool 地址分配器中的文件表是否正确
+ */
+bool checkExtents(addr_t fileStartAddr) {
+    int numOfBlocks = 0;
+    addr_t next = fileStartAddr;
+    block_t readBlk;
+    while (next != END_OF_FILE) {
+        if (blkAllocator.fileOf(next) != fileStartAddr)
+            return false;
+        readBlk.loadFromDisk(next);
+        next = readBlk.readNextAddr();
+        readBlk.freeBlock();
+        numOfBlocks += 1;
+    }
+    int numOfExtentBlocks = 0;
+    for (const auto &extent : blkAllocator.extentsOf(fileStartAddr))
+        numOfExtentBlocks += extent.second - extent.first + 1;
+    return numOfExtentBlocks == numOfBlocks;
+}
+
+int main(int argc, char *argv[]) {
+    bufferInit(argc, argv);
+    // 不预先登记R、S表，由convertFileFormat在转换时登记
+    const table_t tables[] = {table_R, table_S};
+    for (const table_t &table : tables) {
+        blkFormat_t origin = detectFileFormat(table.start);
+        blkFormat_t format = (origin == BLK_FORMAT_BINARY) ? BLK_FORMAT_ASCII : BLK_FORMAT_BINARY;
+        int numOfConverted = convertFileFormat(table.start, format);
+        bool isOK = checkExtents(table.start);
+        convertFileFormat(table.start, origin);     // 转换回原来的格式
+        isOK = isOK && checkExtents(table.start);
+        printf("起始地址为%u的表：转换%d个磁盘块，区段%s\n", table.start, numOfConverted, isOK ? "正确" : "错误");
+        if (!isOK)
+            return FAIL;
+    }
+    system("pause");
+    return OK;
+}
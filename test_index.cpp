@@ -1,20 +1,34 @@
 #include "index.cpp"
 
-int main() {
-    bufferInit();
+int main(int argc, char *argv[]) {
+    bufferInit(argc, argv);
+    useFileFormat(R_start);
+    reserveBaseTables();
     table_t R = {R_start, R_size};
-    addr_t clusterStartAddr = addrOfScan_2;
-    tableClustering(R, clusterStartAddr);
-    printf("ʼ\n");
-    buildIndex(clusterStartAddr, index_start);
-    printf("ʼ\n");
-    loadIndex(index_start);
-    printf("\nҵ40");
-    vector<tree_data_t> a = BPTR.select(40, EQ);
-    for (auto iter = a.begin(); iter != a.end(); ++iter) {
-        tree_data_t d = *iter;
-        cout << d << " ";
-    }
+    addr_t clusterStartAddr = tableClustering(R);
+    printf("开始建立索引\n");
+    addr_t indexStartAddr = blkAllocator.allocate(1);
+    DiskBPlusTree tree(buildIndex(clusterStartAddr, indexStartAddr));
+    printf("\n查找等于40的索引：");
+    addr_t a = tree.search(40);
+    if (a != END_OF_FILE)
+        cout << a;
+    cout << endl;
+    printf("开始加载索引\n");
+    BPlusTree<int> memTree;
+    loadIndex(indexStartAddr, memTree);
+    printf("\n在内存中的B+树上查找等于40的索引：");
+    BPlusTree<int>::Cursor cursor = memTree.seek(40);
+    if (cursor.isValid() && cursor.key() == 40)
+        cout << cursor.data();
+    cout << endl;
+    printf("开始建立B上的二级索引\n");
+    DiskBPlusTree secondaryTree(buildSecondaryIndex(R, KEY_B, blkAllocator.allocate(1)));
+    printf("\n查找B等于468的记录所在的(块地址, 序号)：");
+    std::vector<index_t> entries;
+    secondaryTree.scan(468, 468, entries);
+    for (const index_t &entry : entries)
+        printf("(%d, %d) ", rowIdAddr(entry.B), rowIdSlot(entry.B));
     cout << endl;
     system("pause");
     return 0;
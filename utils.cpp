@@ -1,24 +1,78 @@
+#include <cstdint>
 #include <cmath>
 #include <numeric>
+#include <vector>
 #include "Block/Block.h"
 #include "Block/Block.cpp"
+#include "sortKernels.cpp"
 #pragma once
 
-const addr_t  R_start = 1;			// Rַ1ʼ
-const addr_t  S_start = 20;		    // Sַ20ʼ
-const addr_t  R_end = 16;           // RһַΪ16
-const addr_t  S_end = 51;           // SһַΪ51
-const int     R_size = 112;         // Rϵļ¼
-const int     S_size = 224;         // Sϵļ¼
+const addr_t  R_start = 1;			// 磁盘中R地址从1开始
+const addr_t  S_start = 20;		    // 磁盘中S地址从20开始
+const addr_t  R_end = 16;           // 磁盘中R的最后一块地址为16
+const addr_t  S_end = 51;           // 磁盘中S的最后一块地址为51
+const int     R_size = 112;         // R关系的记录总数
+const int     S_size = 224;         // S关系的记录总数
 const table_t table_R(R_start, R_size, R_end);
 const table_t table_S(S_start, S_size, S_end);
 
 
 /**
- * @brief 
- * Ϣ˳
+ * @brief 在地址分配器中登记R、S两张表占用的块，之后申请的区段不会覆盖它们
+ */
+void reserveBaseTables() {
+    reserveFile(table_R.start);
+    reserveFile(table_S.start);
+}
+
+
+/**
+ * @brief 按v2格式写出的索引文件的每块记录数
+ * 组合字段值、行号和块地址都可能超出ASCII格式能表示的范围，二级索引、散列索引和zone map等文件一律按v2格式写出
+ * v2块的容量只由块的大小决定，不受v4格式调大的numOfRowInBlk影响
+ * 
+ * @return int 每块的记录数
+ */
+int numOfRowInRowIdBlk() { return (sizeOfBlock - sizeOfBlkHeader) / sizeOfRow; }
+
+
+/**
+ * @brief 块的zone map：文件中每块的地址、记录数以及属性A的最小值和最大值
+ * 扫描时由此判断一块中是否可能有符合条件的记录，不可能时整块跳过
+ */
+typedef struct ZoneEntry {
+    addr_t addr;
+    int numOfRows;
+    int minA, maxA;
+} zone_entry_t;
+
+typedef std::vector<zone_entry_t> zone_map_t;
+
+
+/**
+ * @brief 把写入或读出的一条记录计入它所在块的zone map项，记录须按块的顺序依次计入
  * 
- * @param err Ϣַ
+ * @param zones 文件的zone map
+ * @param addr 记录所在块的地址
+ * @param A 记录的A属性
+ */
+void addToZoneMap(zone_map_t &zones, addr_t addr, int A) {
+    if (zones.empty() || zones.back().addr != addr) {
+        zones.push_back({addr, 1, A, A});
+        return;
+    }
+    zone_entry_t &zone = zones.back();
+    zone.numOfRows += 1;
+    zone.minA = std::min(zone.minA, A);
+    zone.maxA = std::max(zone.maxA, A);
+}
+
+
+/**
+ * @brief 错误处理
+ * 输出错误信息并退出
+ * 
+ * @param err 错误信息字符串
  */
 void error(char *err) {
     printf("%s\n", err);
@@ -28,21 +82,127 @@ void error(char *err) {
 
 
 /**
- * @brief ¼Aֵֶɢ
+ * @brief 按记录的A字段值进行散列
  * 
- * @param R ɢеļ¼
- * @param numOfBuckets ɢͰ
- * @return int ü¼ɢнͰıţ
+ * @param R 待散列的记录
+ * @param numOfBuckets 散列桶的数量
+ * @return int 该记录的散列结果（所归属桶的编号）
  */
 int hashRowsByA(row_t R, int numOfBuckets) { return R.A % numOfBuckets; }
 
+
+/**
+ * @brief 字段值的散列函数，散列值的每一位都分布均匀
+ * 这里用MurmurHash3的收尾混合函数
+ * 
+ * @param key 字段值
+ * @return uint32_t 散列值
+ */
+uint32_t hashKey(int key) {
+    uint32_t h = (uint32_t)key;
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
+    return h;
+}
+
+
+/**
+ * @brief 分块的Bloom过滤器
+ * 位数组划分为与缓存行一样大的小块，一个字段值只落在一个小块中，在小块的每个字里各置一位
+ * 因此插入和查询都只访问一个缓存行
+ * 连接时先由小表的A值建立过滤器，大表中过滤器判定不在小表中的记录一定连接不上，直接丢弃
+ */
+class BloomFilter {
+public:
+    static const int WORDS_PER_BLOCK = 8;   // 每个小块的字数，8个64位字恰好占一个64字节的缓存行
+    static const int BITS_PER_KEY = 16;     // 每个字段值分到的位数，假阳性率约千分之一
+
+    explicit BloomFilter(int numOfKeys);
+    void insert(int key);
+    bool mayContain(int key) const;
+
+private:
+    std::vector<uint64_t> m_Words;
+    size_t m_Offset;            // 第一个小块在m_Words中的下标，使小块与缓存行对齐
+    uint32_t m_NumOfBlocks;
+    const uint64_t *_block(uint32_t h) const;
+    static uint64_t _mask(uint32_t h, int i);
+};
+
+
 /**
- * @brief argminʵ
+ * @brief 按字段值的个数决定小块数，多申请一个小块的空间用于对齐
  * 
- * @tparam T t
- * @param t argmin
- * @param size ĴС
- * @return int tСֵ±
+ * @param numOfKeys 将要插入的字段值的个数，可以是其上界
+ */
+BloomFilter::BloomFilter(int numOfKeys) {
+    int numOfBits = std::max(numOfKeys, 1) * BITS_PER_KEY;
+    m_NumOfBlocks = (numOfBits + WORDS_PER_BLOCK * 64 - 1) / (WORDS_PER_BLOCK * 64);
+    m_Words.assign((m_NumOfBlocks + 1) * WORDS_PER_BLOCK, 0);
+    uintptr_t misalign = (uintptr_t)m_Words.data() % (WORDS_PER_BLOCK * sizeof(uint64_t));
+    m_Offset = misalign ? (WORDS_PER_BLOCK * sizeof(uint64_t) - misalign) / sizeof(uint64_t) : 0;
+}
+
+
+/**
+ * @brief 散列值h所在的小块，由h的高位决定
+ */
+const uint64_t *BloomFilter::_block(uint32_t h) const {
+    return m_Words.data() + m_Offset + ((uint64_t)h * m_NumOfBlocks >> 32) * WORDS_PER_BLOCK;
+}
+
+
+/**
+ * @brief 散列值h在小块第i个字中所置的位，每个字用不同的奇数乘以h，取乘积的高6位
+ */
+uint64_t BloomFilter::_mask(uint32_t h, int i) {
+    static const uint32_t SALT[WORDS_PER_BLOCK] = {
+        0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+        0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+    };
+    return 1ULL << ((h * SALT[i]) >> 26);
+}
+
+
+/**
+ * @brief 将字段值key加入过滤器
+ */
+void BloomFilter::insert(int key) {
+    uint32_t h = hashKey(key);
+    uint64_t *block = const_cast<uint64_t *>(_block(h));
+    uint32_t h2 = hashKey(h);   // 选小块用的是h的高位，小块内的位由另一个散列值决定
+    for (int i = 0; i < WORDS_PER_BLOCK; ++i)
+        block[i] |= _mask(h2, i);
+}
+
+
+/**
+ * @brief 判断字段值key是否可能在过滤器中
+ * 
+ * @return false key一定不在过滤器中
+ * @return true key可能在过滤器中
+ */
+bool BloomFilter::mayContain(int key) const {
+    uint32_t h = hashKey(key);
+    const uint64_t *block = _block(h);
+    uint32_t h2 = hashKey(h);
+    for (int i = 0; i < WORDS_PER_BLOCK; ++i) {
+        if (!(block[i] & _mask(h2, i)))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief argmin的实现
+ * 
+ * @tparam T t数组的类型
+ * @param t 待argmin的数组
+ * @param size 数组的大小
+ * @return int 数组t中最小值的下标
  */
 template <typename T>
 int argmin(T t[], int size) {
@@ -56,11 +216,11 @@ int argmin(T t[], int size) {
 
 
 /**
- * @brief 
+ * @brief 插入排序
  * 
- * @tparam T array
- * @param array 
- * @param size  ĴС
+ * @tparam T array数组的类型
+ * @param array 待排序的数组
+ * @param size  待排序数组的大小
  */
 template <typename T>
 void insertSort(T array[], int size) {
@@ -76,11 +236,11 @@ void insertSort(T array[], int size) {
 
 
 /**
- * @brief һ¼ÿһ¼
+ * @brief 对于一组记录，输出每一条记录的内容
  * 
- * @param t Ҫļ¼
- * @param size ¼
- * @param matchVal ƥֵֶͨʾƥļ¼
+ * @param t 需要输出的记录组
+ * @param size 记录的数量
+ * @param matchVal 匹配值，通过该字段在输出中显示匹配的记录
  */
 void printRows(row_t t[], int size, int matchVal = -1) {
     for (int i = 0; i < size; ++i) {
@@ -94,32 +254,32 @@ void printRows(row_t t[], int size, int matchVal = -1) {
 
 
 /**
- * @brief ̿дŵ
+ * @brief 输出结果磁盘块中存放的内容
  * 
- * @param resTable Ϣ
+ * @param resTable 结果表的信息
  */
 void showResult(table_t resTable) {
     float timesToStandartRow = 1.0 * resTable.rowSize / sizeOfRow;
     int numOfRows = floor(numOfRowInBlk / timesToStandartRow);
     int numOfStandardRows = timesToStandartRow * numOfRows;
-    // һЩõĲ
+    // 下面是一些输出结果中用到的参数
     bool rowStart, rowEnd, timesSmallerThanOne = (timesToStandartRow < 1);
     char delim = (timesSmallerThanOne) ? '\n' : '\t';
     int base = (timesSmallerThanOne) ? 1 : (int)timesToStandartRow;
     int curRows = 0;
     if (resTable.start == 0) {
-        printf("\n------------  ------------\n");
-        printf("\n          ҽڣ\n\n");
+        printf("\n------------ 输出结果 ------------\n");
+        printf("\n          查找结果不存在！\n\n");
     } else {
         block_t readBlk;
         readBlk.loadFromDisk(resTable.start, sizeOfRow * numOfStandardRows);
-        row_t t[numOfStandardRows];
+        std::vector<row_t> t(numOfStandardRows);
         int readRows, count = 0;
-        printf("\n------------  ------------\n");
+        printf("\n------------ 输出结果 ------------\n");
         while(1) {
-            readRows = read_N_Rows_From_1_Block(readBlk, t, numOfStandardRows);
-            // IOIOҪȥ
-            // ﻹ˽洢ģҳһ鶼д
+            readRows = read_N_Rows_From_1_Block(readBlk, t.data(), numOfStandardRows);
+            // 输出结果的IO次数不计入表操作的IO次数，所以要减去
+            // 这里还假设了结果是连续存储的，且除最后一块以外其他块都是写满的
             buff.numIO -= ceil(1.0 * readRows / numOfRowInBlk);
             count += readRows;
             if (timesSmallerThanOne) {
@@ -148,24 +308,30 @@ void showResult(table_t resTable) {
         }
     }
     printf("----------------------------------\n");
-    printf(" %dн\n\n", curRows / base);
+    printf(" 共%d行结果\n\n", curRows / base);
 }
 
 
 /**
- * @brief һɨм䲽衪ɢ
- * Ӵжȡݵϣɢг鲢ÿɢн洢ش
+ * @brief 一趟扫描的中间步骤——块内散列
+ * 从磁盘中读取数据到缓冲区上，散列成若干组并将每组散列结果存储回磁盘上
  * 
- * @param numOfBuckets ͰڲڻҪ󾡿ܵض
- * @param startIndex ñһɨ̿ʼַ
- * @param scan_1_index ñһɨ洢ʼַ
+ * @param numOfBuckets 桶的数量，在不大于缓冲区数量的情况下要求尽可能地多
+ * @param startIndex 该表一趟扫描所读入磁盘块的起始地址
+ * @param scan_1_index 该表一趟扫描结果存储的起始地址，散列后为空的桶置为END_OF_FILE
+ * @param buildFilter 不为NULL时，把每条记录的A值加入该过滤器
+ * @param probeFilter 不为NULL时，A值不在该过滤器中的记录直接丢弃，不写入任何桶
+ * @return int 被probeFilter丢弃的记录数
  */
-void scan_1_HashToBucket(int numOfBuckets, addr_t startIndex, addr_t scan_1_index[]) {
+int scan_1_HashToBucket(int numOfBuckets, addr_t startIndex, addr_t scan_1_index[],
+    BloomFilter *buildFilter = NULL, const BloomFilter *probeFilter = NULL)
+{
     int numOfReadBlk = numOfBufBlock - numOfBuckets;
     if (numOfReadBlk < 0)
-        error("Ͱڻ");
+        error("错误：桶的数量大于缓冲区数量！");
     int numOfRows = numOfRowInBlk * numOfReadBlk;
-    row_t R_data[numOfRows], R_Empty;
+    std::vector<row_t> R_data(numOfRows);
+    row_t R_Empty;
     block_t *readBlk = new block_t[numOfReadBlk];
     block_t *bucketBlk = new block_t[numOfBuckets];
     addr_t next = startIndex;
@@ -177,55 +343,63 @@ void scan_1_HashToBucket(int numOfBuckets, addr_t startIndex, addr_t scan_1_inde
         next = readBlk[i].readNextAddr();
         if (next == END_OF_FILE) {
             numOfReadBlk = i + 1;
-            numOfRows = sizeOfRow * numOfReadBlk;
+            numOfRows = numOfRowInBlk * numOfReadBlk;
             break;
         }
     }
 
-    int readRows;
+    int readRows, numOfDropped = 0;
     while(1) {
-        readRows = read_N_Rows_From_M_Block(readBlk, R_data, numOfRows, numOfReadBlk);
+        readRows = read_N_Rows_From_M_Block(readBlk, R_data.data(), numOfRows, numOfReadBlk);
         for (int k = 0; k < readRows; ++k) {
+            if (buildFilter != NULL)
+                buildFilter->insert(R_data[k].A);
+            if (probeFilter != NULL && !probeFilter->mayContain(R_data[k].A)) {
+                numOfDropped += 1;
+                continue;
+            }
             int hashVal = hashRowsByA(R_data[k], numOfBuckets);
             bucketBlk[hashVal].writeRow(R_data[k]);
         }
         if (readRows < numOfRows) {
-            addr_t endAddr;
             for (int i = 0; i < numOfBuckets; ++i) {
-                endAddr = bucketBlk[i].writeLastBlock();
+                // 没有写入记录的桶，其起始块已由writeLastBlock归还
+                if (bucketBlk[i].writeLastBlock(false) == END_OF_FILE)
+                    scan_1_index[i] = END_OF_FILE;
             }
             break;
         }
     }
-    // Ҫָָڴ
+    // 需要回收这两个对象指针指向的内存区域
     delete[] readBlk;
     delete[] bucketBlk;
+    return numOfDropped;
 }
 
 
 /**
- * @brief һɨм䲽衪
- * Ӵжȡݵϣ򲢽洢ش
- * ͬʱ¼еõÿӱ׵ַ
+ * @brief 一趟扫描的中间步骤——块内排序
+ * 从磁盘中读取数据到缓冲区上，排序并将排序结果存储回磁盘上
+ * 同时，记录下排序过程中得到的每个子表的首地址，每个子表各自申请一段区段存放
  * 
- * @param numOfSubTables  ϵӱ
- * @param scan_1_index ñһɨ洢ʼַ
- * @param startIndex ñһɨ̿ʼַ
- * @param sizeOfSubTable ɨӱĴС
- * @return addr_t һɨڴ洢һ̿ĵַ
+ * @param numOfSubTables  待排序关系表的子表数量
+ * @param scan_1_index 该表一趟扫描每个子表的起始地址
+ * @param startIndex 该表一趟扫描所读入磁盘块的起始地址
+ * @param sizeOfSubTable 扫描子表的大小
  */
-addr_t scan_1_PartialSort(int numOfSubTables, addr_t scan_1_index, addr_t startIndex, int sizeOfSubTable) {
+void scan_1_PartialSort(int numOfSubTables, addr_t scan_1_index[], addr_t startIndex, int sizeOfSubTable) {
     int numOfUsedBlk = numOfBufBlock, numOfRows = sizeOfSubTable;
-    addr_t curAddr = scan_1_index, nextStart = startIndex;
-    block_t blk[numOfUsedBlk];
-    row_t R_data[sizeOfSubTable], emptyRow;
+    addr_t nextStart = startIndex;
+    std::vector<block_t> blk(numOfUsedBlk);
+    block_t resBlk;
+    std::vector<row_t> R_data(sizeOfSubTable);
     int readRows;
     for (int k = 0; k < numOfSubTables; ++k) {
-        // printf("** ʼ%dӱ **\n", k + 1);
-        // һδӴж8Ϊһӱ
+        // printf("** 开始第%d个子表的排序 **\n", k + 1);
+        // 一次从磁盘中读8块进来，作为一个子表
         for (int i = 0; i < numOfUsedBlk; ++i) {
             blk[i].loadFromDisk(nextStart);
-            nextStart = (int)blk[i].readNextAddr();	// ȡһַnext
+            nextStart = (int)blk[i].readNextAddr();	// 取下一块地址到next中
             if (nextStart == 0) {
                 numOfUsedBlk = i + 1;
                 numOfRows = numOfRowInBlk * numOfUsedBlk;
@@ -233,101 +407,85 @@ addr_t scan_1_PartialSort(int numOfSubTables, addr_t scan_1_index, addr_t startI
             }
         }
         nextStart = blk[numOfUsedBlk - 1].readNextAddr();
-        // ȡ8е
-        readRows = read_N_Rows_From_M_Block(blk, R_data, numOfRows, numOfUsedBlk);
+        // 提取这8块中的数据
+        readRows = read_N_Rows_From_M_Block(blk.data(), R_data.data(), numOfRows, numOfUsedBlk);
         if (readRows == numOfRows && k < numOfSubTables - 1) {
-            // read_N_Rows_From_M_BlockԶһ
-            // ҪֶͷűصĻ
+            // 由于read_N_Rows_From_M_Block会自动加载下一组表块的内容
+            // 所以这里需要手动释放被加载的缓冲区
             int loaded = numOfBufBlock - buff.numFreeBlk;
             for (int i = 0; i < loaded; ++i) {
                 blk[i].freeBlock();
             }
         }
-        // Եǰӱ
-        insertSort<row_t>(R_data, readRows);
+        // 对当前子表进行排序
+        sortRows(R_data.data(), readRows);
         // printRows(R_data, readRows);
-        // ӱдش
-        addr_t nextWriteAddr = scan_1_index + k * 8;
-        for (int i = 0; i < numOfUsedBlk; ++i) {
-            int numOfRows = sizeOfSubTable / sizeOfRow;
-            blk[i].writeInit(nextWriteAddr++, numOfRows);
-            for (int j = 0, count; j < numOfRows; ++j) {
-                count = i * numOfRows + j;
-                if (count < readRows)
-                    blk[i].writeRow(R_data[count]);
-                else
-                    break;
-            }
-            if (i < numOfUsedBlk - 1) {
-                // Ҫô˲ǿƽдش̣ͷŶӦ
-                blk[i].writeRow(emptyRow);
-                blk[i].freeBlock();
-            } else
-                blk[i].writeLastBlock();
-            curAddr += 1;
-        }
+        // 将排序的子表写回磁盘，写满一块后自动写入该子表区段中的下一块
+        scan_1_index[k] = blkAllocator.allocate(numOfUsedBlk);
+        resBlk.writeInit(scan_1_index[k], sizeOfSubTable / numOfBufBlock);
+        for (int i = 0; i < readRows; ++i)
+            resBlk.writeRow(R_data[i]);
+        resBlk.writeLastBlock(false);   // 子表只是中间结果，不必落盘
     }
-    return curAddr;
 }
 
 
 /**
- * @brief ɨм䲽衪ڹ鲢
- * Ӵжȡһзݵ
- * ܱ򲢽洢ش
+ * @brief 两趟扫描的中间步骤——组内归并排序
+ * 从磁盘中读取一个表中所有分组排序的数据到缓冲区上
+ * 进行总表排序并将排序结果存储回磁盘上
  * 
- * @param numOfSubTables ϵӱ
- * @param scan_1_index ñһɨ洢ʼַ
- * @param scan_2_index ñɨ洢ʼַ
- * @return addr_t ɨڴ洢һ̿ĵַ
+ * @param numOfSubTables 待排序关系表的子表数量
+ * @param scan_1_index 该表一趟扫描每个子表的起始地址
+ * @param scan_2_index 该表二趟扫描结果存储的起始地址
+ * @param zones 不为NULL时，顺带记下结果中每块的zone map
+ * @return addr_t 二趟扫描结果所在存储区域的最后一个磁盘块的地址
  */
-addr_t scan_2_SortMerge(int numOfSubTables, addr_t scan_1_index, addr_t scan_2_index) {
+addr_t scan_2_SortMerge(int numOfSubTables, addr_t scan_1_index[], addr_t scan_2_index, zone_map_t *zones = NULL) {
     addr_t resultAddr = scan_2_index;
-    block_t readBlk[numOfSubTables];
+    std::vector<block_t> readBlk(numOfSubTables);
     block_t resBlk;
-    Row rtemp, rFirst[numOfSubTables];  // ¼ÿĵһԪ
+    Row rtemp;
+    std::vector<Row> rFirst(numOfSubTables);    // 记录每块的第一个元组
     resBlk.writeInit(resultAddr);
-    // װصǰϵӱеĵһ
+    // 先装载当前关系的所有子表中的第一块
     for (int i = 0; i < numOfSubTables; ++i) {
-        addr_t curAddr = scan_1_index + i * 8;
-        readBlk[i].loadFromDisk(curAddr);
+        readBlk[i].loadFromDisk(scan_1_index[i]);
         rFirst[i] = readBlk[i].getNewRow();
         if (rFirst[i].isFilled == false)
             return ADDR_NOT_EXISTS;
     }
 
-    int readRows[numOfSubTables];
+    std::vector<int> readRows(numOfSubTables);
     for (int i = 0; i < numOfSubTables; ++i)
         readRows[i] = 0;
-    int arg = argmin(rFirst, numOfSubTables);
+    int arg = argmin(rFirst.data(), numOfSubTables);
     while(1) {
-        // ӵǰλÿǰļ¼УȡֵֶСһ¼±
-        // argΪü¼ڵӱ;
+        // 从当前位于每个块最前面的记录中，取索引字段值最小的一条记录的下标
+        // 即arg为该记录所在的子表编号;
         rtemp = rFirst[arg];
         // printf("arg: %d\trtemp.A: %d\t", arg, rtemp.A);
         // printRows(rFirst, numOfSubTables);
         rFirst[arg] = readBlk[arg].getNewRow();
-        arg = argmin(rFirst, numOfSubTables);
+        arg = argmin(rFirst.data(), numOfSubTables);
         if (rtemp.isFilled == false) {
-            // ӱѶ
-            int totalReadRows = std::accumulate(readRows, readRows + numOfSubTables, 0);
-            resultAddr += ceil(1.0 * totalReadRows / numOfRowInBlk) - 1;
+            // 所有子表都已读完
             for (int i = 0; i < numOfSubTables; ++i) {
                 if (readRows[i] % numOfRowInBlk != 0) {
-                    // ȡ7ı˵һ¼<7
-                    // getNewRowֻڶһ(7¼)֮ŻͷţҪֶͷŻ
+                    // 读取的行数不是7的倍数，说明这一块记录总数<7
+                    // 由于getNewRow只有在读完一整块(7条记录)之后才会释放，因此需要手动释放缓冲区
                     readBlk[i].freeBlock();
                 }
             }
-            int isLastBlock = resBlk.writeLastBlock();
-            if (isLastBlock) {
-                // лʣ
-                resultAddr += 1;
-            }
+            addr_t endAddr = resBlk.writeLastBlock();
+            if (endAddr != END_OF_FILE)
+                resultAddr = endAddr;
             break;
         }
         readRows[arg] += 1;
-        resBlk.writeRow(rtemp);
+        resultAddr = resBlk.writeRow(rtemp);
+        if (zones != NULL)
+            addToZoneMap(*zones, resultAddr, rtemp.A);
     }
     return resultAddr;
 }
@@ -0,0 +1,85 @@
+#include <map>
+#include "utils.cpp"
+#pragma once
+
+/**
+ * @brief 块级zone map
+ * 为文件的每一块记下其地址、记录数以及A属性的最小值和最大值，存放在单独的zone map文件中
+ * 扫描时先看块的[minA, maxA]是否可能满足条件，不可能时这一块根本不用读入
+ * 聚簇文件按A有序，各块的取值范围互不重叠，范围检索只需读入少数几块
+ * 
+ * zone map文件按v2格式写出，每块的zone map占两项：(块地址, 记录数)、(minA, maxA)
+ * 聚簇时由scan_2_SortMerge顺带记下，其余文件在第一次扫描时记下
+ */
+
+std::map<addr_t, addr_t> zoneMapFiles;      // zone map映射表，格式为<文件首地址, 其zone map文件的首地址>
+std::map<addr_t, zone_map_t> zoneMapCache;  // 已读入内存的zone map，同一文件的zone map只读一次
+
+
+/**
+ * @brief 将文件的zone map写入磁盘，替换该文件原有的zone map
+ * 
+ * @param fileStart 文件的首地址
+ * @param zones 文件的zone map
+ */
+void saveZoneMap(addr_t fileStart, const zone_map_t &zones) {
+    auto findOld = zoneMapFiles.find(fileStart);
+    if (findOld != zoneMapFiles.end()) {
+        DropFiles(findOld->second);
+        zoneMapFiles.erase(findOld);
+    }
+    zoneMapCache[fileStart] = zones;
+    if (zones.empty())
+        return;
+    int rowsPerBlk = numOfRowInRowIdBlk();
+    addr_t zoneStart = blkAllocator.allocate(ceil(2.0 * zones.size() / rowsPerBlk));
+    block_t zoneBlk;
+    zoneBlk.writeInit(zoneStart, rowsPerBlk, BLK_FORMAT_BINARY);
+    for (const zone_entry_t &zone : zones) {
+        index_t item;
+        item.isFilled = true;
+        item.A = zone.addr, item.B = zone.numOfRows;
+        zoneBlk.writeRow(item);
+        item.A = zone.minA, item.B = zone.maxA;
+        zoneBlk.writeRow(item);
+    }
+    zoneBlk.writeLastBlock();
+    zoneMapFiles[fileStart] = zoneStart;
+}
+
+
+/**
+ * @brief 取得文件的zone map，内存中没有时从zone map文件读入
+ * 
+ * @param fileStart 文件的首地址
+ * @param zones 文件的zone map
+ * @return bool 该文件是否有zone map
+ */
+bool loadZoneMap(addr_t fileStart, zone_map_t &zones) {
+    auto findCache = zoneMapCache.find(fileStart);
+    if (findCache != zoneMapCache.end()) {
+        zones = findCache->second;
+        return true;
+    }
+    auto findFile = zoneMapFiles.find(fileStart);
+    if (findFile == zoneMapFiles.end())
+        return false;
+    int rowsPerBlk = numOfRowInRowIdBlk();
+    std::vector<index_t> items;
+    std::vector<row_t> R(numOfRowInBlk);
+    block_t readBlk;
+    addr_t next = findFile->second;
+    while (next != END_OF_FILE) {
+        readBlk.loadFromDisk(next);
+        int readRows = readBlk.decodeAll(R.data(), rowsPerBlk);
+        for (int i = 0; i < readRows && R[i].isFilled; ++i)
+            items.push_back(R[i]);
+        next = readBlk.readNextAddr();
+        readBlk.freeBlock();
+    }
+    zones.clear();
+    for (size_t i = 0; i + 1 < items.size(); i += 2)
+        zones.push_back({(addr_t)items[i].A, items[i].B, items[i + 1].A, items[i + 1].B});
+    zoneMapCache[fileStart] = zones;
+    return true;
+}